@@ -2,6 +2,11 @@ workspace "Scop"
   architecture "x64"
   configurations { "debug", "release" }
 
+newoption {
+  trigger = "avx2",
+  description = "Build with AVX2 (wider SIMD paths, e.g. CPU frustum culling)"
+}
+
 outputdir = "%{cfg.buildcfg}-%{cfg.system}-%{cfg.architecture}"
 rootDir = path.getabsolute(".")
 
@@ -5,15 +5,24 @@
 #include <engine/renderer/Renderer.h>
 #include <engine/scene/Scene.h>
 #include <engine/renderer/Descriptors.h>
+#include <engine/renderer/LayoutCache.h>
+#include <engine/renderer/BindlessTable.h>
+#include <engine/renderer/GeometryPool.h>
 #include <memory>
+#include <string_view>
 #include <vector>
 
 namespace Scop {
   class App {
   public:
     static constexpr glm::uvec2 WINDOW_SIZE = { 800, 600 };
+    // positions in a stream of their own, for the depth pre-pass
+    static constexpr Renderer::Model::VertexLayout VERTEX_LAYOUT = Renderer::Model::VertexLayout::SplitPosition;
+    // GPU time per frame dynamic resolution scales the 3D passes to
+    static constexpr float FRAME_BUDGET_MS = 1000.0f / 60.0f;
 
-    App();
+    // preferredDevice forces a GPU by name or UUID, see Renderer::Device
+    App(std::string_view preferredDevice = {});
     ~App();
     App(const App&) = delete;
     App& operator=(const App&) = delete;
@@ -33,6 +42,9 @@ namespace Scop {
     Window window{ WINDOW_SIZE, "Scop" };
     Renderer::Device device{ window };
     Renderer::Renderer renderer{ window, device };
+    Renderer::LayoutCache layoutCache{ device };
+    Renderer::BindlessTable bindlessTable{ device, layoutCache };
+    Renderer::GeometryPool geometryPool{ device, Renderer::Model::GetVertexStrides(VERTEX_LAYOUT) };
     std::unique_ptr<Renderer::DescriptorPool> globalDescriptorPool = nullptr;
 
     SceneCamera sceneCamera{};
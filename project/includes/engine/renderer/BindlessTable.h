@@ -0,0 +1,66 @@
+#pragma once
+
+#include <engine/renderer/Device.h>
+#include <engine/renderer/Descriptors.h>
+#include <engine/renderer/LayoutCache.h>
+#include <engine/renderer/MemBuffer.h>
+
+#include <memory>
+#include <vector>
+
+namespace Scop::Renderer {
+  // A single, always bound descriptor set holding large partially bound arrays of
+  // sampled images and storage buffers. Resources are registered once and shaders
+  // reach them through the returned index, so draws never need their own set.
+  class BindlessTable {
+  public:
+    static constexpr uint32_t SAMPLED_IMAGE_BINDING = 0;
+    static constexpr uint32_t STORAGE_BUFFER_BINDING = 1;
+    static constexpr uint32_t MAX_SAMPLED_IMAGES = 1024;
+    static constexpr uint32_t MAX_STORAGE_BUFFERS = 256;
+    static constexpr uint32_t INVALID_INDEX = ~0u;
+
+    BindlessTable(Device& device, LayoutCache& layoutCache);
+    ~BindlessTable();
+    BindlessTable(const BindlessTable&) = delete;
+    BindlessTable& operator=(const BindlessTable&) = delete;
+
+    uint32_t registerBuffer(const MemBuffer& buffer);
+    uint32_t registerImage(
+      VkImageView imageView,
+      VkSampler sampler,
+      VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+    );
+    // Only valid for slots no pending command buffer reads from
+    void updateBuffer(uint32_t index, const MemBuffer& buffer);
+    void updateImage(
+      uint32_t index,
+      VkImageView imageView,
+      VkSampler sampler,
+      VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+    );
+    void releaseBuffer(uint32_t index) { this->buffers.release(index); }
+    void releaseImage(uint32_t index) { this->images.release(index); }
+
+    VkDescriptorSet getSet() const { return this->set; }
+    VkDescriptorSetLayout getSetLayout() const { return this->setLayout->getHandle(); }
+  private:
+    struct Slots {
+      uint32_t capacity;
+      uint32_t next = 0;
+      std::vector<uint32_t> freeList{};
+
+      uint32_t acquire();
+      void release(uint32_t index);
+    };
+
+    void write(uint32_t binding, uint32_t index, const VkDescriptorBufferInfo* bufferInfo, const VkDescriptorImageInfo* imageInfo);
+
+    Device& device;
+    std::shared_ptr<DescriptorSetLayout> setLayout;
+    std::unique_ptr<DescriptorPool> pool;
+    VkDescriptorSet set = VK_NULL_HANDLE;
+    Slots images{ MAX_SAMPLED_IMAGES };
+    Slots buffers{ MAX_STORAGE_BUFFERS };
+  };
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <engine/renderer/Device.h>
+#include <engine/renderer/Swapchain.h>
+#include <engine/renderer/CommandRecorder.h>
+
+#include <array>
+#include <functional>
+
+namespace Scop::Renderer {
+  // Secondary command buffers recorded once and executed again every frame while the
+  // version of their inputs stays the same. Per-frame data must reach them through
+  // buffers (the global UBO, instance buffers), never through recorded commands.
+  // One buffer per frame in flight: a slot is only re-recorded once the frame that
+  // last executed it has completed.
+  class CommandCache {
+  public:
+    using RecordFn = std::function<void(CommandRecorder& recorder)>;
+
+    CommandCache(Device& device);
+    ~CommandCache();
+    CommandCache(const CommandCache&) = delete;
+    CommandCache& operator=(const CommandCache&) = delete;
+
+    // Inside a render pass begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+    // Records the slot with record (viewport and scissor already set) when the version,
+    // render pass or extent changed, then executes it.
+    void execute(
+      CommandRecorder& recorder,
+      uint32_t frameIndex,
+      uint64_t version,
+      VkRenderPass renderPass,
+      VkExtent2D extent,
+      const RecordFn& record
+    );
+
+    // Every slot is recorded again on its next execute
+    void invalidate();
+    uint32_t getRecordCount() const { return this->recordCount; }
+  private:
+    struct Slot {
+      VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+      bool valid = false;
+      uint64_t version = 0;
+      VkRenderPass renderPass = VK_NULL_HANDLE;
+      VkExtent2D extent{ 0, 0 };
+    };
+
+    Device& device;
+    std::array<Slot, Swapchain::MAX_FRAMES_IN_FLIGHT> slots;
+    CommandRecorder recorder;
+    uint32_t recordCount = 0;
+  };
+}
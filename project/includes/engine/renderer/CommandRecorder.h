@@ -0,0 +1,139 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <engine/renderer/Dispatch.h>
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+
+namespace Scop::Renderer {
+  // Thin layer over a command buffer that remembers the currently bound state and
+  // drops commands that would not change it. Render systems record through it
+  // instead of calling vkCmd* directly.
+  class CommandRecorder {
+  public:
+    static constexpr uint32_t MAX_DESCRIPTOR_SETS = 4;
+    static constexpr uint32_t MAX_VERTEX_BINDINGS = 4;
+    static constexpr uint32_t MAX_PUSH_CONSTANT_SIZE = 128;
+
+    enum class Command : uint8_t {
+      BindPipeline,
+      BindDescriptorSets,
+      BindVertexBuffers,
+      BindIndexBuffer,
+      PushConstants,
+      Draw,
+      DrawIndirect,
+      Dispatch,
+      Barrier,
+      ExecuteCommands,
+      Count
+    };
+    struct Stats {
+      std::array<uint32_t, static_cast<size_t>(Command::Count)> issued{};
+      std::array<uint32_t, static_cast<size_t>(Command::Count)> elided{};
+      uint32_t pushedBytes = 0;
+      uint32_t elidedPushBytes = 0;
+
+      uint32_t totalIssued() const;
+      uint32_t totalElided() const;
+      uint32_t getIssued(Command command) const { return this->issued[static_cast<size_t>(command)]; }
+      uint32_t getElided(Command command) const { return this->elided[static_cast<size_t>(command)]; }
+    };
+
+    CommandRecorder() = default;
+    CommandRecorder(const CommandRecorder&) = delete;
+    CommandRecorder& operator=(const CommandRecorder&) = delete;
+
+    // Starts tracking a freshly begun command buffer, resets state and stats
+    void begin(VkCommandBuffer commandBuffer, const DeviceDispatch& dispatchTable);
+    // Forget everything that is bound, e.g. after executing secondary command buffers
+    void invalidate();
+
+    VkCommandBuffer getHandle() const { return this->commandBuffer; }
+    const Stats& getStats() const { return this->stats; }
+
+    void bindPipeline(VkPipelineBindPoint bindPoint, VkPipeline pipeline);
+    void bindDescriptorSets(
+      VkPipelineBindPoint bindPoint,
+      VkPipelineLayout layout,
+      uint32_t firstSet,
+      uint32_t setCount,
+      const VkDescriptorSet* sets
+    );
+    void bindVertexBuffers(
+      uint32_t firstBinding,
+      uint32_t bindingCount,
+      const VkBuffer* buffers,
+      const VkDeviceSize* offsets
+    );
+    void bindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType);
+    void pushConstants(
+      VkPipelineLayout layout,
+      VkShaderStageFlags stageFlags,
+      uint32_t offset,
+      uint32_t size,
+      const void* data
+    );
+    void draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance);
+    void drawIndexed(
+      uint32_t indexCount,
+      uint32_t instanceCount,
+      uint32_t firstIndex,
+      int32_t vertexOffset,
+      uint32_t firstInstance
+    );
+    void drawIndexedIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride);
+    void dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ);
+    // Global memory barrier, enough for buffers shared between passes
+    void memoryBarrier(
+      VkPipelineStageFlags srcStageMask,
+      VkAccessFlags srcAccessMask,
+      VkPipelineStageFlags dstStageMask,
+      VkAccessFlags dstAccessMask
+    );
+    // Single image barrier, for layout transitions
+    void imageBarrier(
+      VkPipelineStageFlags srcStageMask,
+      VkPipelineStageFlags dstStageMask,
+      const VkImageMemoryBarrier& barrier
+    );
+    // Runs secondary command buffers, which leave the bound state undefined
+    void executeCommands(uint32_t commandBufferCount, const VkCommandBuffer* commandBuffers);
+  private:
+    struct BoundSet {
+      VkPipelineLayout layout = VK_NULL_HANDLE;
+      VkDescriptorSet set = VK_NULL_HANDLE;
+    };
+    struct BoundVertexBuffer {
+      VkBuffer buffer = VK_NULL_HANDLE;
+      VkDeviceSize offset = 0;
+    };
+    struct BoundIndexBuffer {
+      VkBuffer buffer = VK_NULL_HANDLE;
+      VkDeviceSize offset = 0;
+      VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+    };
+    struct PushConstantState {
+      VkPipelineLayout layout = VK_NULL_HANDLE;
+      VkShaderStageFlags stageFlags = 0;
+      std::array<uint8_t, MAX_PUSH_CONSTANT_SIZE> data{};
+      std::bitset<MAX_PUSH_CONSTANT_SIZE> valid{};
+    };
+
+    void issued(Command command) { this->stats.issued[static_cast<size_t>(command)]++; }
+    void elided(Command command) { this->stats.elided[static_cast<size_t>(command)]++; }
+
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    const DeviceDispatch* dispatchTable = nullptr;
+    VkPipeline graphicsPipeline = VK_NULL_HANDLE;
+    VkPipeline computePipeline = VK_NULL_HANDLE;
+    std::array<BoundSet, MAX_DESCRIPTOR_SETS> graphicsSets{};
+    std::array<BoundSet, MAX_DESCRIPTOR_SETS> computeSets{};
+    std::array<BoundVertexBuffer, MAX_VERTEX_BINDINGS> vertexBuffers{};
+    BoundIndexBuffer indexBuffer{};
+    PushConstantState pushConstantState{};
+    Stats stats{};
+  };
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string_view>
+#include <engine/renderer/Device.h>
+#include <engine/renderer/CommandRecorder.h>
+
+namespace Scop::Renderer {
+  class ComputePipeline {
+  public:
+    ComputePipeline(
+      Device& device,
+      const std::string_view compFilePath,
+      VkPipelineLayout pipelineLayout
+    );
+    ~ComputePipeline();
+    ComputePipeline(const ComputePipeline&) = delete;
+    ComputePipeline& operator=(const ComputePipeline&) = delete;
+
+    void bind(CommandRecorder& recorder);
+  private:
+    Device& device;
+    VkPipeline computePipeline = VK_NULL_HANDLE;
+  };
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <engine/renderer/Device.h>
+#include <engine/renderer/Swapchain.h>
+#include <engine/renderer/Descriptors.h>
+#include <engine/renderer/LayoutCache.h>
+#include <engine/renderer/BindlessTable.h>
+#include <engine/renderer/CommandRecorder.h>
+#include <engine/renderer/ComputePipeline.h>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace Scop::Renderer {
+  // Hi-Z mip chain of the depth attachment, used for occlusion culling.
+  // Level 0 is a copy of the depth, every next level halves the previous one and
+  // keeps the farthest depth of the texels it covers, so tests against it stay conservative.
+  // The whole chain is sampled through the bindless table, in GENERAL layout.
+  class DepthPyramid {
+  public:
+    static constexpr uint32_t MAX_LEVELS = 16;
+    static constexpr uint32_t GROUP_SIZE = 8;
+
+    DepthPyramid(Device& device, LayoutCache& layoutCache, BindlessTable& bindlessTable);
+    ~DepthPyramid();
+    DepthPyramid(const DepthPyramid&) = delete;
+    DepthPyramid& operator=(const DepthPyramid&) = delete;
+
+    // Outside of a render pass, once the depth attachment of the frame has been written.
+    // The depth image is left in DEPTH_STENCIL_ATTACHMENT_OPTIMAL for the next pass.
+    // Recreates the pyramid (and waits for the device) when the extent changed.
+    void build(
+      CommandRecorder& recorder,
+      uint32_t frameIndex,
+      VkImage depthImage,
+      VkImageView depthImageView,
+      VkFormat depthFormat,
+      VkExtent2D extent
+    );
+
+    bool isReady() const { return this->image != VK_NULL_HANDLE; }
+    uint32_t getTableIndex() const { return this->tableIndex; }
+    VkExtent2D getExtent() const { return this->extent; }
+    uint32_t getLevelCount() const { return static_cast<uint32_t>(this->levelViews.size()); }
+  private:
+    void create(VkExtent2D extent);
+    void destroy();
+
+    Device& device;
+    BindlessTable& bindlessTable;
+    std::shared_ptr<DescriptorSetLayout> setLayout;
+    std::unique_ptr<DescriptorPool> descriptorPool;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    std::unique_ptr<ComputePipeline> pipeline;
+    VkSampler sampler = VK_NULL_HANDLE;
+
+    VkImage image = VK_NULL_HANDLE;
+    VkDeviceMemory imageMemory = VK_NULL_HANDLE;
+    VkImageView view = VK_NULL_HANDLE;
+    std::vector<VkImageView> levelViews;
+    // levelSets[i] reduces level i - 1 into level i, levelSets[0] is unused
+    std::vector<VkDescriptorSet> levelSets;
+    // copies the depth attachment into level 0, rewritten every frame
+    std::array<VkDescriptorSet, Swapchain::MAX_FRAMES_IN_FLIGHT> depthSets{};
+    VkExtent2D extent{ 0, 0 };
+    uint32_t tableIndex = BindlessTable::INVALID_INDEX;
+    bool initialized = false;
+  };
+}
@@ -6,9 +6,12 @@
 #include <memory>
 
 namespace Scop::Renderer {
+  class LayoutCache;
+
   class DescriptorSetLayout {
   public:
     using BindingsMap = std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding>;
+    using BindingFlagsMap = std::unordered_map<uint32_t, VkDescriptorBindingFlags>;
     class Builder {
     public:
       Builder(Device& device) : device{ device } {}
@@ -17,18 +20,25 @@ namespace Scop::Renderer {
         uint32_t binding,
         VkDescriptorType descriptorType,
         VkShaderStageFlags stageFlags,
-        uint32_t count = 1
+        uint32_t count = 1,
+        VkDescriptorBindingFlags bindingFlags = 0
       );
+      inline Builder& setLayoutFlags(VkDescriptorSetLayoutCreateFlags flags) { this->layoutFlags = flags; return *this; }
       std::unique_ptr<DescriptorSetLayout> build() const;
+      std::shared_ptr<DescriptorSetLayout> build(LayoutCache& cache) const;
 
     private:
       Device& device;
       BindingsMap bindings{};
+      BindingFlagsMap bindingFlags{};
+      VkDescriptorSetLayoutCreateFlags layoutFlags = 0;
     };
 
     DescriptorSetLayout(
       Device& device,
-      const BindingsMap& bindings
+      const BindingsMap& bindings,
+      const BindingFlagsMap& bindingFlags = {},
+      VkDescriptorSetLayoutCreateFlags layoutFlags = 0
     );
     ~DescriptorSetLayout();
     DescriptorSetLayout(const DescriptorSetLayout&) = delete;
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <engine/Window.h>
+#include <engine/renderer/Dispatch.h>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace Scop::Renderer {
@@ -19,6 +21,24 @@ namespace Scop::Renderer {
     bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
   };
 
+  // Features that are used when present but never required
+  struct OptionalFeatures {
+    bool multiDrawIndirect = false;
+    bool drawIndirectFirstInstance = false;
+    // with inheritedQueries, the query stays active over the cached secondary command buffers
+    bool pipelineStatisticsQuery = false;
+    bool timestampQueries = false;
+  };
+
+  struct DeviceScore {
+    uint32_t type = 0;
+    uint32_t memory = 0;
+    uint32_t queues = 0;
+    uint32_t features = 0;
+
+    uint32_t total() const { return type + memory + queues + features; }
+  };
+
   class Device {
   public:
 #ifdef NDEBUG
@@ -27,7 +47,8 @@ namespace Scop::Renderer {
     const bool enableValidationLayers = true;
 #endif
 
-    Device(Window& window);
+    // preferredDevice is a name substring or a device UUID, SCOP_DEVICE is used when empty
+    Device(Window& window, std::string_view preferredDevice = {});
     ~Device();
 
     // Not copyable or movable
@@ -41,12 +62,18 @@ namespace Scop::Renderer {
     VkSurfaceKHR getSurface() const { return _surface; }
     VkQueue getGraphicsQueue() const { return _graphicsQueue; }
     VkQueue getPresentQueue() const { return _presentQueue; }
+    const InstanceDispatch& getInstanceDispatch() const { return instanceDispatch; }
+    // Per frame calls go through this table, either straight to the driver or through the loader
+    const DeviceDispatch& getDispatch() const { return useDirectDispatch ? directDispatch : loaderDispatch; }
+    bool isDirectDispatch() const { return useDirectDispatch; }
+    void setDirectDispatch(bool enabled) { useDirectDispatch = enabled; }
 
     SwapChainSupportDetails getSwapChainSupport() const { return querySwapChainSupport(physicalDevice); }
     uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
     QueueFamilyIndices findPhysicalQueueFamilies() const { return findQueueFamilies(physicalDevice); }
     VkFormat findSupportedFormat(
       const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
+    VkFormatProperties getFormatProperties(VkFormat format) const;
 
     // Buffer Helper Functions
     void createBuffer(
@@ -57,7 +84,8 @@ namespace Scop::Renderer {
       VkDeviceMemory& bufferMemory);
     VkCommandBuffer beginSingleTimeCommands();
     void endSingleTimeCommands(VkCommandBuffer commandBuffer);
-    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+    void copyBuffer(
+      VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset = 0, VkDeviceSize dstOffset = 0);
     void copyBufferToImage(
       VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
 
@@ -67,13 +95,15 @@ namespace Scop::Renderer {
       VkImage& image,
       VkDeviceMemory& imageMemory);
 
+    const OptionalFeatures& getOptionalFeatures() const { return optionalFeatures; }
+
     VkPhysicalDeviceProperties properties;
 
   private:
     void createInstance();
     void setupDebugMessenger();
     void createSurface();
-    void pickPhysicalDevice();
+    void pickPhysicalDevice(std::string_view preferredDevice);
     void createLogicalDevice();
     void createCommandPool();
 
@@ -85,11 +115,15 @@ namespace Scop::Renderer {
     void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
     void hasGflwRequiredInstanceExtensions();
     bool checkDeviceExtensionSupport(VkPhysicalDevice device) const;
+    bool checkDescriptorIndexingSupport(VkPhysicalDevice device) const;
+    OptionalFeatures queryOptionalFeatures(VkPhysicalDevice device) const;
+    DeviceScore scorePhysicalDevice(VkPhysicalDevice device) const;
     SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device) const;
 
     VkInstance instance;
     VkDebugUtilsMessengerEXT debugMessenger;
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    OptionalFeatures optionalFeatures{};
     Window& window;
     VkCommandPool commandPool;
 
@@ -98,6 +132,11 @@ namespace Scop::Renderer {
     VkQueue _graphicsQueue;
     VkQueue _presentQueue;
 
+    InstanceDispatch instanceDispatch{};
+    DeviceDispatch directDispatch{};
+    DeviceDispatch loaderDispatch = DeviceDispatch::Loader();
+    bool useDirectDispatch = true;
+
     const std::vector<const char*> validationLayers = { "VK_LAYER_KHRONOS_validation" };
     const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
   };
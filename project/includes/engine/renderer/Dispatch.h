@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+// Functions resolved per instance / per device instead of going through the
+// loader trampolines exported by libvulkan. Add an entry here before calling a
+// function through a dispatch table.
+#define SCOP_INSTANCE_FUNCTIONS(X) \
+  X(vkGetDeviceProcAddr) \
+  X(vkGetPhysicalDeviceSurfaceCapabilitiesKHR) \
+  X(vkGetPhysicalDeviceSurfaceFormatsKHR) \
+  X(vkGetPhysicalDeviceSurfacePresentModesKHR)
+
+#define SCOP_DEVICE_FUNCTIONS(X) \
+  X(vkBeginCommandBuffer) \
+  X(vkEndCommandBuffer) \
+  X(vkCmdBeginRenderPass) \
+  X(vkCmdEndRenderPass) \
+  X(vkCmdSetViewport) \
+  X(vkCmdSetScissor) \
+  X(vkCmdBindPipeline) \
+  X(vkCmdBindDescriptorSets) \
+  X(vkCmdBindVertexBuffers) \
+  X(vkCmdBindIndexBuffer) \
+  X(vkCmdPushConstants) \
+  X(vkCmdDraw) \
+  X(vkCmdDrawIndexed) \
+  X(vkCmdDrawIndexedIndirect) \
+  X(vkCmdDispatch) \
+  X(vkCmdPipelineBarrier) \
+  X(vkCmdBlitImage) \
+  X(vkCmdResetQueryPool) \
+  X(vkCmdWriteTimestamp) \
+  X(vkCmdBeginQuery) \
+  X(vkCmdEndQuery) \
+  X(vkCmdExecuteCommands) \
+  X(vkWaitForFences) \
+  X(vkResetFences) \
+  X(vkAcquireNextImageKHR) \
+  X(vkQueueSubmit) \
+  X(vkQueuePresentKHR)
+
+namespace Scop::Renderer {
+#define SCOP_DECLARE_PFN(name) PFN_##name name = nullptr;
+
+  struct InstanceDispatch {
+    SCOP_INSTANCE_FUNCTIONS(SCOP_DECLARE_PFN)
+
+    // Resolves every entry with vkGetInstanceProcAddr, throws if one is missing
+    void load(VkInstance instance);
+  };
+
+  struct DeviceDispatch {
+    SCOP_DEVICE_FUNCTIONS(SCOP_DECLARE_PFN)
+
+    // Resolves every entry straight from the driver with vkGetDeviceProcAddr
+    void load(const InstanceDispatch& instanceDispatch, VkDevice device);
+    // Table pointing at the loader trampolines, only used to compare against the direct one
+    static DeviceDispatch Loader();
+  };
+
+#undef SCOP_DECLARE_PFN
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Scop::Renderer {
+  // Picks the render scale that keeps the frame time within a budget.
+  // The scale moves by STEP, so the render extent (and everything sized after it, like
+  // the depth pyramid) only changes once in a while: down as soon as the budget has been
+  // missed for SETTLE_FRAMES frames in a row, up once it has been met with HEADROOM to
+  // spare as long. Frame times lag a few frames behind, the settling absorbs that.
+  class DynamicResolution {
+  public:
+    static constexpr float MIN_SCALE = 0.5f;
+    static constexpr float STEP = 0.125f;
+    static constexpr uint32_t SETTLE_FRAMES = 8;
+    // fraction of the budget under which a frame counts as fast enough to scale up
+    static constexpr float HEADROOM = 0.75f;
+
+    DynamicResolution(float budgetMs) : budgetMs{ budgetMs } {}
+
+    // Once per frame with the latest known GPU frame time
+    void update(float frameMs);
+
+    float getScale() const { return this->enabled ? this->scale : 1.0f; }
+    float getBudget() const { return this->budgetMs; }
+    void setBudget(float budgetMs) { this->budgetMs = budgetMs; }
+    bool isEnabled() const { return this->enabled; }
+    void setEnabled(bool enabled);
+  private:
+    float budgetMs;
+    float scale = 1.0f;
+    uint32_t slowFrames = 0;
+    uint32_t fastFrames = 0;
+    bool enabled = true;
+  };
+}
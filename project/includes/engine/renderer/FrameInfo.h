@@ -3,11 +3,10 @@
 #include <cstdint>
 #include <engine/scene/SceneCamera.h>
 #include <engine/scene/components/Lights.h>
+#include <engine/renderer/CommandRecorder.h>
 #include <vulkan/vulkan.h>
 
 namespace Scop::Renderer {
-#define MAX_LIGHTS 16
-
   template <typename T>
   struct Light : public T {
     glm::vec4 position;
@@ -22,15 +21,23 @@ namespace Scop::Renderer {
       Components::GlobalLight{ 0.01f, glm::vec3{ 1.0f } },
       glm::vec4{-1.f},
     };
-    Light<Components::PointLight> pointLights[MAX_LIGHTS]{};
     uint32_t pointLightCount = 0;
+    // bindless storage buffer indices, written by Systems::Lighting
+    uint32_t lightBuffer = ~0u;
+    uint32_t clusterBuffer = ~0u;
+    uint32_t lightIndexBuffer = ~0u;
+    glm::uvec4 clusterGrid{ 0 }; // clusters along x, y and z
+    glm::vec4 clusterDepth{ 0.f }; // x: scale, y: bias of the depth slice from log(depth), z: near, w: far
+    glm::vec4 viewport{ 0.f }; // xy: size in pixels of the area the passes render to, see Renderer::getRenderExtent
   };
   struct FrameInfo {
     float deltaTime;
     uint32_t frameIndex;
     VkCommandBuffer commandBuffer;
+    CommandRecorder& recorder;
     const SceneCamera& sceneCamera;
     VkDescriptorSet globalDescriptorSet;
+    VkPipelineLayout globalPipelineLayout;
     GlobalUbo globalUbo;
   };
 }
\ No newline at end of file
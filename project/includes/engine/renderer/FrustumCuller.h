@@ -0,0 +1,39 @@
+#pragma once
+
+#include <engine/renderer/Model.h>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace Scop::Renderer {
+  // CPU frustum culling over world space AABBs stored as structure of arrays, tested
+  // 8 (AVX2) or 4 (SSE) objects at a time. Build with the avx2 premake option for the
+  // wide path, anything else falls back to SSE or scalar code.
+  class FrustumCuller {
+  public:
+    // below this many objects per thread, spawning threads costs more than it saves
+    static constexpr uint32_t MIN_OBJECTS_PER_THREAD = 8192;
+
+    void clear();
+    void reserve(size_t count);
+    // Transforms local bounds into a world space AABB
+    void add(const glm::mat4& transform, const Model::Bounds& bounds);
+    // Appends the indices, in add order, of the objects intersecting the frustum
+    void cull(const glm::mat4& projectionView, std::vector<uint32_t>& visible, uint32_t threadCount = 1) const;
+
+    size_t size() const { return this->centerX.size(); }
+  private:
+    // normalized, with the absolute normals used to project the extents
+    struct Planes {
+      std::array<float, 6> x, y, z, w;
+      std::array<float, 6> absX, absY, absZ;
+    };
+    static Planes ExtractPlanes(const glm::mat4& projectionView);
+    void cullRange(const Planes& planes, uint32_t first, uint32_t last, std::vector<uint32_t>& visible) const;
+
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+  };
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <engine/renderer/Device.h>
+#include <engine/renderer/MemBuffer.h>
+#include <engine/renderer/CommandRecorder.h>
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace Scop::Renderer {
+  // Device local vertex buffers and one index buffer shared by every model.
+  // Models only own ranges inside them, so all of them can be drawn with the same
+  // bindings and therefore from a single indirect draw.
+  // Vertices may be split into several streams, one buffer and binding each, that
+  // share the same vertex ranges.
+  class GeometryPool {
+  public:
+    static constexpr uint32_t INITIAL_VERTEX_CAPACITY = 1 << 16;
+    static constexpr uint32_t INITIAL_INDEX_CAPACITY = 1 << 18;
+
+    struct Allocation {
+      uint32_t firstVertex = 0;
+      uint32_t vertexCount = 0;
+      uint32_t firstIndex = 0;
+      uint32_t indexCount = 0;
+    };
+
+    // one stride per vertex stream, bound in order from binding 0
+    GeometryPool(Device& device, std::vector<VkDeviceSize> vertexStrides);
+    ~GeometryPool();
+    GeometryPool(const GeometryPool&) = delete;
+    GeometryPool& operator=(const GeometryPool&) = delete;
+
+    // Uploads through a staging buffer, grows the pool when needed (waits for the device)
+    // streams holds the vertices of every stream, in stream order
+    Allocation allocate(std::span<const void* const> streams, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+    void release(const Allocation& allocation);
+    // Copies an allocation back through a staging buffer, waits for the transfer
+    void read(const Allocation& allocation, std::span<void* const> streams, uint32_t* indices);
+
+    void bind(CommandRecorder& recorder) const;
+
+    uint32_t getStreamCount() const { return static_cast<uint32_t>(this->vertexBuffers.size()); }
+    VkBuffer getVertexBuffer(uint32_t stream = 0) const { return this->vertexBuffers[stream]->getHandle(); }
+    VkBuffer getIndexBuffer() const { return this->indexBuffer->getHandle(); }
+    VkDeviceSize getVertexStride(uint32_t stream = 0) const { return this->vertexBuffers[stream]->getInstanceSize(); }
+    // for compute passes reading the geometry as storage buffers, replaced when the generation changes
+    const MemBuffer& getVertexMemBuffer(uint32_t stream = 0) const { return *this->vertexBuffers[stream]; }
+    const MemBuffer& getIndexMemBuffer() const { return *this->indexBuffer; }
+    // bumped whenever a buffer is replaced by a bigger one, invalidating recorded bindings
+    uint32_t getGeneration() const { return this->generation; }
+  private:
+    // first fit over free blocks, bump allocation past the last used element
+    class RangeAllocator {
+    public:
+      RangeAllocator(uint32_t capacity) : capacity{ capacity } {}
+
+      std::optional<uint32_t> allocate(uint32_t count);
+      void release(uint32_t offset, uint32_t count);
+      uint32_t getCapacity() const { return this->capacity; }
+      void setCapacity(uint32_t capacity) { this->capacity = capacity; }
+      uint32_t getEnd() const { return this->end; }
+    private:
+      uint32_t capacity;
+      uint32_t end = 0;
+      std::map<uint32_t, uint32_t> freeBlocks;
+    };
+
+    std::unique_ptr<MemBuffer> createBuffer(VkDeviceSize elementSize, uint32_t capacity, VkBufferUsageFlags usage);
+    // grows every buffer of the range together
+    uint32_t allocateRange(
+      RangeAllocator& ranges,
+      std::span<std::unique_ptr<MemBuffer>> buffers,
+      VkBufferUsageFlags usage,
+      uint32_t count
+    );
+    void upload(MemBuffer& buffer, const void* data, VkDeviceSize size, VkDeviceSize offset);
+    void download(MemBuffer& buffer, void* data, VkDeviceSize size, VkDeviceSize offset);
+
+    Device& device;
+    std::vector<std::unique_ptr<MemBuffer>> vertexBuffers;
+    std::unique_ptr<MemBuffer> indexBuffer;
+    RangeAllocator vertexRanges{ INITIAL_VERTEX_CAPACITY };
+    RangeAllocator indexRanges{ INITIAL_INDEX_CAPACITY };
+    uint32_t generation = 0;
+  };
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <engine/renderer/Device.h>
+#include <engine/renderer/Swapchain.h>
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Scop::Renderer {
+  // Named GPU time scopes from timestamp queries, one query pool per frame in flight.
+  // Also counts fragment shader invocations over a span of the frame with a pipeline
+  // statistics query when the device supports them.
+  // Results are read back when the frame slot comes around again, so they lag
+  // MAX_FRAMES_IN_FLIGHT frames behind.
+  class GpuProfiler {
+  public:
+    static constexpr uint32_t MAX_SCOPES = 16;
+
+    GpuProfiler(Device& device);
+    ~GpuProfiler();
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    bool isSupported() const { return this->supported; }
+    bool isStatisticsSupported() const { return this->statisticsSupported; }
+
+    // Must be recorded outside of a render pass, before any scope of the frame
+    void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+    void beginScope(VkCommandBuffer commandBuffer, std::string_view name);
+    void endScope(VkCommandBuffer commandBuffer, std::string_view name);
+    // Outside of render passes, at most once per frame
+    void beginStatistics(VkCommandBuffer commandBuffer);
+    void endStatistics(VkCommandBuffer commandBuffer);
+
+    // Milliseconds of the latest completed frame, 0 when unknown
+    double getTime(std::string_view name) const;
+    // Of the latest completed frame, 0 when unknown
+    uint64_t getFragmentInvocations() const { return this->fragmentInvocations; }
+  private:
+    struct FrameQueries {
+      VkQueryPool pool = VK_NULL_HANDLE;
+      std::vector<std::string> scopes;
+      VkQueryPool statisticsPool = VK_NULL_HANDLE;
+      bool statisticsWritten = false;
+    };
+    void collect(FrameQueries& queries);
+
+    Device& device;
+    bool supported;
+    bool statisticsSupported;
+    uint32_t frameIndex = 0;
+    std::array<FrameQueries, Swapchain::MAX_FRAMES_IN_FLIGHT> frames;
+    std::vector<std::pair<std::string, double>> times;
+    uint64_t fragmentInvocations = 0;
+  };
+}
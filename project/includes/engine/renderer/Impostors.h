@@ -0,0 +1,82 @@
+#pragma once
+
+#include <engine/renderer/Device.h>
+#include <engine/renderer/LayoutCache.h>
+#include <engine/renderer/BindlessTable.h>
+#include <engine/renderer/Model.h>
+#include <engine/renderer/Pipeline.h>
+#include <engine/scene/components/Transform.h>
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <unordered_map>
+
+namespace Scop::Renderer {
+  // Octahedral impostors of dynamic models. A baked model is rendered once, orthographic, from
+  // GRID x GRID directions spread over the whole sphere by an octahedral map, into an atlas
+  // of unlit colors (alpha is the coverage) and model space normals.
+  // Instances projecting smaller than the threshold are swapped for a single quad facing the
+  // nearest baked direction, drawn by Systems::Billboards.
+  class Impostors {
+  public:
+    static constexpr uint32_t GRID = 8;
+    static constexpr uint32_t VIEW_SIZE = 64;
+    static constexpr uint32_t ATLAS_SIZE = GRID * VIEW_SIZE;
+    static constexpr VkFormat COLOR_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+    static constexpr VkFormat NORMAL_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+    // projected diameter in pixels
+    static constexpr float DEFAULT_THRESHOLD = 32.0f;
+
+    struct Atlas {
+      VkImage colorImage = VK_NULL_HANDLE;
+      VkDeviceMemory colorMemory = VK_NULL_HANDLE;
+      VkImageView colorView = VK_NULL_HANDLE;
+      VkImage normalImage = VK_NULL_HANDLE;
+      VkDeviceMemory normalMemory = VK_NULL_HANDLE;
+      VkImageView normalView = VK_NULL_HANDLE;
+      // bindless sampled image indices
+      uint32_t colorIndex = BindlessTable::INVALID_INDEX;
+      uint32_t normalIndex = BindlessTable::INVALID_INDEX;
+    };
+
+    Impostors(Device& device, LayoutCache& layoutCache, BindlessTable& bindlessTable, Model::VertexLayout vertexLayout);
+    ~Impostors();
+    Impostors(const Impostors&) = delete;
+    Impostors& operator=(const Impostors&) = delete;
+
+    // Renders the atlas of the model and waits for it, outside of a frame. Baked models are skipped
+    void bake(Model& model);
+    // nullptr when the model has no atlas
+    const Atlas* find(const Model& model) const;
+    // Once per frame, before the systems enqueue
+    void update(const glm::mat4& projection, const glm::vec3& cameraPosition, float viewportHeight);
+    // Whether the instance has an atlas and projects below the threshold this frame
+    bool isDistant(const Model& model, const Components::Transform& transform) const;
+
+    bool isEnabled() const { return this->enabled; }
+    void setEnabled(bool enabled) { this->enabled = enabled; }
+    float getThreshold() const { return this->threshold; }
+    void setThreshold(float pixels) { this->threshold = pixels; }
+    uint32_t getAtlasCount() const { return static_cast<uint32_t>(this->atlases.size()); }
+  private:
+    void createRenderPass();
+    void createImage(VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect, VkImage& image, VkDeviceMemory& memory, VkImageView& view);
+
+    Device& device;
+    BindlessTable& bindlessTable;
+    VkFormat depthFormat;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    // owned by the layout cache
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    std::unique_ptr<Pipeline> pipeline;
+    VkSampler sampler = VK_NULL_HANDLE;
+    // by model id
+    std::unordered_map<uint32_t, Atlas> atlases;
+
+    glm::vec3 cameraPosition{ 0.0f };
+    // pixels per unit of size at unit distance
+    float pixelScale = 0.0f;
+    float threshold = DEFAULT_THRESHOLD;
+    bool enabled = true;
+  };
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <engine/renderer/Device.h>
+#include <engine/renderer/Descriptors.h>
+
+#include <unordered_map>
+#include <memory>
+#include <vector>
+
+namespace Scop::Renderer {
+  // Hands out shared descriptor set layouts and pipeline layouts, keyed by their
+  // definition, so that systems declaring the same bindings end up with the same
+  // (and therefore compatible) Vulkan objects.
+  class LayoutCache {
+  public:
+    LayoutCache(Device& device) : device{ device } {}
+    ~LayoutCache();
+    LayoutCache(const LayoutCache&) = delete;
+    LayoutCache& operator=(const LayoutCache&) = delete;
+
+    std::shared_ptr<DescriptorSetLayout> getSetLayout(
+      const DescriptorSetLayout::BindingsMap& bindings,
+      const DescriptorSetLayout::BindingFlagsMap& bindingFlags = {},
+      VkDescriptorSetLayoutCreateFlags layoutFlags = 0
+    );
+    VkPipelineLayout getPipelineLayout(
+      const std::vector<VkDescriptorSetLayout>& setLayouts,
+      const std::vector<VkPushConstantRange>& pushConstantRanges
+    );
+  private:
+    struct SetLayoutKey {
+      std::vector<VkDescriptorSetLayoutBinding> bindings;
+      std::vector<VkDescriptorBindingFlags> bindingFlags;
+      VkDescriptorSetLayoutCreateFlags layoutFlags;
+
+      bool operator==(const SetLayoutKey& other) const;
+    };
+    struct PipelineLayoutKey {
+      std::vector<VkDescriptorSetLayout> setLayouts;
+      std::vector<VkPushConstantRange> pushConstantRanges;
+
+      bool operator==(const PipelineLayoutKey& other) const;
+    };
+    struct KeyHash {
+      size_t operator()(const SetLayoutKey& key) const;
+      size_t operator()(const PipelineLayoutKey& key) const;
+    };
+
+    Device& device;
+    std::unordered_map<SetLayoutKey, std::shared_ptr<DescriptorSetLayout>, KeyHash> setLayouts;
+    std::unordered_map<PipelineLayoutKey, VkPipelineLayout, KeyHash> pipelineLayouts;
+  };
+}
@@ -2,56 +2,88 @@
 
 #include <engine/renderer/Device.h>
 #include <engine/renderer/MemBuffer.h>
+#include <engine/renderer/CommandRecorder.h>
+#include <engine/renderer/GeometryPool.h>
 #include <glm/glm.hpp>
 
 #include <vector>
 #include <memory>
+#include <span>
 #include <string_view>
 
 namespace Scop::Renderer {
   class Model {
   public:
+    // How vertices are stored in the geometry pool. SplitPosition keeps positions
+    // tightly packed in binding 0 and the other attributes in binding 1, so depth only
+    // passes fetch 12 bytes per vertex instead of the whole vertex.
+    enum class VertexLayout {
+      Interleaved,
+      SplitPosition,
+    };
     struct Vertex {
       glm::vec3 position{};
       glm::vec3 color{};
       glm::vec3 normal{};
       glm::vec2 uv{};
 
-      static std::vector<VkVertexInputBindingDescription> GetBindingDescriptions();
-      static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions();
+      // attribute locations are the same in both layouts, position is always binding 0
+      static std::vector<VkVertexInputBindingDescription> GetBindingDescriptions(VertexLayout layout = VertexLayout::Interleaved);
+      static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions(VertexLayout layout = VertexLayout::Interleaved);
 
       bool operator==(const Vertex& other) const {
         return position == other.position && color == other.color && normal == other.normal && uv == other.uv;
       }
     };
+    // second stream of the split layout
+    struct VertexAttributes {
+      glm::vec3 color{};
+      glm::vec3 normal{};
+      glm::vec2 uv{};
+    };
+    // local space
+    struct Bounds {
+      glm::vec3 min{ 0.0f };
+      glm::vec3 max{ 0.0f };
+      // xyz center, w radius
+      glm::vec4 sphere{ 0.0f };
+    };
     struct Builder {
       std::vector<Vertex> vertices{};
       std::vector<uint32_t> indices{};
 
       bool loadModel(const std::string_view filePath);
+      Bounds computeBounds() const;
     };
-    Model(Device& device, const Builder& builder);
+    Model(Device& device, GeometryPool& pool, const Builder& builder);
     ~Model();
 
     Model(const Model&) = delete;
     Model& operator=(const Model&) = delete;
 
-    static std::unique_ptr<Model> CreateFromFile(Device& device, const std::string_view filePath);
+    static std::unique_ptr<Model> CreateFromFile(Device& device, GeometryPool& pool, const std::string_view filePath);
+    // stream strides of a geometry pool holding vertices in this layout
+    static std::vector<VkDeviceSize> GetVertexStrides(VertexLayout layout);
+    static VertexLayout GetVertexLayout(const GeometryPool& pool);
+    // Interleaved vertices in and out of the pool, split into streams when the pool is
+    static GeometryPool::Allocation Upload(GeometryPool& pool, std::span<const Vertex> vertices, std::span<const uint32_t> indices);
+    static void Download(GeometryPool& pool, const GeometryPool::Allocation& allocation, std::span<Vertex> vertices, std::span<uint32_t> indices);
 
-    void bind(VkCommandBuffer commandBuffer);
-    void draw(VkCommandBuffer commandBuffer);
+    void bind(CommandRecorder& recorder);
+    void draw(CommandRecorder& recorder, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
+    // small unique id, used to group draws of the same model in sort keys
+    uint32_t getId() const { return this->id; }
+    VkDrawIndexedIndirectCommand getIndirectCommand(uint32_t instanceCount, uint32_t firstInstance) const;
+    const GeometryPool::Allocation& getAllocation() const { return this->allocation; }
+    uint32_t getTriangleCount() const { return this->allocation.indexCount / 3; }
+    const Bounds& getBounds() const { return this->bounds; }
+    const glm::vec4& getBoundingSphere() const { return this->bounds.sphere; }
   private:
-    void createVertexBuffer(const std::vector<Vertex>& vertices);
-    void createIndexBuffer(const std::vector<uint32_t>& indices);
-  
     Device& device;
-
-
-    std::unique_ptr<MemBuffer> vertexBuffer;
-    uint32_t vertexCount;
-
-    bool hasIndexBuffer = false;
-    std::unique_ptr<MemBuffer> indexBuffer;
-    uint32_t indexCount;
+    GeometryPool& pool;
+    const uint32_t id;
+    // always indexed, models built without indices get a trivial index list
+    GeometryPool::Allocation allocation;
+    Bounds bounds;
   };
 }
\ No newline at end of file
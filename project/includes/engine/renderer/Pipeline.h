@@ -3,6 +3,8 @@
 #include <string_view>
 #include <vector>
 #include <engine/renderer/Device.h>
+#include <engine/renderer/CommandRecorder.h>
+#include <engine/renderer/Model.h>
 
 namespace Scop::Renderer {
   class Pipeline {
@@ -19,6 +21,8 @@ namespace Scop::Renderer {
       VkPipelineRasterizationStateCreateInfo rasterizerInfo;
       VkPipelineMultisampleStateCreateInfo multisamplingInfo;
       VkPipelineColorBlendAttachmentState colorBlendAttachment;
+      // render passes with several color attachments point colorBlendingInfo here instead
+      std::vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments;
       VkPipelineColorBlendStateCreateInfo colorBlendingInfo;
       VkPipelineDepthStencilStateCreateInfo depthStencilInfo;
       std::vector<VkDynamicState> dynamicStateEnables;
@@ -27,6 +31,7 @@ namespace Scop::Renderer {
       VkRenderPass renderPass = nullptr;
       uint32_t subpass = 0;
     };
+    // an empty fragFilePath leaves the fragment stage out
     Pipeline(
       Device& device,
       const std::string_view vertFilePath,
@@ -37,11 +42,21 @@ namespace Scop::Renderer {
     Pipeline(const Pipeline&) = delete;
     Pipeline& operator=(const Pipeline&) = delete;
 
-    void bind(VkCommandBuffer commandBuffer);
+    void bind(CommandRecorder& recorder);
     static void SetupDefaultConfigInfo(ConfigInfo& configInfo);
+    // Vertex input of Model::Vertex as stored by the geometry pool, interleaved by default
+    static void SetVertexLayout(ConfigInfo& configInfo, Model::VertexLayout layout);
     static void EnableAlphaBlending(ConfigInfo& configInfo);
-  private:
+    // Accumulation (0) and revealage (1) of weighted blended order independent transparency,
+    // without depth writes
+    static void EnableWeightedBlending(ConfigInfo& configInfo);
+    // Normal (0), albedo (1) and view depth (2) of the deferred g-buffer, written without blending
+    static void EnableGBufferOutputs(ConfigInfo& configInfo);
+    // Position attribute only and no color writes, for pipelines built without a fragment shader.
+    // With the split layout only the tightly packed position stream is fetched
+    static void EnableDepthOnly(ConfigInfo& configInfo);
     static std::vector<uint8_t> ReadFile(const std::string_view filePath);
+  private:
 
     void createGraphicsPipeline(
       const std::string_view vertFilePath,
@@ -53,7 +68,7 @@ namespace Scop::Renderer {
 
     Device& device;
     VkPipeline graphicsPipeline;
-    VkShaderModule vertShaderModule;
-    VkShaderModule fragShaderModule;
+    VkShaderModule vertShaderModule = VK_NULL_HANDLE;
+    VkShaderModule fragShaderModule = VK_NULL_HANDLE;
   };
 }
\ No newline at end of file
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace Scop {
+  class Scene;
+}
+
+namespace Scop::Renderer {
+  struct FrameInfo;
+
+  // Systems emit draw packets instead of recording directly. Packets are sorted on
+  // a 64-bit key then handed back to their owner in key order, in runs of
+  // consecutive packets with the same owner: once outside the render pass to
+  // prepare (upload, compute), once inside it to draw.
+  //
+  // opaque:      pass:2 | pipeline:14 | model:24 | depth:24 (front to back)
+  // transparent: pass:2 | depth:24 (back to front) | pipeline:14 | model:24
+  // order independent transparency has no depth order and uses the opaque layout
+  // low resolution transparency uses the transparent layout
+  class RenderQueue {
+  public:
+    enum class Pass : uint8_t {
+      Opaque = 0,
+      Transparent = 1,
+      // drawn in the transparency render pass, then composited
+      OrderIndependent = 2,
+      // sorted like Transparent, drawn into the low resolution targets, then upsampled
+      LowResolution = 3,
+    };
+    struct Packet {
+      uint64_t key;
+      // owner defined, usually an entity
+      uint32_t payload;
+      uint16_t owner;
+      uint16_t _pad0;
+    };
+    class Owner {
+    public:
+      virtual ~Owner() = default;
+      virtual void preparePackets(const FrameInfo&, Scene&, std::span<const Packet>) {}
+      virtual void drawPackets(const FrameInfo& frameInfo, Scene& scene, std::span<const Packet> packets) = 0;
+    };
+
+    static constexpr uint32_t MAX_OWNERS = 1 << 14;
+
+    RenderQueue() = default;
+    RenderQueue(const RenderQueue&) = delete;
+    RenderQueue& operator=(const RenderQueue&) = delete;
+
+    uint16_t registerOwner(Owner& owner);
+    void unregisterOwner(uint16_t id);
+
+    // depth is any non negative distance growing away from the camera
+    static uint64_t MakeKey(Pass pass, uint16_t pipeline, uint32_t model, float depth);
+
+    void clear() { this->packets.clear(); }
+    void push(uint16_t owner, uint64_t key, uint32_t payload) { this->packets.push_back({ key, payload, owner, 0 }); }
+    void sort();
+    // Outside of the render pass, runs are the same as for replay
+    void prepare(const FrameInfo& frameInfo, Scene& scene) const;
+    void replay(const FrameInfo& frameInfo, Scene& scene) const;
+    // Only the packets of one pass, which are contiguous once sorted
+    void replay(const FrameInfo& frameInfo, Scene& scene, Pass pass) const;
+
+    size_t size() const { return this->packets.size(); }
+  private:
+    template <typename Fn>
+    void forEachRun(std::span<const Packet> packets, Fn fn) const;
+
+    std::vector<Owner*> owners;
+    std::vector<Packet> packets;
+    std::vector<Packet> scratch;
+  };
+}
@@ -4,7 +4,9 @@
 #include <engine/renderer/Device.h>
 #include <engine/renderer/Swapchain.h>
 #include <engine/renderer/Model.h>
+#include <engine/renderer/CommandRecorder.h>
 #include <memory>
+#include <span>
 #include <vector>
 #include <cassert>
 
@@ -17,13 +19,39 @@ namespace Scop::Renderer {
     Renderer& operator=(const Renderer&) = delete;
 
     VkRenderPass getSwapchainRenderPass() const { return this->swapchain->getRenderPass(); }
+    VkRenderPass getTransparencyRenderPass() const { return this->swapchain->getTransparencyRenderPass(); }
+    VkRenderPass getGBufferRenderPass() const { return this->swapchain->getGBufferRenderPass(); }
+    VkRenderPass getLowResolutionRenderPass() const { return this->swapchain->getLowResolutionRenderPass(); }
+    VkRenderPass getUpsampleRenderPass() const { return this->swapchain->getUpsampleRenderPass(); }
     VkExtent2D getSwapchainExtent() const { return this->swapchain->getExtent(); }
+    // Every pass renders into the top left renderScale part of its targets, endFrame
+    // upscales that area over the whole swapchain image
+    VkExtent2D getRenderExtent() const;
+    float getRenderScale() const { return this->renderScale; }
+    // Between frames, clamped to (0, 1]. Always 1 when the swapchain can't be upscaled to
+    void setRenderScale(float scale);
     float getSwapchainExtentAspectRatio() const { return this->swapchain->extentAspectRatio(); }
+    VkFormat getSwapchainDepthFormat() const { return this->swapchain->getDepthFormat(); }
+    VkImage getCurrentDepthImage() const { return this->swapchain->getDepthImage(this->currentImageIndex); }
+    VkImageView getCurrentDepthImageView() const { return this->swapchain->getDepthImageView(this->currentImageIndex); }
+    VkImageView getCurrentAccumulationImageView() const { return this->swapchain->getAccumulationImageView(this->currentImageIndex); }
+    VkImageView getCurrentRevealageImageView() const { return this->swapchain->getRevealageImageView(this->currentImageIndex); }
+    VkImageView getCurrentNormalImageView() const { return this->swapchain->getNormalImageView(this->currentImageIndex); }
+    VkImageView getCurrentAlbedoImageView() const { return this->swapchain->getAlbedoImageView(this->currentImageIndex); }
+    VkImageView getCurrentLinearDepthImageView() const { return this->swapchain->getLinearDepthImageView(this->currentImageIndex); }
+    VkImageView getCurrentLowResolutionColorImageView() const { return this->swapchain->getLowResolutionColorImageView(this->currentImageIndex); }
+    VkImageView getCurrentLowResolutionDepthImageView() const { return this->swapchain->getLowResolutionDepthImageView(this->currentImageIndex); }
+    // The render extent divided by divisor, rounded up
+    VkExtent2D getLowResolutionExtent(uint32_t divisor) const;
     bool isFrameInProgress() const { return this->isFrameStarted; }
     VkCommandBuffer getCurrentCommandBuffer() const {
       assert(this->isFrameStarted && "Cannot get command buffer when frame not in progress.");
       return this->commandBuffers[this->currentFrameIndex];
     }
+    CommandRecorder& getRecorder() {
+      assert(this->isFrameStarted && "Cannot get recorder when frame not in progress.");
+      return this->recorder;
+    }
     uint32_t getFrameIndex() const {
       assert(this->isFrameStarted && "Cannot get frame index when frame not in progress.");
       return this->currentFrameIndex;
@@ -31,9 +59,44 @@ namespace Scop::Renderer {
 
     VkCommandBuffer beginFrame();
     void endFrame();
-    void beginSwapchainRenderPass(VkCommandBuffer commandBuffer);
+    // loadContents resumes drawing over what an earlier pass of the frame rendered,
+    // VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS for passes made of cached commands only
+    void beginSwapchainRenderPass(
+      VkCommandBuffer commandBuffer,
+      bool loadContents = false,
+      VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE
+    );
+    // Deferred shading: clears the color and keeps the depth written by the g-buffer pass
+    void beginLightingRenderPass(VkCommandBuffer commandBuffer);
     void endSwapchainRenderPass(VkCommandBuffer commandBuffer);
+    // Order independent transparency targets, tested against the depth of the frame
+    void beginTransparencyRenderPass(VkCommandBuffer commandBuffer);
+    void endTransparencyRenderPass(VkCommandBuffer commandBuffer);
+    // Deferred shading targets and the depth of the frame, same arguments as the swapchain pass
+    void beginGBufferRenderPass(
+      VkCommandBuffer commandBuffer,
+      bool loadContents = false,
+      VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE
+    );
+    void endGBufferRenderPass(VkCommandBuffer commandBuffer);
+    // Reduced resolution color and depth targets, divisor is at least Swapchain::LOW_RESOLUTION_DIVISOR.
+    // The depth of the frame has to be in DEPTH_STENCIL_READ_ONLY_OPTIMAL for the pass to sample it
+    void beginLowResolutionRenderPass(VkCommandBuffer commandBuffer, uint32_t divisor);
+    void endLowResolutionRenderPass(VkCommandBuffer commandBuffer);
+    // Back over the main pass targets after the low resolution pass, ended like the swapchain pass
+    void beginUpsampleRenderPass(VkCommandBuffer commandBuffer);
   private:
+    void beginRenderPass(
+      VkCommandBuffer commandBuffer,
+      VkRenderPass renderPass,
+      VkFramebuffer framebuffer,
+      std::span<const VkClearValue> clearValues,
+      VkExtent2D extent,
+      VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE
+    );
+    // Blits the rendered area of the scene color into the swapchain image, left in PRESENT_SRC_KHR.
+    // Only transitions the swapchain image when the passes rendered into it
+    void upscale(VkCommandBuffer commandBuffer);
     void createCommandBuffers();
     void freeCommandBuffers();
     void recreateSwapchain();
@@ -42,8 +105,10 @@ namespace Scop::Renderer {
     Device& device;
     std::unique_ptr<Swapchain> swapchain;
     std::vector<VkCommandBuffer> commandBuffers;
+    CommandRecorder recorder;
     uint32_t currentImageIndex = 0;
     uint32_t currentFrameIndex = 0;
     bool isFrameStarted = false;
+    float renderScale = 1.0f;
   };
 }
\ No newline at end of file
@@ -15,6 +15,17 @@ namespace Scop::Renderer {
   class Swapchain {
   public:
     static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+    // weighted blended order independent transparency targets
+    static constexpr VkFormat ACCUMULATION_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+    static constexpr VkFormat REVEALAGE_FORMAT = VK_FORMAT_R16_SFLOAT;
+    // deferred shading g-buffer: packed world normal, albedo, view depth
+    static constexpr VkFormat NORMAL_FORMAT = VK_FORMAT_A2B10G10R10_UNORM_PACK32;
+    static constexpr VkFormat ALBEDO_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+    static constexpr VkFormat LINEAR_DEPTH_FORMAT = VK_FORMAT_R32_SFLOAT;
+    // reduced resolution transparency: color over transmittance, at 1 / LOW_RESOLUTION_DIVISOR
+    // of the extent, coarser passes use its top left part
+    static constexpr VkFormat LOW_RESOLUTION_COLOR_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+    static constexpr uint32_t LOW_RESOLUTION_DIVISOR = 2;
 
     Swapchain(Device& deviceRef, VkExtent2D windowExtent);
     Swapchain(Device& deviceRef, VkExtent2D windowExtent, std::shared_ptr<Swapchain> previous);
@@ -23,11 +34,54 @@ namespace Scop::Renderer {
     Swapchain(const Swapchain&) = delete;
     void operator=(const Swapchain&) = delete;
 
+    // Over the scene color target, not the swapchain image: the renderer upscales the
+    // rendered area into the swapchain image at the end of the frame.
+    // Without upscale support the passes render straight into the swapchain image
     VkFramebuffer getFrameBuffer(int index) const { return this->swapChainFramebuffers[index]; }
     VkRenderPass getRenderPass() const { return this->renderPass; }
+    // Same attachments, loads what an earlier pass of the frame left in them instead of clearing
+    VkRenderPass getLoadRenderPass() const { return this->loadRenderPass; }
+    // Clears the color but loads the depth, for the deferred lighting pass after the g-buffer pass
+    VkRenderPass getLightingRenderPass() const { return this->lightingRenderPass; }
     VkImageView getImageView(int index) const { return this->swapChainImageViews[index]; }
+    VkImage getImage(int index) const { return this->swapChainImages[index]; }
+    // Same format and extent as the swapchain images, left in COLOR_ATTACHMENT_OPTIMAL by the passes.
+    // The swapchain image itself without upscale support
+    VkImage getSceneColorImage(int index) const {
+      return this->upscaleSupported ? this->sceneColorImages[index] : this->swapChainImages[index];
+    }
+    // The swapchain images can be blitted to from the scene color
+    bool isUpscaleSupported() const { return this->upscaleSupported; }
+    // The blit can filter linearly
+    bool isLinearUpscaleSupported() const { return this->linearUpscaleSupported; }
     size_t getImageCount() const { return this->swapChainImages.size(); }
     VkFormat getImageFormat() const { return this->swapChainImageFormat; }
+    VkFormat getDepthFormat() const { return this->swapChainDepthFormat; }
+    // Stored at the end of the render pass, in DEPTH_STENCIL_ATTACHMENT_OPTIMAL layout
+    VkImage getDepthImage(int index) const { return this->depthImages[index]; }
+    VkImageView getDepthImageView(int index) const { return this->depthImageViews[index]; }
+    // Accumulation and revealage targets over the depth of the frame, left in SHADER_READ_ONLY_OPTIMAL
+    VkRenderPass getTransparencyRenderPass() const { return this->transparencyRenderPass; }
+    VkFramebuffer getTransparencyFrameBuffer(int index) const { return this->transparencyFramebuffers[index]; }
+    VkImageView getAccumulationImageView(int index) const { return this->accumulationImageViews[index]; }
+    VkImageView getRevealageImageView(int index) const { return this->revealageImageViews[index]; }
+    // G-buffer targets over the depth of the frame, left in SHADER_READ_ONLY_OPTIMAL
+    VkRenderPass getGBufferRenderPass() const { return this->gbufferRenderPass; }
+    VkRenderPass getGBufferLoadRenderPass() const { return this->gbufferLoadRenderPass; }
+    VkFramebuffer getGBufferFrameBuffer(int index) const { return this->gbufferFramebuffers[index]; }
+    VkImageView getNormalImageView(int index) const { return this->normalImageViews[index]; }
+    VkImageView getAlbedoImageView(int index) const { return this->albedoImageViews[index]; }
+    VkImageView getLinearDepthImageView(int index) const { return this->linearDepthImageViews[index]; }
+    // Color and its own depth, both left in SHADER_READ_ONLY_OPTIMAL
+    VkRenderPass getLowResolutionRenderPass() const { return this->lowResolutionRenderPass; }
+    VkFramebuffer getLowResolutionFrameBuffer(int index) const { return this->lowResolutionFramebuffers[index]; }
+    VkImageView getLowResolutionColorImageView(int index) const { return this->lowResolutionColorImageViews[index]; }
+    VkImageView getLowResolutionDepthImageView(int index) const { return this->lowResolutionDepthImageViews[index]; }
+    VkExtent2D getLowResolutionExtent() const;
+    // Loads the main pass targets with the depth in DEPTH_STENCIL_READ_ONLY_OPTIMAL, so it can be
+    // sampled while attached, and stores it back in DEPTH_STENCIL_ATTACHMENT_OPTIMAL.
+    // Uses the main framebuffers
+    VkRenderPass getUpsampleRenderPass() const { return this->upsampleRenderPass; }
     VkExtent2D getExtent() const { return this->swapChainExtent; }
     float getAspectRation() const { return static_cast<float>(swapChainExtent.width) / static_cast<float>(swapChainExtent.height); }
     uint32_t width() const { return this->swapChainExtent.width; }
@@ -50,8 +104,30 @@ namespace Scop::Renderer {
     void createSwapChain();
     void createImageViews();
     void createDepthResources();
+    void createSceneColorResources();
     void createRenderPass();
+    VkRenderPass createRenderPass(bool loadColor, bool loadDepth);
     void createFramebuffers();
+    void createTransparencyResources();
+    void createTransparencyRenderPass();
+    void createTransparencyFramebuffers();
+    void createGBufferResources();
+    void createGBufferRenderPass();
+    VkRenderPass createGBufferRenderPass(bool loadContents);
+    void createGBufferFramebuffers();
+    void createLowResolutionResources();
+    void createLowResolutionRenderPass();
+    void createLowResolutionFramebuffers();
+    void createUpsampleRenderPass();
+    void createColorTarget(
+      VkFormat format,
+      VkExtent2D extent,
+      VkImage& image,
+      VkDeviceMemory& memory,
+      VkImageView& view,
+      VkImageUsageFlags extraUsage = 0
+    );
+    void createDepthTarget(VkExtent2D extent, VkImage& image, VkDeviceMemory& memory, VkImageView& view);
     void createSyncObjects();
 
     // Helper functions
@@ -64,13 +140,50 @@ namespace Scop::Renderer {
     VkFormat swapChainImageFormat;
     VkFormat swapChainDepthFormat;
     VkExtent2D swapChainExtent;
+    bool upscaleSupported = false;
+    bool linearUpscaleSupported = false;
 
     std::vector<VkFramebuffer> swapChainFramebuffers;
     VkRenderPass renderPass;
+    VkRenderPass loadRenderPass;
+    VkRenderPass lightingRenderPass;
 
+    std::vector<VkImage> sceneColorImages;
+    std::vector<VkDeviceMemory> sceneColorImageMemorys;
+    std::vector<VkImageView> sceneColorImageViews;
     std::vector<VkImage> depthImages;
     std::vector<VkDeviceMemory> depthImageMemorys;
     std::vector<VkImageView> depthImageViews;
+    std::vector<VkImage> accumulationImages;
+    std::vector<VkDeviceMemory> accumulationImageMemorys;
+    std::vector<VkImageView> accumulationImageViews;
+    std::vector<VkImage> revealageImages;
+    std::vector<VkDeviceMemory> revealageImageMemorys;
+    std::vector<VkImageView> revealageImageViews;
+    std::vector<VkFramebuffer> transparencyFramebuffers;
+    VkRenderPass transparencyRenderPass;
+    std::vector<VkImage> normalImages;
+    std::vector<VkDeviceMemory> normalImageMemorys;
+    std::vector<VkImageView> normalImageViews;
+    std::vector<VkImage> albedoImages;
+    std::vector<VkDeviceMemory> albedoImageMemorys;
+    std::vector<VkImageView> albedoImageViews;
+    std::vector<VkImage> linearDepthImages;
+    std::vector<VkDeviceMemory> linearDepthImageMemorys;
+    std::vector<VkImageView> linearDepthImageViews;
+    std::vector<VkFramebuffer> gbufferFramebuffers;
+    VkRenderPass gbufferRenderPass;
+    VkRenderPass gbufferLoadRenderPass;
+    std::vector<VkImage> lowResolutionColorImages;
+    std::vector<VkDeviceMemory> lowResolutionColorImageMemorys;
+    std::vector<VkImageView> lowResolutionColorImageViews;
+    std::vector<VkImage> lowResolutionDepthImages;
+    std::vector<VkDeviceMemory> lowResolutionDepthImageMemorys;
+    std::vector<VkImageView> lowResolutionDepthImageViews;
+    std::vector<VkFramebuffer> lowResolutionFramebuffers;
+    VkRenderPass lowResolutionRenderPass;
+    VkRenderPass upsampleRenderPass;
+
     std::vector<VkImage> swapChainImages;
     std::vector<VkImageView> swapChainImageViews;
 
@@ -5,6 +5,9 @@
 #include <engine/renderer/FrameInfo.h>
 #include <engine/scene/Scene.h>
 #include <engine/renderer/Descriptors.h>
+#include <engine/renderer/LayoutCache.h>
+#include <engine/renderer/BindlessTable.h>
+#include <engine/renderer/RenderQueue.h>
 
 #include <functional>
 
@@ -12,16 +15,45 @@ namespace Scop::Renderer::Systems {
   struct SystemInfo {
     Device& device;
     VkRenderPass renderPass;
+    VkRenderPass transparencyRenderPass;
+    VkRenderPass gbufferRenderPass;
+    VkRenderPass lowResolutionRenderPass;
+    VkRenderPass upsampleRenderPass;
+    LayoutCache& layoutCache;
+    BindlessTable& bindlessTable;
+    RenderQueue& renderQueue;
     VkDescriptorSetLayout globalDescriptorSetLayout;
+    // of the geometry pool the meshes are drawn from
+    Model::VertexLayout vertexLayout;
   };
-  class Base {
+  // Render systems push draw packets into the render queue and record them when
+  // the queue hands them back, sorted.
+  class Base : public RenderQueue::Owner {
   public:
-    ~Base();
+    // Every system declares the same push constant range and set layouts
+    // (0: global ubo, 1: bindless table) so their pipeline layouts stay compatible
+    // and the shared sets survive pipeline switches.
+    // 128 bytes is the minimum maxPushConstantsSize guaranteed by the spec.
+    static constexpr VkPushConstantRange SharedPushConstantRange{
+      VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, 128
+    };
+    static VkPipelineLayout GetSharedPipelineLayout(const SystemInfo& dependencies);
+
+    virtual ~Base();
     Base(const Base&) = delete;
     Base& operator=(const Base&) = delete;
 
-    virtual void render(const FrameInfo& frameInfo, Scene& scene) = 0;
+    virtual void enqueue(const FrameInfo& frameInfo, Scene& scene, RenderQueue& queue) = 0;
     virtual void update(const FrameInfo& frameInfo) = 0;
+
+    // Deferred shading, only for systems that built a g-buffer pipeline: draws then
+    // write the g-buffer render pass instead of shading in the swapchain pass
+    bool isDeferred() const { return this->deferred; }
+    void setDeferred(bool enabled) { this->deferred = enabled && this->gbufferPipeline; }
+    // Depth pre-pass, only for systems that built its pipelines: drawDepthPrepass lays
+    // down the depth first, draws then shade with an EQUAL test and no depth writes
+    bool isDepthPrepass() const { return this->depthPrepass; }
+    void setDepthPrepass(bool enabled) { this->depthPrepass = enabled && this->depthPipeline; }
   protected:
     Base(
       const SystemInfo& dependencies,
@@ -29,17 +61,45 @@ namespace Scop::Renderer::Systems {
       const std::string_view fragFilePath
     );
     void init(const SystemInfo& dependencies, std::function<void(Pipeline::ConfigInfo&)> pipelineCb = nullptr);
-    virtual void createPipelineLayout(VkDescriptorSetLayout globalDescriptorSetLayout) = 0;
+    virtual void createPipelineLayout(const SystemInfo& dependencies);
     virtual void createPipeline(
       VkRenderPass renderPass,
       std::function<void(Pipeline::ConfigInfo&)> cb = nullptr
     );
+    // Same vertex shader and layout as the main pipeline, on the g-buffer render pass
+    void createGBufferPipeline(VkRenderPass gbufferRenderPass, const std::string_view fragFilePath);
+    // Position only pipeline without fragment shader, and the main one with an EQUAL depth test
+    void createDepthPrepassPipelines(VkRenderPass renderPass, const std::string_view depthVertFilePath);
+    // Another shader pair on the layout and vertex input of this system
+    std::unique_ptr<Pipeline> createPipelineVariant(
+      VkRenderPass renderPass,
+      const std::string_view vertFilePath,
+      const std::string_view fragFilePath,
+      std::function<void(Pipeline::ConfigInfo&)> cb = nullptr
+    ) const;
+    // the pipeline matching the current render pass and mode
+    Pipeline& getPipeline() const {
+      if (this->deferred)
+        return *this->gbufferPipeline;
+      return this->depthPrepass ? *this->equalPipeline : *this->pipeline;
+    }
+    void bindGlobalDescriptorSet(const FrameInfo& frameInfo);
 
     Device& device;
+    RenderQueue& renderQueue;
+    // pipeline bits of this system's sort keys
+    const uint16_t queueId;
     std::unique_ptr<Pipeline> pipeline;
-    VkPipelineLayout pipelineLayout;
+    std::unique_ptr<Pipeline> gbufferPipeline;
+    std::unique_ptr<Pipeline> depthPipeline;
+    std::unique_ptr<Pipeline> equalPipeline;
+    // owned by the layout cache
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
   private:
     const std::string_view vertFilePath;
     const std::string_view fragFilePath;
+    const Model::VertexLayout vertexLayout;
+    bool deferred = false;
+    bool depthPrepass = false;
   };
-}
\ No newline at end of file
+}
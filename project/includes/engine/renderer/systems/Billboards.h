@@ -1,15 +1,125 @@
 #pragma once
 
+#include <engine/renderer/Impostors.h>
+#include <engine/renderer/MemBuffer.h>
+#include <engine/renderer/Swapchain.h>
+
+#include <array>
+#include <memory>
+#include <vector>
+
 #include "Base.h"
 
 namespace Scop::Renderer::Systems {
+  // All billboards go through the render queue as a single packet, written to a per-frame
+  // instance buffer and drawn with one instanced draw.
+  // Sorted back to front and alpha blended by default. The order independent mode skips the
+  // sort: billboards are accumulated in the transparency render pass (weighted blended OIT)
+  // and composited over the frame afterwards, sorting stays as the reference.
+  // Sorted billboards can also be drawn at half or quarter resolution, tested against the
+  // nearest depth of each footprint, then upsampled over the frame weighted by how close
+  // each low resolution depth is to the full resolution one.
+  // Distant meshes swapped for impostors come through here too: one more packet, drawn
+  // opaque at the start of the transparent pass with an instance buffer of their own,
+  // one instanced draw per atlas.
   class Billboards : public Base {
   public:
-    Billboards(const SystemInfo& deps);
+    static constexpr uint32_t INITIAL_INSTANCE_CAPACITY = 1024;
+    static constexpr uint32_t MAX_RESOLUTION_DIVISOR = 4;
+
+    Billboards(const SystemInfo& deps, const Impostors& impostors);
+    ~Billboards();
 
     void update(const FrameInfo&) {}
-    void render(const FrameInfo& frameInfo, Scene& scene);
+    void enqueue(const FrameInfo& frameInfo, Scene& scene, RenderQueue& queue) override;
+    void preparePackets(const FrameInfo& frameInfo, Scene& scene, std::span<const RenderQueue::Packet> packets) override;
+    void drawPackets(const FrameInfo& frameInfo, Scene& scene, std::span<const RenderQueue::Packet> packets) override;
+    // In a swapchain render pass, after the transparency render pass of the frame
+    void composite(const FrameInfo& frameInfo, VkImageView accumulationView, VkImageView revealageView);
+    // Outside of a render pass, after the main pass: the depth of the frame goes to
+    // DEPTH_STENCIL_READ_ONLY_OPTIMAL, the upsample render pass hands it back
+    void prepareLowResolution(
+      const FrameInfo& frameInfo,
+      VkImage depthImage,
+      VkFormat depthFormat,
+      VkImageView depthView,
+      VkImageView lowResolutionColorView,
+      VkImageView lowResolutionDepthView
+    );
+    // First in the low resolution render pass, before the packets of the pass are replayed
+    void downsampleDepth(const FrameInfo& frameInfo);
+    // In the upsample render pass
+    void upsample(const FrameInfo& frameInfo);
+
+    bool isOrderIndependent() const { return this->orderIndependent; }
+    void setOrderIndependent(bool enabled) { this->orderIndependent = enabled; }
+    // the order independent mode always draws at full resolution
+    bool isLowResolution() const { return this->resolutionDivisor > 1 && !this->orderIndependent; }
+    uint32_t getResolutionDivisor() const { return this->resolutionDivisor; }
+    // 1 is full resolution, rounded down to a power of two up to MAX_RESOLUTION_DIVISOR
+    void setResolutionDivisor(uint32_t divisor);
+    uint32_t getCount() const { return static_cast<uint32_t>(this->items.size()); }
+    uint32_t getImpostorCount() const { return static_cast<uint32_t>(this->impostorItems.size()); }
   private:
-    void createPipelineLayout(VkDescriptorSetLayout globalDescriptorSetLayout);
+    // payload of the impostor packet, the billboard one carries 0
+    static constexpr uint32_t IMPOSTOR_PAYLOAD = 1;
+
+    struct SortItem {
+      // inverted squared distance bits, back to front once sorted ascending
+      uint32_t key;
+      entt::entity entity;
+    };
+    struct ImpostorItem {
+      const Impostors::Atlas* atlas;
+      entt::entity entity;
+    };
+    // instances sharing an atlas, contiguous in the impostor instance buffer
+    struct ImpostorRun {
+      uint32_t firstInstance;
+      uint32_t instanceCount;
+      const Impostors::Atlas* atlas;
+    };
+    struct FrameInstances {
+      std::unique_ptr<MemBuffer> buffer;
+      uint32_t tableIndex = BindlessTable::INVALID_INDEX;
+    };
+    void reserveInstances(FrameInstances& instances, VkDeviceSize instanceSize, uint32_t count);
+    void prepareBillboards(const FrameInfo& frameInfo, Scene& scene);
+    void prepareImpostors(const FrameInfo& frameInfo, Scene& scene);
+    void drawBillboards(const FrameInfo& frameInfo);
+    void drawImpostors(const FrameInfo& frameInfo);
+
+    BindlessTable& bindlessTable;
+    std::array<FrameInstances, Swapchain::MAX_FRAMES_IN_FLIGHT> instances;
+    // reused every frame
+    std::vector<SortItem> items;
+    std::vector<SortItem> scratch;
+
+    const Impostors& impostors;
+    std::unique_ptr<Pipeline> impostorPipeline;
+    std::array<FrameInstances, Swapchain::MAX_FRAMES_IN_FLIGHT> impostorInstances;
+    // swapped this frame, grouped by atlas, reused every frame
+    std::vector<ImpostorItem> impostorItems;
+    std::vector<ImpostorRun> impostorRuns;
+
+    bool orderIndependent = false;
+    std::unique_ptr<Pipeline> weightedPipeline;
+    std::unique_ptr<Pipeline> compositePipeline;
+    // shared sets plus the two targets at set 2
+    VkPipelineLayout compositePipelineLayout = VK_NULL_HANDLE;
+    std::shared_ptr<DescriptorSetLayout> compositeSetLayout;
+    std::unique_ptr<DescriptorPool> compositePool;
+    // rewritten every frame, the targets follow the swapchain image
+    std::array<VkDescriptorSet, Swapchain::MAX_FRAMES_IN_FLIGHT> compositeSets{};
+    VkSampler sampler = VK_NULL_HANDLE;
+
+    uint32_t resolutionDivisor = 1;
+    std::unique_ptr<Pipeline> lowResolutionPipeline;
+    std::unique_ptr<Pipeline> depthDownsamplePipeline;
+    std::unique_ptr<Pipeline> upsamplePipeline;
+    // shared sets plus the depth of the frame and the low resolution targets at set 2
+    VkPipelineLayout lowResolutionPipelineLayout = VK_NULL_HANDLE;
+    std::shared_ptr<DescriptorSetLayout> lowResolutionSetLayout;
+    std::array<VkDescriptorSet, Swapchain::MAX_FRAMES_IN_FLIGHT> lowResolutionSets{};
   };
-}
\ No newline at end of file
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <engine/renderer/Swapchain.h>
+
+#include <array>
+#include <memory>
+
+#include "Base.h"
+
+namespace Scop::Renderer::Systems {
+  // Shading half of the deferred path. Opaque systems switched to deferred write the
+  // g-buffer render pass, resolve then shades every covered pixel once in a fullscreen
+  // pass: the ambient light plus the light list of the pixel's cluster (Systems::Lighting).
+  class DeferredLighting {
+  public:
+    DeferredLighting(const SystemInfo& deps);
+    ~DeferredLighting();
+    DeferredLighting(const DeferredLighting&) = delete;
+    DeferredLighting& operator=(const DeferredLighting&) = delete;
+
+    // In the lighting render pass, after the g-buffer render pass of the frame
+    void resolve(const FrameInfo& frameInfo, VkImageView normalView, VkImageView albedoView, VkImageView depthView);
+  private:
+    Device& device;
+    std::unique_ptr<Pipeline> pipeline;
+    // shared sets plus the g-buffer targets at set 2
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    std::shared_ptr<DescriptorSetLayout> setLayout;
+    std::unique_ptr<DescriptorPool> pool;
+    // rewritten every frame, the targets follow the swapchain image
+    std::array<VkDescriptorSet, Swapchain::MAX_FRAMES_IN_FLIGHT> sets{};
+    VkSampler sampler = VK_NULL_HANDLE;
+  };
+}
@@ -1,15 +1,107 @@
 #pragma once
 
+#include <engine/renderer/MemBuffer.h>
+#include <engine/renderer/Swapchain.h>
+
+#include <array>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
 #include "Base.h"
 
 namespace Scop::Renderer::Systems {
+  // Clustered forward lighting. Point lights go to a per-frame storage buffer and are
+  // binned on the CPU into view space froxels: CLUSTERS_X * CLUSTERS_Y screen tiles,
+  // CLUSTERS_Z exponential depth slices between the near and far planes.
+  // Fragments only walk the light list of their own cluster.
+  // Every light keeps its slot in the buffers until it is removed. Only the slots whose
+  // PointLight or Transform was emplaced, patched or destroyed since a frame slot was last
+  // written are uploaded to it, and the clusters only when the camera or a light changed.
   class Lighting {
   public:
-    Lighting() = default;
+    static constexpr uint32_t CLUSTERS_X = 16;
+    static constexpr uint32_t CLUSTERS_Y = 9;
+    static constexpr uint32_t CLUSTERS_Z = 24;
+    static constexpr uint32_t CLUSTER_COUNT = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+    static constexpr uint32_t INITIAL_LIGHT_CAPACITY = 256;
+
+    // std430 layout, matches Light in simple.frag
+    struct PointLightData {
+      glm::vec4 position; // w is the range
+      glm::vec4 color; // w is the intensity
+    };
+    // std430 layout, matches Cluster in simple.frag
+    struct ClusterData {
+      uint32_t offset; // into the light index buffer
+      uint32_t count;
+    };
+
+    Lighting(const SystemInfo& deps, Scene& scene);
+    ~Lighting();
+    Lighting(const Lighting&) = delete;
+    Lighting& operator=(const Lighting&) = delete;
 
+    // Before the global ubo of the frame is written, its projection and view must be set
     void update(FrameInfo& frameInfo, Scene& scene);
     void render(const FrameInfo&, Scene&) {}
+
+    uint32_t getLightCount() const { return static_cast<uint32_t>(this->lights.size()); }
+    // world space, by buffer slot
+    std::span<const PointLightData> getLights() const { return this->lights; }
+    // bumped whenever a point light is added, removed, moved or changed
+    uint32_t getVersion() const { return this->version; }
+    // light references over all clusters, a light covering n clusters counts n times
+    uint32_t getClusterReferenceCount() const { return static_cast<uint32_t>(this->lightIndices.size()); }
+    // bytes written to the storage buffers by the last update
+    VkDeviceSize getUploadBytes() const { return this->uploadBytes; }
   private:
+    struct FrameBuffer {
+      std::unique_ptr<MemBuffer> buffer;
+      uint32_t tableIndex = BindlessTable::INVALID_INDEX;
+    };
+    struct FrameBuffers {
+      FrameBuffer lights;
+      FrameBuffer clusters;
+      FrameBuffer lightIndices;
+      // update stamp of the last light write, cluster version of the last cluster write
+      uint64_t lightStamp = 0;
+      uint32_t clusterVersion = 0;
+    };
+    // true when the buffer was recreated, its content is lost
+    bool reserve(FrameBuffer& frameBuffer, VkDeviceSize elementSize, uint32_t count, uint32_t initialCapacity);
+    void onEdit(entt::registry& registry, entt::entity entity);
+    // moves the pending entities into their slots, true when a light changed
+    bool applyEdits(entt::registry& registry);
+    void uploadLights(FrameBuffers& frame);
+    // the cluster depth of the ubo must be set
+    void buildClusters(const GlobalUbo& ubo);
+
+    Scene& scene;
+    Device& device;
+    BindlessTable& bindlessTable;
+    std::array<FrameBuffers, Swapchain::MAX_FRAMES_IN_FLIGHT> frames;
+    // by slot, with the stamp of the update that last changed it
+    std::vector<PointLightData> lights;
+    std::vector<uint64_t> lightStamps;
+    std::vector<entt::entity> slotEntities;
+    std::unordered_map<entt::entity, uint32_t> slots;
+    // lights emplaced, patched or destroyed since the last update, may repeat
+    std::vector<entt::entity> pending;
+    uint64_t stamp = 0;
+    // reused every frame
+    std::vector<ClusterData> clusters;
+    std::vector<uint32_t> lightIndices;
+    // inputs of the current clusters
+    glm::mat4 clusterView{ 0.f };
+    glm::mat4 clusterProjection{ 0.f };
+    uint32_t clusterLightVersion = 0;
+    // bumped whenever the clusters are rebuilt
+    uint32_t clusterVersion = 0;
+    uint32_t version = 0;
+    VkDeviceSize uploadBytes = 0;
+
     bool rotateLight = false;
   };
-}
\ No newline at end of file
+}
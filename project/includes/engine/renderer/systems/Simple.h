@@ -3,7 +3,15 @@
 #include <engine/renderer/Device.h>
 #include <engine/renderer/Renderer.h>
 #include <engine/renderer/Pipeline.h>
+#include <engine/renderer/ComputePipeline.h>
+#include <engine/renderer/DepthPyramid.h>
+#include <engine/renderer/FrustumCuller.h>
+#include <engine/renderer/GeometryPool.h>
+#include <engine/renderer/Impostors.h>
+#include <engine/renderer/MemBuffer.h>
 #include <memory>
+#include <array>
+#include <vector>
 #include <engine/scene/Scene.h>
 #include <engine/renderer/FrameInfo.h>
 
@@ -12,13 +20,184 @@
 namespace Scop::Renderer::Systems {
   class Simple : public Base {
   public:
-    Simple(const SystemInfo& dependencies);
-    // ~Simple();
+    static constexpr uint32_t INITIAL_INSTANCE_CAPACITY = 256;
+    static constexpr uint32_t CULL_GROUP_SIZE = 64;
+    static constexpr uint32_t FILTER_GROUP_SIZE = 64;
+    // models with at least this many triangles go through the triangle filter when it is on
+    static constexpr uint32_t FILTER_MIN_TRIANGLES = 1 << 15;
+
+    // std430 layout, matches Instance in simple.vert and cull.comp
+    struct InstanceData {
+      glm::mat4 modelMatrix{ 1.0f };
+      // mat3 stored in the upper left of a mat4 to avoid std430 column padding rules
+      glm::mat4 normalMatrix{ 1.0f };
+      glm::vec4 color{ 1.0f };
+      // model space, xyz center and w radius
+      glm::vec4 boundingSphere{ 0.0f };
+      // x: indirect command the instance belongs to, y: entity
+      glm::uvec4 info{ 0 };
+    };
+
+    // Meshes the impostors find distant are left to Systems::Billboards
+    Simple(const SystemInfo& dependencies, GeometryPool& geometryPool, const Impostors& impostors);
+    ~Simple();
     // Simple(const Simple&) = delete;
     // Simple& operator=(const Simple&) = delete;
     void update(const FrameInfo&) {}
-    void render(const FrameInfo& frameInfo, Scene& scene);
+    void enqueue(const FrameInfo& frameInfo, Scene& scene, RenderQueue& queue) override;
+    void preparePackets(const FrameInfo& frameInfo, Scene& scene, std::span<const RenderQueue::Packet> packets) override;
+    void drawPackets(const FrameInfo& frameInfo, Scene& scene, std::span<const RenderQueue::Packet> packets) override;
+
+    // Indirect mode submits every model of a run from one indirect draw instead of one draw each
+    bool isIndirectSupported() const { return this->device.getOptionalFeatures().drawIndirectFirstInstance; }
+    bool isIndirectDraw() const { return this->indirectDraw; }
+    void setIndirectDraw(bool enabled) { this->indirectDraw = enabled && this->isIndirectSupported(); }
+    // GPU frustum culling fills the indirect commands, so it only runs in indirect mode
+    bool isCulling() const { return this->culling && this->indirectDraw; }
+    void setCulling(bool enabled) { this->culling = enabled; }
+    // flips the requested state, which holds while indirect mode is off
+    void toggleCulling() { this->culling = !this->culling; }
+    // Two-phase occlusion culling on top of frustum culling: prepare only draws what was
+    // visible last frame, cullOcclusion tests everything against the depth pyramid built
+    // from it and drawLate draws what the first phase missed
+    bool isOcclusionCulling() const { return this->occlusion && this->isCulling(); }
+    void setOcclusionCulling(bool enabled) { this->occlusion = enabled; }
+    void toggleOcclusionCulling() { this->occlusion = !this->occlusion; }
+    // Outside of the render pass, after the pyramid has been built from the early draws
+    void cullOcclusion(const FrameInfo& frameInfo, const DepthPyramid& pyramid);
+    void drawLate(const FrameInfo& frameInfo);
+    // Depth of every prepared batch, late draws the commands drawLate will shade
+    void drawDepthPrepass(const FrameInfo& frameInfo, bool late = false);
+    // Every instance of a dense model gets its own draw of the triangles a compute pass kept:
+    // front facing, in the frustum and covering a sample. Skips instance culling, treats the
+    // meshes as closed. Like GPU culling it only runs in indirect mode
+    bool isTriangleFiltering() const { return this->triangleFiltering && this->indirectDraw; }
+    void setTriangleFiltering(bool enabled) { this->triangleFiltering = enabled; }
+    void toggleTriangleFiltering() { this->triangleFiltering = !this->triangleFiltering; }
+    // from the last completed frame that filtered
+    uint32_t getFilterTestedTriangles() const { return this->filterTestedTriangles; }
+    uint32_t getFilterCulledTriangles() const { return this->filterCulledTriangles; }
+
+    // Frustum culling on the CPU in enqueue, culled entities never reach the render queue
+    bool isCpuCulling() const { return this->cpuCulling; }
+    void setCpuCulling(bool enabled) { this->cpuCulling = enabled; }
+    void setCpuCullThreads(uint32_t threads) { this->cpuCullThreads = threads; }
+    uint32_t getCpuCulled() const { return this->cpuCulled; }
+    // objects tested per microsecond, last frame
+    float getCpuCullRate() const {
+      return this->cpuCullMicroseconds > 0.0f ? this->cullEntities.size() / this->cpuCullMicroseconds : 0.0f;
+    }
+
+    uint32_t getSubmittedInstances() const { return this->instanceCount; }
+    // from the last completed frame that culled
+    uint32_t getVisibleInstances() const { return this->visibleInstances; }
+    uint32_t getFrustumCulled() const { return this->frustumCulled; }
+    uint32_t getOcclusionCulled() const { return this->occlusionCulled; }
   private:
-    void createPipelineLayout(VkDescriptorSetLayout globalDescriptorSetLayout);
+    // per-instance data, reached by the shaders through the bindless table
+    // and indexed with gl_InstanceIndex
+    struct FrameInstances {
+      std::unique_ptr<MemBuffer> buffer;
+      uint32_t tableIndex = BindlessTable::INVALID_INDEX;
+      // visible instances compacted by the cull pass, per model run
+      std::unique_ptr<MemBuffer> culled;
+      uint32_t culledTableIndex = BindlessTable::INVALID_INDEX;
+    };
+    void reserveInstances(FrameInstances& instances, uint32_t count);
+    // VkDrawIndexedIndirectCommand records, host written every frame
+    struct FrameIndirect {
+      std::unique_ptr<MemBuffer> commands;
+      uint32_t tableIndex = BindlessTable::INVALID_INDEX;
+      // counters bumped by the cull and filter passes, see StatsBuffer in triangle_filter.comp
+      std::unique_ptr<MemBuffer> stats;
+      uint32_t statsTableIndex = BindlessTable::INVALID_INDEX;
+      bool culled = false;
+    };
+    void reserveIndirect(FrameIndirect& indirect, uint32_t count);
+    // compacted indices and one draw command per filtered instance, see triangle_filter.comp
+    struct FrameFilter {
+      std::unique_ptr<MemBuffer> indices;
+      uint32_t indicesTableIndex = BindlessTable::INVALID_INDEX;
+      std::unique_ptr<MemBuffer> commands;
+      uint32_t commandsTableIndex = BindlessTable::INVALID_INDEX;
+      // the geometry pool as this frame slot sees it, pointed at the new buffers when it grows
+      uint32_t poolIndicesTableIndex = BindlessTable::INVALID_INDEX;
+      uint32_t poolPositionsTableIndex = BindlessTable::INVALID_INDEX;
+      uint32_t poolGeneration = ~0u;
+      bool filtered = false;
+    };
+    void reserveFilter(FrameFilter& filter, uint32_t commandCount, uint32_t indexCount);
+    void updatePoolTable(FrameFilter& filter);
+    bool isFiltered(const Model& model) const {
+      return this->isTriangleFiltering() && model.getTriangleCount() >= FILTER_MIN_TRIANGLES;
+    }
+    void reserveVisibility(uint32_t count);
+    void collectCullResults(FrameIndirect& indirect, FrameFilter& filter);
+
+    // commands prepared for one drawPackets call
+    struct Batch {
+      uint32_t firstInstance;
+      uint32_t instanceCount;
+      uint32_t firstCommand;
+      uint32_t commandCount;
+      // filtered instances sit after the culled ones, these are their commands in the frame filter
+      uint32_t firstFiltered;
+      uint32_t filteredCount;
+      // any model of the batch, they all bind the shared geometry pool
+      Model* geometry;
+    };
+    enum class CullPhase : uint32_t {
+      Frustum = 0,
+      Early = 1,
+      Late = 2,
+    };
+    void dispatchCulling(const FrameInfo& frameInfo, const Batch& batch, CullPhase phase, const DepthPyramid* pyramid = nullptr);
+    void dispatchFilter(const FrameInfo& frameInfo, const Model& model, uint32_t instance, uint32_t command, uint32_t outputOffset);
+    void drawIndirect(CommandRecorder& recorder, const MemBuffer& commands, uint32_t firstCommand, uint32_t drawCount);
+    void bindForDraw(const FrameInfo& frameInfo, Pipeline& pipeline);
+    void drawBatch(const FrameInfo& frameInfo, const Batch& batch, uint32_t firstCommand);
+    void drawFiltered(const FrameInfo& frameInfo, const Batch& batch);
+
+    BindlessTable& bindlessTable;
+    VkPipelineLayout cullPipelineLayout = VK_NULL_HANDLE;
+    std::unique_ptr<ComputePipeline> cullPipeline;
+    GeometryPool& geometryPool;
+    const Impostors& impostors;
+    VkPipelineLayout filterPipelineLayout = VK_NULL_HANDLE;
+    std::unique_ptr<ComputePipeline> filterPipeline;
+    std::array<FrameFilter, Swapchain::MAX_FRAMES_IN_FLIGHT> filters;
+    // filter commands and compacted indices written so far this frame
+    uint32_t filterCommandCount = 0;
+    uint32_t filterIndexCount = 0;
+    std::array<FrameInstances, Swapchain::MAX_FRAMES_IN_FLIGHT> instances;
+    std::array<FrameIndirect, Swapchain::MAX_FRAMES_IN_FLIGHT> indirect;
+    // per entity, whether the late phase found it visible. Shared by every frame in
+    // flight, frames run in submission order on the queue.
+    std::unique_ptr<MemBuffer> visibility;
+    uint32_t visibilityTableIndex = BindlessTable::INVALID_INDEX;
+    FrustumCuller culler;
+    // culler index to entity
+    std::vector<entt::entity> cullEntities;
+    std::vector<uint32_t> cullVisible;
+    std::vector<VkDrawIndexedIndirectCommand> drawCommands;
+    std::vector<Batch> batches;
+    size_t nextBatch = 0;
+    // queued this frame, late commands and instances are stored this far after the early ones
+    uint32_t queuedInstances = 0;
+    // written so far this frame
+    uint32_t instanceCount = 0;
+    bool indirectDraw = false;
+    bool culling = true;
+    bool occlusion = true;
+    bool cpuCulling = true;
+    uint32_t cpuCullThreads = 1;
+    uint32_t cpuCulled = 0;
+    float cpuCullMicroseconds = 0.0f;
+    uint32_t visibleInstances = 0;
+    uint32_t frustumCulled = 0;
+    uint32_t occlusionCulled = 0;
+    bool triangleFiltering = false;
+    uint32_t filterTestedTriangles = 0;
+    uint32_t filterCulledTriangles = 0;
   };
-}
\ No newline at end of file
+}
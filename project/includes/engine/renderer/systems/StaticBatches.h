@@ -0,0 +1,98 @@
+#pragma once
+
+#include <engine/renderer/CommandCache.h>
+#include <engine/renderer/GeometryPool.h>
+#include <engine/renderer/MemBuffer.h>
+#include <engine/renderer/Model.h>
+
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "Base.h"
+#include "Lighting.h"
+
+namespace Scop::Renderer::Systems {
+  // Merges the meshes of every Components::Static entity into one world space allocation
+  // of the geometry pool, drawn with a single indexed draw through the simple shaders.
+  // Static entities skip the simple system entirely, so they cost no per-frame instance upload.
+  // The batch is rebuilt (waiting for the device) when a static entity is added, removed
+  // or has its Transform or Mesh patched.
+  // With caching on, the batch is not queued: executeCached replays a secondary command
+  // buffer that is only recorded again when the batch, the pool or the render pass changes.
+  // With baked lighting on, the diffuse sum of the point lights is evaluated per vertex on
+  // worker threads and the forward pass reads it back with a cheaper, diffuse only shader.
+  // The bake is stale whenever the batch is rebuilt or a light changes, and is only redone
+  // once the lights have held still for a frame; the live shaders are used meanwhile.
+  class StaticBatches : public Base {
+  public:
+    // below this many vertices per thread, spawning threads costs more than it saves
+    static constexpr uint32_t MIN_BAKE_VERTICES_PER_THREAD = 4096;
+
+    StaticBatches(const SystemInfo& deps, Scene& scene, GeometryPool& geometryPool);
+    ~StaticBatches();
+
+    void update(const FrameInfo&) {}
+    void enqueue(const FrameInfo& frameInfo, Scene& scene, RenderQueue& queue) override;
+    void drawPackets(const FrameInfo& frameInfo, Scene& scene, std::span<const RenderQueue::Packet> packets) override;
+    // In a render pass begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS, after enqueue
+    void executeCached(const FrameInfo& frameInfo, VkRenderPass renderPass, VkExtent2D extent);
+    // Always inline, the cached commands only hold the shading draw
+    void drawDepthPrepass(const FrameInfo& frameInfo);
+    // After enqueue and the lighting update, before anything is recorded
+    void bakeLighting(const Lighting& lighting);
+
+    bool isCaching() const { return this->caching; }
+    void setCaching(bool enabled) { this->caching = enabled; }
+    bool isEmpty() const { return this->allocation.indexCount == 0; }
+    bool isBakedLighting() const { return this->bakedLighting; }
+    void setBakedLighting(bool enabled) { this->bakedLighting = enabled; }
+    // the baked shaders are in use this frame
+    bool isBaked() const { return this->bakedLighting && this->bakeValid; }
+
+    uint32_t getEntityCount() const { return this->entityCount; }
+    uint32_t getRebuildCount() const { return this->rebuildCount; }
+    uint32_t getCachedRecordCount() const { return this->commandCache.getRecordCount(); }
+    uint32_t getBakeCount() const { return this->bakeCount; }
+    float getBakeTime() const { return this->bakeTime; }
+  private:
+    void rebuild(Scene& scene);
+    void invalidate(entt::registry&, entt::entity) { this->dirty = true; }
+    void onEdit(entt::registry& registry, entt::entity entity);
+    void draw(const FrameInfo& frameInfo, Pipeline& pipeline);
+    void bake(std::span<const Lighting::PointLightData> lights);
+    void bakeRange(std::span<const Lighting::PointLightData> lights, uint32_t first, uint32_t last);
+    // forward shading, baked when the bake is valid
+    Pipeline& getShadingPipeline() const;
+
+    Scene& scene;
+    GeometryPool& geometryPool;
+    BindlessTable& bindlessTable;
+    // a single identity instance, the vertices are already in world space
+    std::unique_ptr<MemBuffer> instance;
+    uint32_t instanceTableIndex = BindlessTable::INVALID_INDEX;
+    // every mesh goes through the simple pipeline, so there is one batch
+    GeometryPool::Allocation allocation{};
+    std::vector<Model::Vertex> vertices;
+    std::vector<uint32_t> indices;
+    uint32_t entityCount = 0;
+    uint32_t rebuildCount = 0;
+    bool dirty = true;
+    bool caching = true;
+    CommandCache commandCache;
+
+    std::unique_ptr<Pipeline> bakedPipeline;
+    std::unique_ptr<Pipeline> bakedEqualPipeline;
+    // one per vertex of the batch, xyz is the diffuse irradiance
+    std::vector<glm::vec4> irradiance;
+    std::unique_ptr<MemBuffer> irradianceBuffer;
+    uint32_t irradianceTableIndex = BindlessTable::INVALID_INDEX;
+    bool bakedLighting = false;
+    bool bakeValid = false;
+    uint32_t bakedRebuild = 0;
+    uint32_t bakedLightVersion = 0;
+    uint32_t seenLightVersion = ~0u;
+    uint32_t bakeCount = 0;
+    float bakeTime = 0.0f;
+  };
+}
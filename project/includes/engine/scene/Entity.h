@@ -48,6 +48,14 @@ namespace Scop {
       return this->scene->registry.get<Component>(this->handle);
     }
 
+    // Notifies the update listeners of the component, static batches among them
+    template<typename Component, typename... Func>
+    Component& patchComponent(Func&&... func) {
+      assert(this->scene && "Entity doesn't belong to a scene");
+      assert(this->hasComponent<Component>() && "Entity does not have component");
+      return this->scene->registry.patch<Component>(this->handle, std::forward<Func>(func)...);
+    }
+
     template<typename ...Components>
     bool hasComponent() const {
       assert(this->scene && "Entity doesn't belong to a scene");
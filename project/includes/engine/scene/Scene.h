@@ -38,6 +38,11 @@ namespace Scop {
       return this->registry.view<Components...>();
     }
 
+    template<typename ...Components, typename ...Excluded>
+    auto viewEntitiesWith(entt::exclude_t<Excluded...> excluded) {
+      return this->registry.view<Components...>(excluded);
+    }
+
   private:
     uint64_t id = 0;
     entt::registry registry;
@@ -0,0 +1,7 @@
+#pragma once
+
+namespace Scop::Components {
+  // Never moves once loaded: the mesh is merged into a static batch in world space.
+  // Edit the Transform or Mesh of a static entity through patch/replace so the batch is rebuilt.
+  struct Static {};
+}
@@ -5,4 +5,5 @@
 #include "Mesh.h"
 #include "Camera.h"
 #include "RigidBody2D.h"
-#include "Billboard.h"
\ No newline at end of file
+#include "Billboard.h"
+#include "Static.h"
\ No newline at end of file
@@ -1,5 +1,10 @@
 #pragma once
 
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
 namespace Scop {
   class Profiler {
   public:
@@ -9,8 +14,12 @@ namespace Scop {
     virtual ~Profiler() = default;
 
     void update(float deltaTime);
+    // Named counter printed along with the frame time, keeps the latest value
+    void set(std::string_view name, double value);
+    bool isEnabled() const { return this->enabled; }
   private:
     bool enabled = false;
     float lastOutput = 0.f;
+    std::vector<std::pair<std::string, double>> counters;
   };
-}
\ No newline at end of file
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Scop::Utils {
+  // Stable LSD radix sort on an unsigned integer key, one byte per pass.
+  // Passes where every item shares the same digit are skipped, so narrow keys stay cheap.
+  // scratch is only used as storage to avoid reallocating every call.
+  template <typename T, typename KeyFn>
+  void RadixSort(std::vector<T>& items, std::vector<T>& scratch, KeyFn key) {
+    using Key = decltype(key(items[0]));
+    static_assert(std::is_unsigned_v<Key>, "radix sort key must be unsigned");
+    if (items.size() < 2)
+      return;
+    scratch.resize(items.size());
+
+    std::vector<T>* src = &items;
+    std::vector<T>* dst = &scratch;
+    for (uint32_t shift = 0; shift < sizeof(Key) * 8; shift += 8) {
+      std::array<size_t, 256> offsets{};
+      for (const auto& item : *src)
+        offsets[(key(item) >> shift) & 0xff]++;
+      if (offsets[(key((*src)[0]) >> shift) & 0xff] == src->size())
+        continue;
+
+      size_t total = 0;
+      for (auto& offset : offsets) {
+        size_t count = offset;
+        offset = total;
+        total += count;
+      }
+      for (const auto& item : *src)
+        (*dst)[offsets[(key(item) >> shift) & 0xff]++] = item;
+      std::swap(src, dst);
+    }
+    if (src != &items)
+      items.swap(scratch);
+  }
+}
@@ -11,7 +11,8 @@ project "Scop"
   files {
     "src/**.cpp",
     "shaders/**.vert",
-    "shaders/**.frag"
+    "shaders/**.frag",
+    "shaders/**.comp"
   }
 
   defines {
@@ -52,6 +53,9 @@ project "Scop"
     links {
       "vulkan"
     }
+  filter "options:avx2"
+    vectorextensions "AVX2"
+
   filter "configurations:debug"
     defines { "DEBUG" }
     runtime "Debug"
@@ -62,7 +66,7 @@ project "Scop"
     runtime "Release"
     optimize "On"
 
-  filter { "files:**.vert or **.frag"}
+  filter { "files:**.vert or **.frag or **.comp"}
     buildmessage "Compiling %{file.relpath}"
     buildcommands {
       "{MKDIR} %[%{cfg.targetdir}/shaders]",
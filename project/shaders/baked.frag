@@ -0,0 +1,27 @@
+#version 450
+
+// Diffuse only: baked point light irradiance plus the live ambient term, no specular
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec3 fragIrradiance;
+layout(location = 2) flat in vec3 fragTint;
+
+layout(location = 0) out vec4 outColor;
+
+struct Light {
+  vec4 color;
+  float range; // unused
+  vec4 position;
+};
+
+layout (set = 0, binding = 0) uniform GlobalUbo {
+  mat4 projection;
+  mat4 view;
+  mat4 projectionView;
+  mat4 inverseView;
+  Light ambientLight;
+} ubo;
+
+void main() {
+  vec3 diffuseLight = ubo.ambientLight.color.rgb * ubo.ambientLight.color.a + fragIrradiance;
+  outColor = vec4(diffuseLight * fragColor * fragTint, 1.0);
+}
@@ -0,0 +1,53 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// simple.vert with the point light diffuse sum read from the irradiance baked by Systems::StaticBatches
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 color;
+layout (location = 2) in vec3 normal;
+layout (location = 3) in vec2 uv;
+
+layout (location = 0) out vec3 fragColor;
+layout (location = 1) out vec3 fragIrradiance;
+layout (location = 2) flat out vec3 fragTint;
+
+layout (push_constant) uniform PushConstantData {
+  uint instanceBuffer; // bindless storage buffer indices
+  uint irradianceBuffer;
+  uint firstVertex; // of the batch, the irradiance starts there
+} pushData;
+
+struct Instance {
+  mat4 modelMatrix;
+  mat4 normalMatrix; // mat3 in the upper left
+  vec4 color;
+  vec4 boundingSphere; // read by cull.comp
+  uvec4 info;
+};
+
+layout (set = 1, binding = 1) readonly buffer InstanceBuffer {
+  Instance instances[];
+} instanceBuffers[];
+
+layout (set = 1, binding = 1) readonly buffer IrradianceBuffer {
+  vec4 irradiance[];
+} irradianceBuffers[];
+
+layout (set = 0, binding = 0) uniform GlobalUbo {
+  mat4 projection;
+  mat4 view;
+  mat4 projectionView;
+} ubo;
+
+// matches depth_prepass.vert bit for bit
+invariant gl_Position;
+
+void main() {
+  Instance instance = instanceBuffers[pushData.instanceBuffer].instances[gl_InstanceIndex];
+  vec4 worldPosition = instance.modelMatrix * vec4(position, 1.0);
+  gl_Position = ubo.projectionView * worldPosition;
+
+  fragColor = color;
+  fragIrradiance = irradianceBuffers[pushData.irradianceBuffer].irradiance[gl_VertexIndex - pushData.firstVertex].rgb;
+  fragTint = instance.color.rgb;
+}
@@ -1,17 +1,10 @@
 #version 450
 
 layout(location = 0) in vec2 fragOffset;
+layout(location = 1) flat in vec4 fragColor;
+layout(location = 2) flat in uint fragRounded;
 layout(location = 0) out vec4 outColor;
 
-layout (push_constant) uniform PushConstantData {
-  vec4 position;
-  vec4 color;
-  float width;
-  float height;
-  bool rounded;
-} pushData;
-
-# define MAX_LIGHTS 16
 struct Light {
   vec4 color;
   float range; // unused
@@ -24,16 +17,20 @@ layout (set = 0, binding = 0) uniform GlobalUbo {
   mat4 projectionView;
   mat4 inverseView;
   Light ambientLight;
-  Light pointLights[MAX_LIGHTS];
-  int numPointLights;
+  uint pointLightCount;
+  uint lightBuffer; // bindless storage buffer indices
+  uint clusterBuffer;
+  uint lightIndexBuffer;
+  uvec4 clusterGrid;
+  vec4 clusterDepth; // x: scale, y: bias of the depth slice from log(depth)
 } ubo;
 
 const float M_PI = 3.14159265359;
 
 void main() {
     float distance = sqrt(dot(fragOffset, fragOffset));
-  if (pushData.rounded && distance >= 1.0)
+  if (fragRounded != 0 && distance >= 1.0)
       discard;
   float cosDistance =  0.5 * (cos(distance * M_PI) + 1.0);
-  outColor = vec4(pushData.color.rgb + cosDistance, cosDistance);
+  outColor = vec4(fragColor.rgb + cosDistance, cosDistance);
 }
\ No newline at end of file
@@ -1,12 +1,20 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout (push_constant) uniform PushConstantData {
+  uint instanceBuffer; // bindless storage buffer index
+} pushData;
+
+struct Instance {
   vec4 position;
   vec4 color;
-  float width;
-  float height;
-  bool rounded;
-} pushData;
+  vec2 size;
+  uint rounded;
+};
+
+layout (set = 1, binding = 1) readonly buffer InstanceBuffer {
+  Instance instances[];
+} instanceBuffers[];
 
 const vec2 OFFSETS[6] = vec2[](
   vec2(-1.0, -1.0),
@@ -18,8 +26,9 @@ const vec2 OFFSETS[6] = vec2[](
 );
 
 layout(location = 0) out vec2 fragOffset;
+layout(location = 1) flat out vec4 fragColor;
+layout(location = 2) flat out uint fragRounded;
 
-# define MAX_LIGHTS 16
 struct Light {
   vec4 color;
   float range; // unused
@@ -32,18 +41,25 @@ layout (set = 0, binding = 0) uniform GlobalUbo {
   mat4 projectionView;
   mat4 inverseView;
   Light ambientLight;
-  Light pointLights[MAX_LIGHTS];
-  int numPointLights;
+  uint pointLightCount;
+  uint lightBuffer; // bindless storage buffer indices
+  uint clusterBuffer;
+  uint lightIndexBuffer;
+  uvec4 clusterGrid;
+  vec4 clusterDepth; // x: scale, y: bias of the depth slice from log(depth)
 } ubo;
 
 void main() {
+  Instance instance = instanceBuffers[pushData.instanceBuffer].instances[gl_InstanceIndex];
+  fragColor = instance.color;
+  fragRounded = instance.rounded;
   fragOffset = OFFSETS[gl_VertexIndex];
   vec3 camWorldRight = {ubo.view[0][0], ubo.view[1][0], ubo.view[2][0]};
   vec3 camWorldUp = {ubo.view[0][1], ubo.view[1][1], ubo.view[2][1]};
 
-  vec4 worldPosition = vec4(pushData.position.xyz
-    + pushData.width * fragOffset.x * camWorldRight
-    + pushData.height * fragOffset.y * camWorldUp, 1.0);
+  vec4 worldPosition = vec4(instance.position.xyz
+    + instance.size.x * fragOffset.x * camWorldRight
+    + instance.size.y * fragOffset.y * camWorldUp, 1.0);
 
   gl_Position = ubo.projectionView * worldPosition;
 
@@ -0,0 +1,41 @@
+#version 450
+
+struct Light {
+  vec4 color;
+  float range; // unused
+  vec4 position;
+};
+
+layout (set = 0, binding = 0) uniform GlobalUbo {
+  mat4 projection;
+  mat4 view;
+  mat4 projectionView;
+  mat4 inverseView;
+  Light ambientLight;
+  uint pointLightCount;
+  uint lightBuffer; // bindless storage buffer indices
+  uint clusterBuffer;
+  uint lightIndexBuffer;
+  uvec4 clusterGrid;
+  vec4 clusterDepth; // x: scale, y: bias of the depth slice from log(depth)
+  vec4 viewport; // xy: rendered size, the targets may be larger
+} ubo;
+
+layout (set = 2, binding = 0) uniform sampler2D depthTexture;
+
+layout(push_constant) uniform Push {
+  uint divisor;
+} push;
+
+// the nearest depth of the footprint: billboards never cover geometry in front of them,
+// pixels behind it get theirs from the neighbouring texels in the upsample
+void main() {
+  int divisor = int(push.divisor);
+  ivec2 first = ivec2(gl_FragCoord.xy) * divisor;
+  ivec2 last = min(first + divisor, ivec2(ubo.viewport.xy)) - 1;
+  float depth = 1.0;
+  for (int y = first.y; y <= last.y; y++)
+    for (int x = first.x; x <= last.x; x++)
+      depth = min(depth, texelFetch(depthTexture, ivec2(x, y), 0).r);
+  gl_FragDepth = depth;
+}
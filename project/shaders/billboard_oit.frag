@@ -0,0 +1,26 @@
+#version 450
+
+layout(location = 0) in vec2 fragOffset;
+layout(location = 1) flat in vec4 fragColor;
+layout(location = 2) flat in uint fragRounded;
+layout(location = 0) out vec4 outAccumulation;
+layout(location = 1) out float outRevealage;
+
+const float M_PI = 3.14159265359;
+
+// weighted blended order independent transparency (McGuire and Bavoil), same shading as billboard.frag
+void main() {
+  float distance = sqrt(dot(fragOffset, fragOffset));
+  if (fragRounded != 0 && distance >= 1.0)
+    discard;
+  float cosDistance = 0.5 * (cos(distance * M_PI) + 1.0);
+  vec4 color = vec4(fragColor.rgb + cosDistance, cosDistance);
+
+  // closer and more opaque fragments weigh more, clamped to stay within half floats
+  float weight = clamp(
+    pow(min(1.0, color.a * 10.0) + 0.01, 3.0) * 1e8 * pow(1.0 - gl_FragCoord.z * 0.9, 3.0),
+    1e-2, 3e3
+  );
+  outAccumulation = vec4(color.rgb * color.a, color.a) * weight;
+  outRevealage = color.a;
+}
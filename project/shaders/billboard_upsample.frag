@@ -0,0 +1,70 @@
+#version 450
+
+layout(location = 0) out vec4 outColor;
+
+struct Light {
+  vec4 color;
+  float range; // unused
+  vec4 position;
+};
+
+layout (set = 0, binding = 0) uniform GlobalUbo {
+  mat4 projection;
+  mat4 view;
+  mat4 projectionView;
+  mat4 inverseView;
+  Light ambientLight;
+  uint pointLightCount;
+  uint lightBuffer; // bindless storage buffer indices
+  uint clusterBuffer;
+  uint lightIndexBuffer;
+  uvec4 clusterGrid;
+  vec4 clusterDepth; // x: scale, y: bias of the depth slice from log(depth)
+  vec4 viewport; // xy: rendered size, the targets may be larger
+} ubo;
+
+layout (set = 2, binding = 0) uniform sampler2D depthTexture;
+layout (set = 2, binding = 1) uniform sampler2D colorTexture; // a is the transmittance
+layout (set = 2, binding = 2) uniform sampler2D lowDepthTexture;
+
+layout(push_constant) uniform Push {
+  uint divisor;
+} push;
+
+// relative depth difference at which a texel weighs as much as half its bilinear weight
+const float DEPTH_TOLERANCE = 0.01;
+
+// view depth from the [0, 1] depth, clip w is the depth
+float viewDepth(float depth) {
+  mat4 p = ubo.projection;
+  return (p[3][2] - depth * p[3][3]) / (depth * p[2][3] - p[2][2]);
+}
+
+// blended over the frame with (1, src alpha): color plus the frame times the transmittance
+void main() {
+  int divisor = int(push.divisor);
+  ivec2 lowExtent = (ivec2(ubo.viewport.xy) + divisor - 1) / divisor;
+  float depth = viewDepth(texelFetch(depthTexture, ivec2(gl_FragCoord.xy), 0).r);
+
+  // bilinear over the 2x2 low resolution texels around the pixel, scaled down for the texels
+  // of another surface; one of them still counts when they all are
+  vec2 position = gl_FragCoord.xy / float(divisor) - 0.5;
+  ivec2 base = ivec2(floor(position));
+  vec2 f = position - vec2(base);
+  vec4 sum = vec4(0.0);
+  float weightSum = 0.0;
+  for (int i = 0; i < 4; i++) {
+    ivec2 offset = ivec2(i & 1, i >> 1);
+    ivec2 texel = clamp(base + offset, ivec2(0), lowExtent - 1);
+    vec2 bilinear = mix(1.0 - f, f, vec2(offset));
+    float lowDepth = viewDepth(texelFetch(lowDepthTexture, texel, 0).r);
+    float similarity = DEPTH_TOLERANCE / (DEPTH_TOLERANCE + abs(depth - lowDepth) / depth);
+    float weight = max(bilinear.x * bilinear.y, 1e-3) * similarity;
+    sum += weight * texelFetch(colorTexture, texel, 0);
+    weightSum += weight;
+  }
+  vec4 result = sum / weightSum;
+  if (result.a >= 1.0)
+    discard;
+  outColor = result;
+}
@@ -0,0 +1,103 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) out vec4 outColor;
+
+struct Light {
+  vec4 color;
+  float range; // unused
+  vec4 position;
+};
+
+layout (set = 0, binding = 0) uniform GlobalUbo {
+  mat4 projection;
+  mat4 view;
+  mat4 projectionView;
+  mat4 inverseView;
+  Light ambientLight;
+  uint pointLightCount;
+  uint lightBuffer; // bindless storage buffer indices
+  uint clusterBuffer;
+  uint lightIndexBuffer;
+  uvec4 clusterGrid;
+  vec4 clusterDepth; // x: scale, y: bias of the depth slice from log(depth)
+  vec4 viewport; // xy: rendered size, the targets may be larger
+} ubo;
+
+struct PointLight {
+  vec4 position; // w is the range
+  vec4 color;
+};
+
+struct Cluster {
+  uint offset;
+  uint count;
+};
+
+layout (set = 1, binding = 1) readonly buffer LightBuffer {
+  PointLight lights[];
+} lightBuffers[];
+
+layout (set = 1, binding = 1) readonly buffer ClusterBuffer {
+  Cluster clusters[];
+} clusterBuffers[];
+
+layout (set = 1, binding = 1) readonly buffer LightIndexBuffer {
+  uint lightIndices[];
+} lightIndexBuffers[];
+
+layout (set = 2, binding = 0) uniform sampler2D normalTexture;
+layout (set = 2, binding = 1) uniform sampler2D albedoTexture;
+layout (set = 2, binding = 2) uniform sampler2D depthTexture;
+
+// Every covered pixel is shaded once: the ambient light, then the light list of its
+// cluster, the same lists the forward path uses.
+void main() {
+  ivec2 texel = ivec2(gl_FragCoord.xy);
+  float depth = texelFetch(depthTexture, texel, 0).r;
+  if (depth <= 0.0)
+    discard;
+  vec3 surfaceNormal = normalize(texelFetch(normalTexture, texel, 0).xyz * 2.0 - 1.0);
+  vec3 albedo = texelFetch(albedoTexture, texel, 0).rgb;
+
+  // back to view space through the symmetric perspective, clip w is the depth
+  vec2 ndc = gl_FragCoord.xy / ubo.viewport.xy * 2.0 - 1.0;
+  vec3 viewPosition = vec3(
+    ndc.x * depth / ubo.projection[0][0],
+    ndc.y * depth / ubo.projection[1][1],
+    depth / ubo.projection[2][3]
+  );
+  vec3 worldPosition = (ubo.inverseView * vec4(viewPosition, 1.0)).xyz;
+
+  vec3 diffuseLight = ubo.ambientLight.color.rgb * ubo.ambientLight.color.a;
+  vec3 specularLight = vec3(0.0);
+  vec3 camWorldPos = ubo.inverseView[3].xyz;
+  vec3 viewDirection = normalize(camWorldPos - worldPosition);
+
+  uvec2 tile = uvec2(clamp((ndc * 0.5 + 0.5) * vec2(ubo.clusterGrid.xy), vec2(0.0), vec2(ubo.clusterGrid.xy) - 1.0));
+  uint slice = uint(clamp(log(depth) * ubo.clusterDepth.x + ubo.clusterDepth.y, 0.0, float(ubo.clusterGrid.z) - 1.0));
+  Cluster cluster = clusterBuffers[ubo.clusterBuffer].clusters[(slice * ubo.clusterGrid.y + tile.y) * ubo.clusterGrid.x + tile.x];
+  for (uint i = 0; i < cluster.count; i++) {
+    uint lightIndex = lightIndexBuffers[ubo.lightIndexBuffer].lightIndices[cluster.offset + i];
+    PointLight light = lightBuffers[ubo.lightBuffer].lights[lightIndex];
+    float range = light.position.w;
+    if (range > 0.0 && length(light.position.xyz - worldPosition) > range)
+      continue;
+    vec3 colorIntensity = light.color.rgb * light.color.a;
+
+    vec3 lightDirection = light.position.xyz - worldPosition;
+    float attenuation = 1.0 / dot(lightDirection, lightDirection);
+    lightDirection = normalize(lightDirection);
+
+    float cosAngIncidence = max(dot(surfaceNormal, lightDirection), 0);
+    diffuseLight += colorIntensity * attenuation * cosAngIncidence;
+
+    // Specular
+    vec3 halfAngle = normalize(lightDirection + viewDirection);
+    float blinnTerm = clamp(dot(halfAngle, surfaceNormal), 0, 1);
+    blinnTerm = pow(blinnTerm, 512.0);
+    specularLight += colorIntensity * blinnTerm;
+  }
+
+  outColor = vec4((diffuseLight + specularLight) * albedo, 1.0);
+}
@@ -0,0 +1,35 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Depth pre-pass, same transform as simple.vert so the EQUAL test of the shading pass matches
+layout (location = 0) in vec3 position;
+
+layout (push_constant) uniform PushConstantData {
+  uint instanceBuffer; // bindless storage buffer index
+} pushData;
+
+struct Instance {
+  mat4 modelMatrix;
+  mat4 normalMatrix;
+  vec4 color;
+  vec4 boundingSphere;
+  uvec4 info;
+};
+
+layout (set = 1, binding = 1) readonly buffer InstanceBuffer {
+  Instance instances[];
+} instanceBuffers[];
+
+layout (set = 0, binding = 0) uniform GlobalUbo {
+  mat4 projection;
+  mat4 view;
+  mat4 projectionView;
+} ubo;
+
+invariant gl_Position;
+
+void main() {
+  Instance instance = instanceBuffers[pushData.instanceBuffer].instances[gl_InstanceIndex];
+  vec4 worldPosition = instance.modelMatrix * vec4(position, 1.0);
+  gl_Position = ubo.projectionView * worldPosition;
+}
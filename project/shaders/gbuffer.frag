@@ -0,0 +1,18 @@
+#version 450
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec3 fragWorldPosition;
+layout(location = 2) in vec3 fragWorldNormal;
+layout(location = 3) flat in vec3 fragTint;
+
+// shaded later by deferred_lighting.frag
+layout(location = 0) out vec4 outNormal;
+layout(location = 1) out vec4 outAlbedo;
+layout(location = 2) out float outDepth;
+
+void main() {
+  outNormal = vec4(normalize(fragWorldNormal) * 0.5 + 0.5, 0.0);
+  outAlbedo = vec4(fragColor * fragTint, 1.0);
+  // clip w, the view depth, never 0 in front of the near plane
+  outDepth = 1.0 / gl_FragCoord.w;
+}
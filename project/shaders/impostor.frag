@@ -0,0 +1,114 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec2 fragOffset;
+layout(location = 1) in vec3 fragWorldPosition;
+layout(location = 2) flat in vec2 fragCell;
+layout(location = 3) flat in vec3 fragTint;
+layout(location = 4) flat in mat3 fragNormalMatrix;
+
+layout (push_constant) uniform PushConstantData {
+  uint instanceBuffer;
+  uint colorAtlas; // bindless sampled image indices, one draw per atlas
+  uint normalAtlas;
+} pushData;
+
+layout(location = 0) out vec4 outColor;
+
+struct Light {
+  vec4 color;
+  float range; // unused
+  vec4 position;
+};
+
+layout (set = 0, binding = 0) uniform GlobalUbo {
+  mat4 projection;
+  mat4 view;
+  mat4 projectionView;
+  mat4 inverseView;
+  Light ambientLight;
+  uint pointLightCount;
+  uint lightBuffer; // bindless storage buffer indices
+  uint clusterBuffer;
+  uint lightIndexBuffer;
+  uvec4 clusterGrid;
+  vec4 clusterDepth; // x: scale, y: bias of the depth slice from log(depth)
+} ubo;
+
+struct PointLight {
+  vec4 position; // w is the range
+  vec4 color;
+};
+
+struct Cluster {
+  uint offset;
+  uint count;
+};
+
+layout (set = 1, binding = 0) uniform sampler2D textures[];
+
+layout (set = 1, binding = 1) readonly buffer LightBuffer {
+  PointLight lights[];
+} lightBuffers[];
+
+layout (set = 1, binding = 1) readonly buffer ClusterBuffer {
+  Cluster clusters[];
+} clusterBuffers[];
+
+layout (set = 1, binding = 1) readonly buffer LightIndexBuffer {
+  uint lightIndices[];
+} lightIndexBuffers[];
+
+// Impostors::GRID and Impostors::VIEW_SIZE
+const float GRID = 8.0;
+const float VIEW_SIZE = 64.0;
+
+// froxel of this fragment, binned the same way by Systems::Lighting
+uint clusterIndex() {
+  vec4 clip = ubo.projectionView * vec4(fragWorldPosition, 1.0);
+  uvec2 tile = uvec2(clamp((clip.xy / clip.w * 0.5 + 0.5) * vec2(ubo.clusterGrid.xy), vec2(0.0), vec2(ubo.clusterGrid.xy) - 1.0));
+  uint slice = uint(clamp(log(clip.w) * ubo.clusterDepth.x + ubo.clusterDepth.y, 0.0, float(ubo.clusterGrid.z) - 1.0));
+  return (slice * ubo.clusterGrid.y + tile.y) * ubo.clusterGrid.x + tile.x;
+}
+
+// shaded like simple.frag, with the normal the atlas recorded for this view
+void main() {
+  // half a texel in, so filtering never reads the neighbouring view
+  vec2 local = clamp(fragOffset * 0.5 + 0.5, 0.5 / VIEW_SIZE, 1.0 - 0.5 / VIEW_SIZE);
+  vec2 uv = (fragCell + local) / GRID;
+  vec4 albedo = texture(textures[pushData.colorAtlas], uv);
+  if (albedo.a < 0.5)
+    discard;
+  vec3 normal = texture(textures[pushData.normalAtlas], uv).xyz * 2.0 - 1.0;
+
+  vec3 diffuseLight = ubo.ambientLight.color.rgb * ubo.ambientLight.color.a;
+  vec3 specularLight = vec3(0.0);
+  vec3 surfaceNormal = normalize(fragNormalMatrix * normal);
+
+  vec3 camWorldPos = ubo.inverseView[3].xyz;
+  vec3 viewDirection = normalize(camWorldPos - fragWorldPosition);
+
+  Cluster cluster = clusterBuffers[ubo.clusterBuffer].clusters[clusterIndex()];
+  for (uint i = 0; i < cluster.count; i++) {
+    uint lightIndex = lightIndexBuffers[ubo.lightIndexBuffer].lightIndices[cluster.offset + i];
+    PointLight light = lightBuffers[ubo.lightBuffer].lights[lightIndex];
+    float range = light.position.w;
+    if (range > 0.0 && length(light.position.xyz - fragWorldPosition) > range)
+      continue;
+    vec3 colorIntensity = light.color.rgb * light.color.a;
+
+    vec3 lightDirection = light.position.xyz - fragWorldPosition;
+    float attenuation = 1.0 / dot(lightDirection, lightDirection);
+    lightDirection = normalize(lightDirection);
+
+    float cosAngIncidence = max(dot(surfaceNormal, lightDirection), 0);
+    diffuseLight += colorIntensity * attenuation * cosAngIncidence;
+
+    vec3 halfAngle = normalize(lightDirection + viewDirection);
+    float blinnTerm = clamp(dot(halfAngle, surfaceNormal), 0, 1);
+    blinnTerm = pow(blinnTerm, 512.0);
+    specularLight += colorIntensity * blinnTerm;
+  }
+
+  outColor = vec4((diffuseLight + specularLight) * albedo.rgb * fragTint, 1.0);
+}
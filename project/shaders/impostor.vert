@@ -0,0 +1,107 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// A quad over the bounding sphere, facing the baked view of the atlas closest to the
+// direction of the camera. Its corners sit in model space, so the instance transform
+// rotates and scales it like the mesh it stands for.
+layout (push_constant) uniform PushConstantData {
+  uint instanceBuffer; // bindless storage buffer index
+  uint colorAtlas; // bindless sampled image indices, one draw per atlas
+  uint normalAtlas;
+} pushData;
+
+struct Instance {
+  mat4 modelMatrix;
+  mat4 normalMatrix; // mat3 in the upper left
+  vec4 color;
+  vec4 boundingSphere; // model space, w is the radius
+};
+
+layout (set = 1, binding = 1) readonly buffer InstanceBuffer {
+  Instance instances[];
+} instanceBuffers[];
+
+struct Light {
+  vec4 color;
+  float range; // unused
+  vec4 position;
+};
+
+layout (set = 0, binding = 0) uniform GlobalUbo {
+  mat4 projection;
+  mat4 view;
+  mat4 projectionView;
+  mat4 inverseView;
+  Light ambientLight;
+  uint pointLightCount;
+  uint lightBuffer; // bindless storage buffer indices
+  uint clusterBuffer;
+  uint lightIndexBuffer;
+  uvec4 clusterGrid;
+  vec4 clusterDepth; // x: scale, y: bias of the depth slice from log(depth)
+} ubo;
+
+const vec2 OFFSETS[6] = vec2[](
+  vec2(-1.0, -1.0),
+  vec2(-1.0, 1.0),
+  vec2(1.0, -1.0),
+  vec2(1.0, -1.0),
+  vec2(-1.0, 1.0),
+  vec2(1.0, 1.0)
+);
+// Impostors::GRID
+const float GRID = 8.0;
+
+layout(location = 0) out vec2 fragOffset;
+layout(location = 1) out vec3 fragWorldPosition;
+layout(location = 2) flat out vec2 fragCell;
+layout(location = 3) flat out vec3 fragTint;
+layout(location = 4) flat out mat3 fragNormalMatrix;
+
+vec2 signNotZero(vec2 v) {
+  return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// the whole sphere folded onto [-1, 1]^2, the upper hemisphere in the middle diamond
+vec2 octahedralEncode(vec3 direction) {
+  direction /= abs(direction.x) + abs(direction.y) + abs(direction.z);
+  if (direction.y < 0.0)
+    return (1.0 - abs(direction.zx)) * signNotZero(direction.xz);
+  return direction.xz;
+}
+
+// matches CellDirection in Impostors.cpp
+vec3 octahedralDecode(vec2 uv) {
+  vec3 direction = vec3(uv.x, 1.0 - abs(uv.x) - abs(uv.y), uv.y);
+  if (direction.y < 0.0)
+    direction.xz = (1.0 - abs(uv.yx)) * signNotZero(uv);
+  return normalize(direction);
+}
+
+void main() {
+  Instance instance = instanceBuffers[pushData.instanceBuffer].instances[gl_InstanceIndex];
+  mat3 normalMatrix = mat3(instance.normalMatrix);
+  vec3 center = instance.boundingSphere.xyz;
+  float radius = instance.boundingSphere.w;
+
+  // the transpose of the normal matrix takes world directions back to model space
+  vec3 worldCenter = (instance.modelMatrix * vec4(center, 1.0)).xyz;
+  vec3 toCamera = transpose(normalMatrix) * (ubo.inverseView[3].xyz - worldCenter);
+  vec2 cell = clamp(floor((octahedralEncode(normalize(toCamera)) * 0.5 + 0.5) * GRID), 0.0, GRID - 1.0);
+  vec3 direction = octahedralDecode((cell + 0.5) / GRID * 2.0 - 1.0);
+
+  // the basis glm::lookAt built for this view while baking
+  vec3 up = abs(direction.y) > 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+  vec3 right = normalize(cross(-direction, up));
+  up = cross(right, -direction);
+
+  fragOffset = OFFSETS[gl_VertexIndex];
+  vec3 position = center + radius * (fragOffset.x * right + fragOffset.y * up);
+  vec4 worldPosition = instance.modelMatrix * vec4(position, 1.0);
+  gl_Position = ubo.projectionView * worldPosition;
+
+  fragWorldPosition = worldPosition.xyz;
+  fragCell = cell;
+  fragTint = instance.color.rgb;
+  fragNormalMatrix = normalMatrix;
+}
@@ -0,0 +1,13 @@
+#version 450
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec3 fragNormal;
+
+// unlit, alpha is the coverage read by impostor.frag
+layout(location = 0) out vec4 outColor;
+layout(location = 1) out vec4 outNormal;
+
+void main() {
+  outColor = vec4(fragColor, 1.0);
+  outNormal = vec4(normalize(fragNormal) * 0.5 + 0.5, 1.0);
+}
@@ -0,0 +1,20 @@
+#version 450
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 color;
+layout (location = 2) in vec3 normal;
+layout (location = 3) in vec2 uv;
+
+layout (location = 0) out vec3 fragColor;
+layout (location = 1) out vec3 fragNormal;
+
+layout (push_constant) uniform PushConstantData {
+  mat4 projectionView; // orthographic, of one view of the atlas
+} pushData;
+
+// model space, the impostor applies the instance transform
+void main() {
+  gl_Position = pushData.projectionView * vec4(position, 1.0);
+  fragColor = color;
+  fragNormal = normal;
+}
@@ -0,0 +1,20 @@
+#version 450
+
+layout(location = 0) out vec4 outColor;
+
+layout (set = 2, binding = 0) uniform sampler2D accumulationTexture;
+layout (set = 2, binding = 1) uniform sampler2D revealageTexture;
+
+// blended over the frame with (src alpha, 1 - src alpha)
+void main() {
+  ivec2 texel = ivec2(gl_FragCoord.xy);
+  float revealage = texelFetch(revealageTexture, texel, 0).r;
+  if (revealage >= 1.0)
+    discard;
+  vec4 accumulation = texelFetch(accumulationTexture, texel, 0);
+  // overflowed half floats
+  if (isinf(max(max(abs(accumulation.r), abs(accumulation.g)), abs(accumulation.b))))
+    accumulation.rgb = vec3(accumulation.a);
+  vec3 average = accumulation.rgb / max(accumulation.a, 1e-5);
+  outColor = vec4(average, 1.0 - revealage);
+}
@@ -1,17 +1,13 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec3 fragWorldPosition;
 layout(location = 2) in vec3 fragWorldNormal;
+layout(location = 3) flat in vec3 fragTint;
 
 layout(location = 0) out vec4 outColor;
 
-layout (push_constant) uniform PushConstantData {
-  mat4 modelMatrix; // projection * view * model
-  mat4 normalMatrix; // model
-} pushData;
-
-# define MAX_LIGHTS 16
 struct Light {
   vec4 color;
   float range; // unused
@@ -24,10 +20,44 @@ layout (set = 0, binding = 0) uniform GlobalUbo {
   mat4 projectionView;
   mat4 inverseView;
   Light ambientLight;
-  Light pointLights[MAX_LIGHTS];
-  int numPointLights;
+  uint pointLightCount;
+  uint lightBuffer; // bindless storage buffer indices
+  uint clusterBuffer;
+  uint lightIndexBuffer;
+  uvec4 clusterGrid;
+  vec4 clusterDepth; // x: scale, y: bias of the depth slice from log(depth)
 } ubo;
 
+struct PointLight {
+  vec4 position; // w is the range
+  vec4 color;
+};
+
+struct Cluster {
+  uint offset;
+  uint count;
+};
+
+layout (set = 1, binding = 1) readonly buffer LightBuffer {
+  PointLight lights[];
+} lightBuffers[];
+
+layout (set = 1, binding = 1) readonly buffer ClusterBuffer {
+  Cluster clusters[];
+} clusterBuffers[];
+
+layout (set = 1, binding = 1) readonly buffer LightIndexBuffer {
+  uint lightIndices[];
+} lightIndexBuffers[];
+
+// froxel of this fragment, binned the same way by Systems::Lighting
+uint clusterIndex() {
+  vec4 clip = ubo.projectionView * vec4(fragWorldPosition, 1.0);
+  uvec2 tile = uvec2(clamp((clip.xy / clip.w * 0.5 + 0.5) * vec2(ubo.clusterGrid.xy), vec2(0.0), vec2(ubo.clusterGrid.xy) - 1.0));
+  uint slice = uint(clamp(log(clip.w) * ubo.clusterDepth.x + ubo.clusterDepth.y, 0.0, float(ubo.clusterGrid.z) - 1.0));
+  return (slice * ubo.clusterGrid.y + tile.y) * ubo.clusterGrid.x + tile.x;
+}
+
 void main() {
   vec3 diffuseLight = ubo.ambientLight.color.rgb * ubo.ambientLight.color.a;
   vec3 specularLight = vec3(0.0);
@@ -36,10 +66,13 @@ void main() {
   vec3 camWorldPos = ubo.inverseView[3].xyz;
   vec3 viewDirection = normalize(camWorldPos - fragWorldPosition);
 
-  for (int i = 0; i < ubo.numPointLights; i++) {
-    Light light = ubo.pointLights[i];
-    // check if distance to light is within range
-    if (light.range > 0.0 && length(light.position.xyz - fragWorldPosition) > light.range)
+  Cluster cluster = clusterBuffers[ubo.clusterBuffer].clusters[clusterIndex()];
+  for (uint i = 0; i < cluster.count; i++) {
+    uint lightIndex = lightIndexBuffers[ubo.lightIndexBuffer].lightIndices[cluster.offset + i];
+    PointLight light = lightBuffers[ubo.lightBuffer].lights[lightIndex];
+    // the cluster bounds the light range, the sphere may still miss this fragment
+    float range = light.position.w;
+    if (range > 0.0 && length(light.position.xyz - fragWorldPosition) > range)
       continue;
     vec3 colorIntensity = light.color.rgb * light.color.a;
 
@@ -59,6 +92,6 @@ void main() {
     specularLight += colorIntensity * blinnTerm;
   }
 
-  outColor = vec4((diffuseLight + specularLight) * fragColor, 1.0);
+  outColor = vec4((diffuseLight + specularLight) * fragColor * fragTint, 1.0);
 }
 // 4 x 8 + 5 * 8 = (4 + 5) * 8
\ No newline at end of file
@@ -1,4 +1,5 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 color;
@@ -9,13 +10,24 @@ layout (location = 3) in vec2 uv;
 layout (location = 0) out vec3 fragColor;
 layout (location = 1) out vec3 fragWorldPosition;
 layout (location = 2) out vec3 fragWorldNormal;
+layout (location = 3) flat out vec3 fragTint;
 
 layout (push_constant) uniform PushConstantData {
-  mat4 modelMatrix; // model
-  mat4 normalMatrix; // model
+  uint instanceBuffer; // bindless storage buffer index
 } pushData;
 
-# define MAX_LIGHTS 16
+struct Instance {
+  mat4 modelMatrix;
+  mat4 normalMatrix; // mat3 in the upper left
+  vec4 color;
+  vec4 boundingSphere; // read by cull.comp
+  uvec4 info;
+};
+
+layout (set = 1, binding = 1) readonly buffer InstanceBuffer {
+  Instance instances[];
+} instanceBuffers[];
+
 struct Light {
   vec4 color;
   float range; // unused
@@ -28,18 +40,24 @@ layout (set = 0, binding = 0) uniform GlobalUbo {
   mat4 projectionView;
   mat4 inverseView;
   Light ambientLight;
-  Light pointLights[MAX_LIGHTS];
-  int numPointLights;
+  uint pointLightCount;
+  uint lightBuffer; // bindless storage buffer indices
+  uint clusterBuffer;
+  uint lightIndexBuffer;
+  uvec4 clusterGrid;
+  vec4 clusterDepth; // x: scale, y: bias of the depth slice from log(depth)
 } ubo;
 
+// matches depth_prepass.vert bit for bit
+invariant gl_Position;
 
 void main() {
-  vec4 worldPosition = pushData.modelMatrix * vec4(position, 1.0);
-  gl_Position = ubo.projectionView * pushData.modelMatrix * vec4(position, 1.0);
+  Instance instance = instanceBuffers[pushData.instanceBuffer].instances[gl_InstanceIndex];
+  vec4 worldPosition = instance.modelMatrix * vec4(position, 1.0);
+  gl_Position = ubo.projectionView * worldPosition;
 
-  // vec3 normalWorldSpace = normalize(mat3(pushData.modelMatrix) * normal);
-  // mat3 normalMatrix = transpose(inverse(mat3(pushData.modelMatrix)));
-  fragWorldNormal = normalize(mat3(pushData.normalMatrix) * normal);
+  fragWorldNormal = normalize(mat3(instance.normalMatrix) * normal);
   fragWorldPosition = worldPosition.xyz;
   fragColor = color;
+  fragTint = instance.color.rgb;
 }
\ No newline at end of file
@@ -13,16 +13,23 @@
 #include <engine/input/Input.h>
 #include <engine/renderer/MemBuffer.h>
 #include <engine/renderer/FrameInfo.h>
+#include <engine/renderer/RenderQueue.h>
+#include <engine/renderer/GpuProfiler.h>
+#include <engine/renderer/DepthPyramid.h>
+#include <engine/renderer/DynamicResolution.h>
+#include <engine/renderer/Impostors.h>
 #include <engine/renderer/systems/Simple.h>
 #include <engine/renderer/systems/Billboards.h>
+#include <engine/renderer/systems/StaticBatches.h>
 #include <engine/renderer/systems/Lighting.h>
+#include <engine/renderer/systems/DeferredLighting.h>
 #include <systems/Profiler.hpp>
 
 using namespace Scop;
 
 App* App::instance = nullptr;
 
-App::App() {
+App::App(std::string_view preferredDevice) : device{ window, preferredDevice } {
   this->globalDescriptorPool = Renderer::DescriptorPool::Builder(this->device)
     .setMaxSets(Renderer::Swapchain::MAX_FRAMES_IN_FLIGHT)
     .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, Renderer::Swapchain::MAX_FRAMES_IN_FLIGHT)
@@ -46,8 +53,8 @@ void App::run() {
   }
 
   auto globalSetLayout = Renderer::DescriptorSetLayout::Builder(this->device)
-    .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
-    .build();
+    .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT)
+    .build(this->layoutCache);
 
   std::vector<VkDescriptorSet> globalDescriptorSets(Renderer::Swapchain::MAX_FRAMES_IN_FLIGHT);
   for (uint32_t i = 0; i < Renderer::Swapchain::MAX_FRAMES_IN_FLIGHT; ++i) {
@@ -56,15 +63,42 @@ void App::run() {
       .write(0, &bufferInfo)
       .build(globalDescriptorSets[i]);
   }
+  Renderer::RenderQueue renderQueue;
   Renderer::Systems::SystemInfo systemInfo{
     this->device,
     this->renderer.getSwapchainRenderPass(),
-    globalSetLayout->getHandle()
+    this->renderer.getTransparencyRenderPass(),
+    this->renderer.getGBufferRenderPass(),
+    this->renderer.getLowResolutionRenderPass(),
+    this->renderer.getUpsampleRenderPass(),
+    this->layoutCache,
+    this->bindlessTable,
+    renderQueue,
+    globalSetLayout->getHandle(),
+    VERTEX_LAYOUT
   };
-  Renderer::Systems::Simple simpleRenderSystem(systemInfo);
-  Renderer::Systems::Billboards billboardsSystem(systemInfo);
-  Renderer::Systems::Lighting lightingSystem;
+  VkPipelineLayout globalPipelineLayout = Renderer::Systems::Base::GetSharedPipelineLayout(systemInfo);
+  Renderer::Impostors impostors(this->device, this->layoutCache, this->bindlessTable, VERTEX_LAYOUT);
+  {
+    // every model the simple system draws, static ones are merged into the static batch
+    auto meshes = this->scene.viewEntitiesWith<Components::Mesh>(entt::exclude<Components::Static>);
+    for (auto entity : meshes) {
+      auto& model = meshes.get<Components::Mesh>(entity).model;
+      if (model)
+        impostors.bake(*model);
+    }
+  }
+  Renderer::Systems::Simple simpleRenderSystem(systemInfo, this->geometryPool, impostors);
+  Renderer::Systems::Billboards billboardsSystem(systemInfo, impostors);
+  Renderer::Systems::StaticBatches staticBatchesSystem(systemInfo, this->scene, this->geometryPool);
+  Renderer::Systems::Lighting lightingSystem(systemInfo, this->scene);
+  Renderer::Systems::DeferredLighting deferredLighting(systemInfo);
   Profiler profiler;
+  Renderer::GpuProfiler gpuProfiler(this->device);
+  Renderer::DepthPyramid depthPyramid(this->device, this->layoutCache, this->bindlessTable);
+  Renderer::DynamicResolution dynamicResolution(FRAME_BUDGET_MS);
+  // without timestamps only the frame delta is known, and vsync pins it near the budget
+  dynamicResolution.setEnabled(gpuProfiler.isSupported());
 
   this->sceneCamera.setPerspective(glm::radians(50.f), .1f, 100.f);
   this->sceneCamera.setViewYXZ(glm::vec3{ .88f, -0.95f, -1.95f }, glm::vec3{ 0.41f, 3.17f, 0.f });
@@ -79,16 +113,66 @@ void App::run() {
     float deltaTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
     currentTime = newTime;
     this->sceneCamera.update(deltaTime);
+    // compare the direct dispatch table against the loader trampolines
+    if (Input::IsKeyDown(Input::Key::F2))
+      this->device.setDirectDispatch(!this->device.isDirectDispatch());
+    if (Input::IsKeyDown(Input::Key::F3))
+      simpleRenderSystem.setIndirectDraw(!simpleRenderSystem.isIndirectDraw());
+    if (Input::IsKeyDown(Input::Key::F4))
+      simpleRenderSystem.toggleCulling();
+    if (Input::IsKeyDown(Input::Key::F5))
+      simpleRenderSystem.toggleOcclusionCulling();
+    if (Input::IsKeyDown(Input::Key::F6))
+      simpleRenderSystem.setCpuCulling(!simpleRenderSystem.isCpuCulling());
+    // weighted blended transparency against the sorted reference
+    if (Input::IsKeyDown(Input::Key::F7))
+      billboardsSystem.setOrderIndependent(!billboardsSystem.isOrderIndependent());
+    if (Input::IsKeyDown(Input::Key::F8))
+      staticBatchesSystem.setCaching(!staticBatchesSystem.isCaching());
+    // deferred shading against the forward path, on the same scene
+    if (Input::IsKeyDown(Input::Key::F9)) {
+      simpleRenderSystem.setDeferred(!simpleRenderSystem.isDeferred());
+      staticBatchesSystem.setDeferred(simpleRenderSystem.isDeferred());
+    }
+    // depth pre-pass for the forward opaque meshes, shaded with an EQUAL depth test
+    if (Input::IsKeyDown(Input::Key::F10)) {
+      simpleRenderSystem.setDepthPrepass(!simpleRenderSystem.isDepthPrepass());
+      staticBatchesSystem.setDepthPrepass(simpleRenderSystem.isDepthPrepass());
+    }
+    // per vertex diffuse lighting of the static batch, baked while the lights hold still
+    if (Input::IsKeyDown(Input::Key::F11))
+      staticBatchesSystem.setBakedLighting(!staticBatchesSystem.isBakedLighting());
+    if (Input::IsKeyDown(Input::Key::F12) && gpuProfiler.isSupported())
+      dynamicResolution.setEnabled(!dynamicResolution.isEnabled());
+    // sorted billboards at full, half then quarter resolution
+    if (Input::IsKeyDown(Input::Key::B)) {
+      const uint32_t divisor = billboardsSystem.getResolutionDivisor();
+      billboardsSystem.setResolutionDivisor(divisor >= Renderer::Systems::Billboards::MAX_RESOLUTION_DIVISOR ? 1 : divisor * 2);
+    }
+    // distant meshes drawn as octahedral impostors
+    if (Input::IsKeyDown(Input::Key::I))
+      impostors.setEnabled(!impostors.isEnabled());
+    // compute triangle filtering of dense meshes, needs indirect draw
+    if (Input::IsKeyDown(Input::Key::T))
+      simpleRenderSystem.toggleTriangleFiltering();
+    // the GPU time of the frame, lagging a few frames behind
+    if (gpuProfiler.isSupported())
+      dynamicResolution.update(static_cast<float>(gpuProfiler.getTime("frame")));
+    this->renderer.setRenderScale(dynamicResolution.getScale());
     auto cmdBuffer = this->renderer.beginFrame();
     if (!cmdBuffer)
       continue;
     auto frameIndex = this->renderer.getFrameIndex();
+    gpuProfiler.beginFrame(cmdBuffer, frameIndex);
+    gpuProfiler.beginScope(cmdBuffer, "frame");
     Renderer::FrameInfo frameInfo{
       deltaTime,
       frameIndex,
       cmdBuffer,
+      this->renderer.getRecorder(),
       this->sceneCamera,
       globalDescriptorSets[frameIndex],
+      globalPipelineLayout,
       {}
     };
 
@@ -98,17 +182,224 @@ void App::run() {
     ubo.view = this->sceneCamera.getView();
     ubo.projectionView = this->sceneCamera.getProjectionView();
     ubo.inverseView = this->sceneCamera.getInverseView();
+    const VkExtent2D renderExtent = this->renderer.getRenderExtent();
+    ubo.viewport = glm::vec4(renderExtent.width, renderExtent.height, 0.0f, 0.0f);
+    impostors.update(ubo.projection, this->sceneCamera.getPosition(), static_cast<float>(renderExtent.height));
     lightingSystem.update(frameInfo, this->scene);
-    profiler.update(frameInfo.deltaTime);
 
     globalUboBuffers[frameIndex]->writeTo(&ubo);
     globalUboBuffers[frameIndex]->flush();
 
+    renderQueue.clear();
+    simpleRenderSystem.enqueue(frameInfo, this->scene, renderQueue);
+    staticBatchesSystem.enqueue(frameInfo, this->scene, renderQueue);
+    staticBatchesSystem.bakeLighting(lightingSystem);
+    billboardsSystem.enqueue(frameInfo, this->scene, renderQueue);
+    renderQueue.sort();
+    // compute work (culling) has to be recorded outside of the render pass
+    gpuProfiler.beginScope(cmdBuffer, "cull");
+    renderQueue.prepare(frameInfo, this->scene);
+    gpuProfiler.endScope(cmdBuffer, "cull");
+
     // render
-    this->renderer.beginSwapchainRenderPass(cmdBuffer);
-    simpleRenderSystem.render(frameInfo, this->scene);
-    billboardsSystem.render(frameInfo, this->scene);
+    const bool twoPhase = simpleRenderSystem.isOcclusionCulling();
+    // bound at the start of every pass, every system layout shares sets 0-1 and the push constant range
+    std::array<VkDescriptorSet, 2> sharedSets = { frameInfo.globalDescriptorSet, this->bindlessTable.getSet() };
+    auto bindSharedSets = [&]() {
+      frameInfo.recorder.bindDescriptorSets(
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        globalPipelineLayout,
+        0, static_cast<uint32_t>(sharedSets.size()), sharedSets.data()
+      );
+    };
+    // the deferred path writes opaque geometry to the g-buffer, shaded in the lighting pass
+    const bool deferred = simpleRenderSystem.isDeferred();
+    auto beginOpaquePass = [&](bool loadContents, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE) {
+      if (deferred)
+        this->renderer.beginGBufferRenderPass(cmdBuffer, loadContents, contents);
+      else
+        this->renderer.beginSwapchainRenderPass(cmdBuffer, loadContents, contents);
+    };
+    auto endOpaquePass = [&]() {
+      if (deferred)
+        this->renderer.endGBufferRenderPass(cmdBuffer);
+      else
+        this->renderer.endSwapchainRenderPass(cmdBuffer);
+    };
+    auto cullOcclusion = [&]() {
+      gpuProfiler.beginScope(cmdBuffer, "occlusion");
+      depthPyramid.build(
+        frameInfo.recorder,
+        frameIndex,
+        this->renderer.getCurrentDepthImage(),
+        this->renderer.getCurrentDepthImageView(),
+        this->renderer.getSwapchainDepthFormat(),
+        renderExtent
+      );
+      simpleRenderSystem.cullOcclusion(frameInfo, depthPyramid);
+      gpuProfiler.endScope(cmdBuffer, "occlusion");
+    };
+    auto recordStart = std::chrono::high_resolution_clock::now();
+    // fragment invocations of the whole frame, queries cannot begin inside a pass and end outside
+    gpuProfiler.beginStatistics(cmdBuffer);
+    const bool prepass = simpleRenderSystem.isDepthPrepass() && !deferred;
+    if (prepass) {
+      beginOpaquePass(false);
+      bindSharedSets();
+      staticBatchesSystem.drawDepthPrepass(frameInfo);
+      simpleRenderSystem.drawDepthPrepass(frameInfo);
+      if (twoPhase) {
+        // the pyramid only needs the early depth, the late depth is laid down before shading
+        endOpaquePass();
+        cullOcclusion();
+        beginOpaquePass(true);
+        bindSharedSets();
+        simpleRenderSystem.drawDepthPrepass(frameInfo, true);
+      }
+      endOpaquePass();
+    }
+    // cached static content gets a pass of its own, passes cannot mix inline and secondary commands
+    const bool cachedStatic = staticBatchesSystem.isCaching() && !staticBatchesSystem.isEmpty();
+    if (cachedStatic) {
+      beginOpaquePass(prepass, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+      staticBatchesSystem.executeCached(
+        frameInfo,
+        deferred ? this->renderer.getGBufferRenderPass() : this->renderer.getSwapchainRenderPass(),
+        renderExtent
+      );
+      endOpaquePass();
+    }
+    beginOpaquePass(prepass || cachedStatic);
+    bindSharedSets();
+    if (prepass) {
+      renderQueue.replay(frameInfo, this->scene, Renderer::RenderQueue::Pass::Opaque);
+      if (twoPhase)
+        simpleRenderSystem.drawLate(frameInfo);
+    }
+    else if (twoPhase) {
+      // early: what was visible last frame, then test the rest against its depth
+      renderQueue.replay(frameInfo, this->scene, Renderer::RenderQueue::Pass::Opaque);
+      endOpaquePass();
+      cullOcclusion();
+      beginOpaquePass(true);
+      bindSharedSets();
+      simpleRenderSystem.drawLate(frameInfo);
+    }
+    else
+      renderQueue.replay(frameInfo, this->scene, Renderer::RenderQueue::Pass::Opaque);
+    if (deferred) {
+      endOpaquePass();
+      this->renderer.beginLightingRenderPass(cmdBuffer);
+      bindSharedSets();
+      deferredLighting.resolve(
+        frameInfo,
+        this->renderer.getCurrentNormalImageView(),
+        this->renderer.getCurrentAlbedoImageView(),
+        this->renderer.getCurrentLinearDepthImageView()
+      );
+    }
+    renderQueue.replay(frameInfo, this->scene, Renderer::RenderQueue::Pass::Transparent);
+    if (billboardsSystem.isOrderIndependent() && billboardsSystem.getCount()) {
+      // accumulate without sorting, then resolve over the frame
+      this->renderer.endSwapchainRenderPass(cmdBuffer);
+      this->renderer.beginTransparencyRenderPass(cmdBuffer);
+      bindSharedSets();
+      renderQueue.replay(frameInfo, this->scene, Renderer::RenderQueue::Pass::OrderIndependent);
+      this->renderer.endTransparencyRenderPass(cmdBuffer);
+      this->renderer.beginSwapchainRenderPass(cmdBuffer, true);
+      bindSharedSets();
+      billboardsSystem.composite(
+        frameInfo,
+        this->renderer.getCurrentAccumulationImageView(),
+        this->renderer.getCurrentRevealageImageView()
+      );
+    }
+    if (billboardsSystem.isLowResolution() && billboardsSystem.getCount()) {
+      // against the nearest depth of each footprint, then upsampled over the frame
+      this->renderer.endSwapchainRenderPass(cmdBuffer);
+      billboardsSystem.prepareLowResolution(
+        frameInfo,
+        this->renderer.getCurrentDepthImage(),
+        this->renderer.getSwapchainDepthFormat(),
+        this->renderer.getCurrentDepthImageView(),
+        this->renderer.getCurrentLowResolutionColorImageView(),
+        this->renderer.getCurrentLowResolutionDepthImageView()
+      );
+      this->renderer.beginLowResolutionRenderPass(cmdBuffer, billboardsSystem.getResolutionDivisor());
+      bindSharedSets();
+      billboardsSystem.downsampleDepth(frameInfo);
+      renderQueue.replay(frameInfo, this->scene, Renderer::RenderQueue::Pass::LowResolution);
+      this->renderer.endLowResolutionRenderPass(cmdBuffer);
+      this->renderer.beginUpsampleRenderPass(cmdBuffer);
+      bindSharedSets();
+      billboardsSystem.upsample(frameInfo);
+    }
+    auto recordEnd = std::chrono::high_resolution_clock::now();
     this->renderer.endSwapchainRenderPass(cmdBuffer);
+    gpuProfiler.endStatistics(cmdBuffer);
+    gpuProfiler.endScope(cmdBuffer, "frame");
+
+    const auto& recorderStats = frameInfo.recorder.getStats();
+    profiler.set("commands issued", recorderStats.totalIssued());
+    profiler.set("commands elided", recorderStats.totalElided());
+    profiler.set("push constant bytes elided", recorderStats.elidedPushBytes);
+    profiler.set("direct dispatch", this->device.isDirectDispatch());
+    uint32_t draws = recorderStats.getIssued(Renderer::CommandRecorder::Command::Draw) +
+      recorderStats.getIssued(Renderer::CommandRecorder::Command::DrawIndirect);
+    profiler.set("draws", draws);
+    profiler.set("indirect draw", simpleRenderSystem.isIndirectDraw());
+    profiler.set("queued packets", static_cast<double>(renderQueue.size()));
+    profiler.set("gpu culling", simpleRenderSystem.isCulling());
+    profiler.set("instances submitted", simpleRenderSystem.getSubmittedInstances());
+    profiler.set("instances visible", simpleRenderSystem.getVisibleInstances());
+    profiler.set("cpu culling", simpleRenderSystem.isCpuCulling());
+    if (simpleRenderSystem.isCpuCulling()) {
+      profiler.set("cpu culled", simpleRenderSystem.getCpuCulled());
+      profiler.set("cpu cull objects / us", simpleRenderSystem.getCpuCullRate());
+    }
+    profiler.set("occlusion culling", twoPhase);
+    profiler.set("frustum culled", simpleRenderSystem.getFrustumCulled());
+    profiler.set("occlusion culled", simpleRenderSystem.getOcclusionCulled());
+    profiler.set("triangle filtering", simpleRenderSystem.isTriangleFiltering());
+    if (simpleRenderSystem.isTriangleFiltering()) {
+      profiler.set("filter triangles tested", simpleRenderSystem.getFilterTestedTriangles());
+      profiler.set("filter triangles culled", simpleRenderSystem.getFilterCulledTriangles());
+    }
+    profiler.set("billboards", billboardsSystem.getCount());
+    profiler.set("impostors", impostors.isEnabled());
+    profiler.set("impostor atlases", impostors.getAtlasCount());
+    profiler.set("impostors drawn", billboardsSystem.getImpostorCount());
+    profiler.set("static batched entities", staticBatchesSystem.getEntityCount());
+    profiler.set("static batch rebuilds", staticBatchesSystem.getRebuildCount());
+    profiler.set("static commands cached", staticBatchesSystem.isCaching());
+    profiler.set("static command records", staticBatchesSystem.getCachedRecordCount());
+    profiler.set("order independent transparency", billboardsSystem.isOrderIndependent());
+    profiler.set("billboard resolution divisor", billboardsSystem.isLowResolution() ? billboardsSystem.getResolutionDivisor() : 1);
+    profiler.set("deferred shading", simpleRenderSystem.isDeferred());
+    profiler.set("point lights", lightingSystem.getLightCount());
+    profiler.set("light cluster references", lightingSystem.getClusterReferenceCount());
+    profiler.set("light upload bytes", static_cast<double>(lightingSystem.getUploadBytes()));
+    profiler.set("ubo upload bytes", static_cast<double>(sizeof(Renderer::GlobalUbo)));
+    profiler.set("depth prepass", prepass);
+    profiler.set("baked static lighting", staticBatchesSystem.isBaked());
+    profiler.set("lighting bakes", staticBatchesSystem.getBakeCount());
+    profiler.set("last bake ms", staticBatchesSystem.getBakeTime());
+    profiler.set("dynamic resolution", dynamicResolution.isEnabled());
+    profiler.set("dynamic resolution supported", gpuProfiler.isSupported());
+    profiler.set("render scale", this->renderer.getRenderScale());
+    if (gpuProfiler.isStatisticsSupported())
+      profiler.set("fragment invocations", static_cast<double>(gpuProfiler.getFragmentInvocations()));
+    if (gpuProfiler.isSupported()) {
+      profiler.set("gpu cull ms", gpuProfiler.getTime("cull"));
+      profiler.set("gpu occlusion ms", gpuProfiler.getTime("occlusion"));
+      profiler.set("gpu frame ms", gpuProfiler.getTime("frame"));
+    }
+    if (draws) {
+      float recordTime = std::chrono::duration<float, std::chrono::microseconds::period>(recordEnd - recordStart).count();
+      profiler.set("record us / 10k draws", recordTime / draws * 10000.f);
+    }
+    // once every counter of this frame is set
+    profiler.update(frameInfo.deltaTime);
     this->renderer.endFrame();
     // vkDeviceWaitIdle(this->device.getHandle());
   }
@@ -148,7 +439,7 @@ static std::vector<glm::vec3> GenerateRainbowColors(int count) {
 void App::loadEntities(const std::vector<std::string_view>& modelPaths) {
   uint32_t i = 0;
   for (const auto path : modelPaths) {
-    std::shared_ptr<Renderer::Model> cubeModel = Renderer::Model::CreateFromFile(this->device, path);
+    std::shared_ptr<Renderer::Model> cubeModel = Renderer::Model::CreateFromFile(this->device, this->geometryPool, path);
     auto entity = this->scene.createEntity("Cube");
     entity.addComponent<Components::Mesh>(cubeModel);
     auto& transform = entity.transform();
@@ -158,11 +449,13 @@ void App::loadEntities(const std::vector<std::string_view>& modelPaths) {
   }
 
   auto floor = this->scene.createEntity("Floor");
-  auto floorModel = Renderer::Model::CreateFromFile(this->device, "assets/models/quad.obj");
+  auto floorModel = Renderer::Model::CreateFromFile(this->device, this->geometryPool, "assets/models/quad.obj");
   floor.addComponent<Components::Mesh>(floorModel);
   auto& floorTransform = floor.transform();
   floorTransform.translation = { 0.f, .5f, 0.f };
   floorTransform.scale = { 12.f, 1.f, 12.f };
+  // placed once, merged into the static batch; the loaded models stay dynamic
+  floor.addComponent<Components::Static>();
 
   CreateLight<Components::GlobalLight>(
     this->scene, "Ambient Light",
@@ -0,0 +1,89 @@
+#include "engine/renderer/BindlessTable.h"
+
+#include <cassert>
+#include <stdexcept>
+
+using Scop::Renderer::BindlessTable;
+
+BindlessTable::BindlessTable(Device& device, LayoutCache& layoutCache) : device{ device } {
+  constexpr VkDescriptorBindingFlags bindingFlags =
+    VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+    VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+    VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+
+  this->setLayout = DescriptorSetLayout::Builder(device)
+    .addBinding(SAMPLED_IMAGE_BINDING, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_ALL, MAX_SAMPLED_IMAGES, bindingFlags)
+    .addBinding(STORAGE_BUFFER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_ALL, MAX_STORAGE_BUFFERS, bindingFlags)
+    .setLayoutFlags(VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT)
+    .build(layoutCache);
+
+  this->pool = DescriptorPool::Builder(device)
+    .setMaxSets(1)
+    .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT)
+    .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_SAMPLED_IMAGES)
+    .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, MAX_STORAGE_BUFFERS)
+    .build();
+
+  if (!this->pool->allocSet(this->setLayout->getHandle(), this->set))
+    throw std::runtime_error("failed to allocate bindless descriptor set!");
+}
+
+BindlessTable::~BindlessTable() {}
+
+uint32_t BindlessTable::Slots::acquire() {
+  if (!this->freeList.empty()) {
+    uint32_t index = this->freeList.back();
+    this->freeList.pop_back();
+    return index;
+  }
+  if (this->next >= this->capacity)
+    throw std::runtime_error("bindless table is full");
+  return this->next++;
+}
+
+void BindlessTable::Slots::release(uint32_t index) {
+  assert(index < this->next && "Releasing a slot that was never acquired");
+  this->freeList.push_back(index);
+}
+
+uint32_t BindlessTable::registerBuffer(const MemBuffer& buffer) {
+  uint32_t index = this->buffers.acquire();
+  this->updateBuffer(index, buffer);
+  return index;
+}
+
+uint32_t BindlessTable::registerImage(VkImageView imageView, VkSampler sampler, VkImageLayout imageLayout) {
+  uint32_t index = this->images.acquire();
+  this->updateImage(index, imageView, sampler, imageLayout);
+  return index;
+}
+
+void BindlessTable::updateBuffer(uint32_t index, const MemBuffer& buffer) {
+  auto bufferInfo = buffer.getDescriptorInfo();
+  this->write(STORAGE_BUFFER_BINDING, index, &bufferInfo, nullptr);
+}
+
+void BindlessTable::updateImage(uint32_t index, VkImageView imageView, VkSampler sampler, VkImageLayout imageLayout) {
+  VkDescriptorImageInfo imageInfo{ sampler, imageView, imageLayout };
+  this->write(SAMPLED_IMAGE_BINDING, index, nullptr, &imageInfo);
+}
+
+void BindlessTable::write(
+  uint32_t binding,
+  uint32_t index,
+  const VkDescriptorBufferInfo* bufferInfo,
+  const VkDescriptorImageInfo* imageInfo
+) {
+  VkWriteDescriptorSet write{};
+  write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  write.dstSet = this->set;
+  write.dstBinding = binding;
+  write.dstArrayElement = index;
+  write.descriptorCount = 1;
+  write.descriptorType = binding == SAMPLED_IMAGE_BINDING
+    ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+    : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  write.pBufferInfo = bufferInfo;
+  write.pImageInfo = imageInfo;
+  vkUpdateDescriptorSets(this->device.getHandle(), 1, &write, 0, nullptr);
+}
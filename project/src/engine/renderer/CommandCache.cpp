@@ -0,0 +1,77 @@
+#include "engine/renderer/CommandCache.h"
+
+#include <stdexcept>
+
+using Scop::Renderer::CommandCache;
+
+CommandCache::CommandCache(Device& device) : device{ device } {
+  std::array<VkCommandBuffer, Swapchain::MAX_FRAMES_IN_FLIGHT> commandBuffers{};
+  VkCommandBufferAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.commandPool = this->device.getCommandPool();
+  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+  allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+  if (vkAllocateCommandBuffers(this->device.getHandle(), &allocInfo, commandBuffers.data()) != VK_SUCCESS)
+    throw std::runtime_error("Failed to allocate secondary command buffers");
+  for (size_t i = 0; i < commandBuffers.size(); i++)
+    this->slots[i].commandBuffer = commandBuffers[i];
+}
+
+CommandCache::~CommandCache() {
+  for (auto& slot : this->slots)
+    vkFreeCommandBuffers(this->device.getHandle(), this->device.getCommandPool(), 1, &slot.commandBuffer);
+}
+
+void CommandCache::invalidate() {
+  for (auto& slot : this->slots)
+    slot.valid = false;
+}
+
+void CommandCache::execute(
+  CommandRecorder& recorder,
+  uint32_t frameIndex,
+  uint64_t version,
+  VkRenderPass renderPass,
+  VkExtent2D extent,
+  const RecordFn& record
+) {
+  auto& slot = this->slots[frameIndex];
+  bool upToDate = slot.valid &&
+    slot.version == version &&
+    slot.renderPass == renderPass &&
+    slot.extent.width == extent.width &&
+    slot.extent.height == extent.height;
+  if (!upToDate) {
+    const auto& dispatch = this->device.getDispatch();
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = renderPass;
+    inheritanceInfo.subpass = 0;
+    // any framebuffer of the render pass
+    inheritanceInfo.framebuffer = VK_NULL_HANDLE;
+    // may run inside the fragment statistics query of the GpuProfiler
+    if (this->device.getOptionalFeatures().pipelineStatisticsQuery)
+      inheritanceInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+    // the pool resets buffers on begin, the slot is not pending anymore
+    if (dispatch.vkBeginCommandBuffer(slot.commandBuffer, &beginInfo) != VK_SUCCESS)
+      throw std::runtime_error("Failed to begin recording secondary command buffer");
+    this->recorder.begin(slot.commandBuffer, dispatch);
+
+    // dynamic state is not inherited from the primary
+    VkViewport viewport{ 0.0f, 0.0f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.0f, 1.0f };
+    VkRect2D scissor{ { 0, 0 }, extent };
+    dispatch.vkCmdSetViewport(slot.commandBuffer, 0, 1, &viewport);
+    dispatch.vkCmdSetScissor(slot.commandBuffer, 0, 1, &scissor);
+    record(this->recorder);
+
+    if (dispatch.vkEndCommandBuffer(slot.commandBuffer) != VK_SUCCESS)
+      throw std::runtime_error("Failed to record secondary command buffer");
+    slot = { slot.commandBuffer, true, version, renderPass, extent };
+    this->recordCount++;
+  }
+  recorder.executeCommands(1, &slot.commandBuffer);
+}
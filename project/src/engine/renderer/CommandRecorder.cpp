@@ -0,0 +1,217 @@
+#include "engine/renderer/CommandRecorder.h"
+
+#include <cassert>
+#include <cstring>
+#include <numeric>
+
+using Scop::Renderer::CommandRecorder;
+
+uint32_t CommandRecorder::Stats::totalIssued() const {
+  return std::accumulate(this->issued.begin(), this->issued.end(), 0u);
+}
+
+uint32_t CommandRecorder::Stats::totalElided() const {
+  return std::accumulate(this->elided.begin(), this->elided.end(), 0u);
+}
+
+void CommandRecorder::begin(VkCommandBuffer commandBuffer, const DeviceDispatch& dispatchTable) {
+  this->commandBuffer = commandBuffer;
+  this->dispatchTable = &dispatchTable;
+  this->stats = {};
+  this->invalidate();
+}
+
+void CommandRecorder::invalidate() {
+  this->graphicsPipeline = VK_NULL_HANDLE;
+  this->computePipeline = VK_NULL_HANDLE;
+  this->graphicsSets = {};
+  this->computeSets = {};
+  this->vertexBuffers = {};
+  this->indexBuffer = {};
+  this->pushConstantState = {};
+}
+
+void CommandRecorder::bindPipeline(VkPipelineBindPoint bindPoint, VkPipeline pipeline) {
+  VkPipeline& bound = bindPoint == VK_PIPELINE_BIND_POINT_COMPUTE ? this->computePipeline : this->graphicsPipeline;
+  if (bound == pipeline) {
+    this->elided(Command::BindPipeline);
+    return;
+  }
+  bound = pipeline;
+  this->dispatchTable->vkCmdBindPipeline(this->commandBuffer, bindPoint, pipeline);
+  this->issued(Command::BindPipeline);
+}
+
+void CommandRecorder::bindDescriptorSets(
+  VkPipelineBindPoint bindPoint,
+  VkPipelineLayout layout,
+  uint32_t firstSet,
+  uint32_t setCount,
+  const VkDescriptorSet* sets
+) {
+  assert(firstSet + setCount <= MAX_DESCRIPTOR_SETS && "Too many descriptor sets");
+  auto& bound = bindPoint == VK_PIPELINE_BIND_POINT_COMPUTE ? this->computeSets : this->graphicsSets;
+  bool redundant = true;
+  for (uint32_t i = 0; i < setCount && redundant; i++)
+    redundant = bound[firstSet + i].layout == layout && bound[firstSet + i].set == sets[i];
+  if (redundant) {
+    this->elided(Command::BindDescriptorSets);
+    return;
+  }
+
+  // binding through another layout may disturb any set recorded with a different one,
+  // forget those rather than reasoning about layout compatibility
+  for (auto& set : bound)
+    if (set.layout != layout)
+      set = {};
+  for (uint32_t i = 0; i < setCount; i++)
+    bound[firstSet + i] = { layout, sets[i] };
+  this->dispatchTable->vkCmdBindDescriptorSets(this->commandBuffer, bindPoint, layout, firstSet, setCount, sets, 0, nullptr);
+  this->issued(Command::BindDescriptorSets);
+}
+
+void CommandRecorder::bindVertexBuffers(
+  uint32_t firstBinding,
+  uint32_t bindingCount,
+  const VkBuffer* buffers,
+  const VkDeviceSize* offsets
+) {
+  assert(firstBinding + bindingCount <= MAX_VERTEX_BINDINGS && "Too many vertex bindings");
+  bool redundant = true;
+  for (uint32_t i = 0; i < bindingCount && redundant; i++) {
+    const auto& bound = this->vertexBuffers[firstBinding + i];
+    redundant = bound.buffer == buffers[i] && bound.offset == offsets[i];
+  }
+  if (redundant) {
+    this->elided(Command::BindVertexBuffers);
+    return;
+  }
+  for (uint32_t i = 0; i < bindingCount; i++)
+    this->vertexBuffers[firstBinding + i] = { buffers[i], offsets[i] };
+  this->dispatchTable->vkCmdBindVertexBuffers(this->commandBuffer, firstBinding, bindingCount, buffers, offsets);
+  this->issued(Command::BindVertexBuffers);
+}
+
+void CommandRecorder::bindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType) {
+  auto& bound = this->indexBuffer;
+  if (bound.buffer == buffer && bound.offset == offset && bound.indexType == indexType) {
+    this->elided(Command::BindIndexBuffer);
+    return;
+  }
+  bound = { buffer, offset, indexType };
+  this->dispatchTable->vkCmdBindIndexBuffer(this->commandBuffer, buffer, offset, indexType);
+  this->issued(Command::BindIndexBuffer);
+}
+
+void CommandRecorder::pushConstants(
+  VkPipelineLayout layout,
+  VkShaderStageFlags stageFlags,
+  uint32_t offset,
+  uint32_t size,
+  const void* data
+) {
+  assert(offset % 4 == 0 && size % 4 == 0 && "Push constant range must be 4-byte aligned");
+  assert(offset + size <= MAX_PUSH_CONSTANT_SIZE && "Push constant range out of bounds");
+  auto& state = this->pushConstantState;
+  if (state.layout != layout || state.stageFlags != stageFlags) {
+    state.layout = layout;
+    state.stageFlags = stageFlags;
+    state.valid.reset();
+  }
+
+  // only the span of words that actually changed is pushed
+  auto bytes = static_cast<const uint8_t*>(data);
+  uint32_t first = size, last = 0;
+  for (uint32_t i = 0; i < size; i += 4) {
+    uint32_t at = offset + i;
+    bool known = state.valid[at] && state.valid[at + 1] && state.valid[at + 2] && state.valid[at + 3];
+    if (known && std::memcmp(&state.data[at], bytes + i, 4) == 0)
+      continue;
+    if (first == size)
+      first = i;
+    last = i + 4;
+  }
+  if (first == size) {
+    this->stats.elidedPushBytes += size;
+    this->elided(Command::PushConstants);
+    return;
+  }
+
+  uint32_t dirty = last - first;
+  std::memcpy(&state.data[offset + first], bytes + first, dirty);
+  for (uint32_t i = offset + first; i < offset + last; i++)
+    state.valid.set(i);
+  this->dispatchTable->vkCmdPushConstants(this->commandBuffer, layout, stageFlags, offset + first, dirty, bytes + first);
+  this->stats.pushedBytes += dirty;
+  this->stats.elidedPushBytes += size - dirty;
+  this->issued(Command::PushConstants);
+}
+
+void CommandRecorder::draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance) {
+  this->dispatchTable->vkCmdDraw(this->commandBuffer, vertexCount, instanceCount, firstVertex, firstInstance);
+  this->issued(Command::Draw);
+}
+
+void CommandRecorder::drawIndexed(
+  uint32_t indexCount,
+  uint32_t instanceCount,
+  uint32_t firstIndex,
+  int32_t vertexOffset,
+  uint32_t firstInstance
+) {
+  this->dispatchTable->vkCmdDrawIndexed(this->commandBuffer, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
+  this->issued(Command::Draw);
+}
+
+void CommandRecorder::drawIndexedIndirect(VkBuffer buffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride) {
+  this->dispatchTable->vkCmdDrawIndexedIndirect(this->commandBuffer, buffer, offset, drawCount, stride);
+  this->issued(Command::DrawIndirect);
+}
+
+void CommandRecorder::dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) {
+  this->dispatchTable->vkCmdDispatch(this->commandBuffer, groupCountX, groupCountY, groupCountZ);
+  this->issued(Command::Dispatch);
+}
+
+void CommandRecorder::memoryBarrier(
+  VkPipelineStageFlags srcStageMask,
+  VkAccessFlags srcAccessMask,
+  VkPipelineStageFlags dstStageMask,
+  VkAccessFlags dstAccessMask
+) {
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = srcAccessMask;
+  barrier.dstAccessMask = dstAccessMask;
+  this->dispatchTable->vkCmdPipelineBarrier(
+    this->commandBuffer,
+    srcStageMask, dstStageMask,
+    0,
+    1, &barrier,
+    0, nullptr,
+    0, nullptr
+  );
+  this->issued(Command::Barrier);
+}
+
+void CommandRecorder::imageBarrier(
+  VkPipelineStageFlags srcStageMask,
+  VkPipelineStageFlags dstStageMask,
+  const VkImageMemoryBarrier& barrier
+) {
+  this->dispatchTable->vkCmdPipelineBarrier(
+    this->commandBuffer,
+    srcStageMask, dstStageMask,
+    0,
+    0, nullptr,
+    0, nullptr,
+    1, &barrier
+  );
+  this->issued(Command::Barrier);
+}
+
+void CommandRecorder::executeCommands(uint32_t commandBufferCount, const VkCommandBuffer* commandBuffers) {
+  this->dispatchTable->vkCmdExecuteCommands(this->commandBuffer, commandBufferCount, commandBuffers);
+  this->issued(Command::ExecuteCommands);
+  this->invalidate();
+}
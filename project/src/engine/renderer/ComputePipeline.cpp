@@ -0,0 +1,46 @@
+#include "engine/renderer/ComputePipeline.h"
+#include <engine/renderer/Pipeline.h>
+
+#include <cassert>
+#include <stdexcept>
+
+using Scop::Renderer::ComputePipeline;
+
+ComputePipeline::ComputePipeline(
+  Device& device,
+  const std::string_view compFilePath,
+  VkPipelineLayout pipelineLayout
+) : device{ device } {
+  assert(pipelineLayout != VK_NULL_HANDLE && "pipeline layout is null");
+  auto code = Pipeline::ReadFile(compFilePath);
+
+  VkShaderModuleCreateInfo moduleInfo{};
+  moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  moduleInfo.codeSize = code.size();
+  moduleInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+  VkShaderModule shaderModule;
+  if (vkCreateShaderModule(this->device.getHandle(), &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS)
+    throw std::runtime_error("failed to create shader module");
+
+  VkComputePipelineCreateInfo pipelineInfo{};
+  pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineInfo.stage.module = shaderModule;
+  pipelineInfo.stage.pName = "main";
+  pipelineInfo.layout = pipelineLayout;
+
+  VkResult result = vkCreateComputePipelines(this->device.getHandle(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &this->computePipeline);
+  // the module is not needed once the pipeline exists
+  vkDestroyShaderModule(this->device.getHandle(), shaderModule, nullptr);
+  if (result != VK_SUCCESS)
+    throw std::runtime_error("failed to create compute pipeline");
+}
+
+ComputePipeline::~ComputePipeline() {
+  vkDestroyPipeline(this->device.getHandle(), this->computePipeline, nullptr);
+}
+
+void ComputePipeline::bind(CommandRecorder& recorder) {
+  recorder.bindPipeline(VK_PIPELINE_BIND_POINT_COMPUTE, this->computePipeline);
+}
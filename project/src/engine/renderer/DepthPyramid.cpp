@@ -0,0 +1,216 @@
+#include "engine/renderer/DepthPyramid.h"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+using Scop::Renderer::DepthPyramid;
+
+// matches PushConstantData in depth_pyramid.comp
+struct DepthPyramidPushConstantData {
+  int32_t sourceWidth;
+  int32_t sourceHeight;
+  int32_t width;
+  int32_t height;
+  uint32_t copy;
+};
+
+DepthPyramid::DepthPyramid(Device& device, LayoutCache& layoutCache, BindlessTable& bindlessTable)
+  : device{ device }, bindlessTable{ bindlessTable } {
+  this->setLayout = DescriptorSetLayout::Builder(this->device)
+    .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+    .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)
+    .build(layoutCache);
+  constexpr uint32_t maxSets = MAX_LEVELS + Swapchain::MAX_FRAMES_IN_FLIGHT;
+  this->descriptorPool = DescriptorPool::Builder(this->device)
+    .setMaxSets(maxSets)
+    .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, maxSets)
+    .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, maxSets)
+    .build();
+  this->pipelineLayout = layoutCache.getPipelineLayout(
+    { this->setLayout->getHandle() },
+    { { VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DepthPyramidPushConstantData) } }
+  );
+  this->pipeline = std::make_unique<ComputePipeline>(
+    this->device,
+    SHADERS_PATH"depth_pyramid.comp.spv",
+    this->pipelineLayout
+  );
+
+  // texels are only ever fetched, nearest and clamped keeps the cull shader simple
+  VkSamplerCreateInfo samplerInfo{};
+  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter = VK_FILTER_NEAREST;
+  samplerInfo.minFilter = VK_FILTER_NEAREST;
+  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+  if (vkCreateSampler(this->device.getHandle(), &samplerInfo, nullptr, &this->sampler) != VK_SUCCESS)
+    throw std::runtime_error("Failed to create depth pyramid sampler");
+}
+
+DepthPyramid::~DepthPyramid() {
+  this->destroy();
+  if (this->tableIndex != BindlessTable::INVALID_INDEX)
+    this->bindlessTable.releaseImage(this->tableIndex);
+  vkDestroySampler(this->device.getHandle(), this->sampler, nullptr);
+}
+
+void DepthPyramid::create(VkExtent2D extent) {
+  this->extent = extent;
+  uint32_t levelCount = std::min<uint32_t>(std::bit_width(std::max(extent.width, extent.height)), MAX_LEVELS);
+
+  VkImageCreateInfo imageInfo{};
+  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageInfo.extent = { extent.width, extent.height, 1 };
+  imageInfo.mipLevels = levelCount;
+  imageInfo.arrayLayers = 1;
+  imageInfo.format = VK_FORMAT_R32_SFLOAT;
+  imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+  imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  this->device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, this->image, this->imageMemory);
+  this->initialized = false;
+
+  VkImageViewCreateInfo viewInfo{};
+  viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewInfo.image = this->image;
+  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.format = VK_FORMAT_R32_SFLOAT;
+  viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1 };
+  if (vkCreateImageView(this->device.getHandle(), &viewInfo, nullptr, &this->view) != VK_SUCCESS)
+    throw std::runtime_error("Failed to create depth pyramid view");
+  this->levelViews.resize(levelCount);
+  for (uint32_t level = 0; level < levelCount; level++) {
+    viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 };
+    if (vkCreateImageView(this->device.getHandle(), &viewInfo, nullptr, &this->levelViews[level]) != VK_SUCCESS)
+      throw std::runtime_error("Failed to create depth pyramid level view");
+  }
+
+  this->descriptorPool->reset();
+  for (auto& set : this->depthSets) {
+    if (!this->descriptorPool->allocSet(this->setLayout->getHandle(), set))
+      throw std::runtime_error("Failed to allocate depth pyramid descriptor set");
+  }
+  this->levelSets.assign(levelCount, VK_NULL_HANDLE);
+  for (uint32_t level = 1; level < levelCount; level++) {
+    VkDescriptorImageInfo sourceInfo{ this->sampler, this->levelViews[level - 1], VK_IMAGE_LAYOUT_GENERAL };
+    VkDescriptorImageInfo destinationInfo{ VK_NULL_HANDLE, this->levelViews[level], VK_IMAGE_LAYOUT_GENERAL };
+    if (!DescriptorWriter(*this->setLayout, *this->descriptorPool)
+      .write(0, &sourceInfo)
+      .write(1, &destinationInfo)
+      .build(this->levelSets[level]))
+      throw std::runtime_error("Failed to allocate depth pyramid descriptor set");
+  }
+
+  if (this->tableIndex == BindlessTable::INVALID_INDEX)
+    this->tableIndex = this->bindlessTable.registerImage(this->view, this->sampler, VK_IMAGE_LAYOUT_GENERAL);
+  else
+    this->bindlessTable.updateImage(this->tableIndex, this->view, this->sampler, VK_IMAGE_LAYOUT_GENERAL);
+}
+
+void DepthPyramid::destroy() {
+  if (this->image == VK_NULL_HANDLE)
+    return;
+  for (auto levelView : this->levelViews)
+    vkDestroyImageView(this->device.getHandle(), levelView, nullptr);
+  this->levelViews.clear();
+  vkDestroyImageView(this->device.getHandle(), this->view, nullptr);
+  vkDestroyImage(this->device.getHandle(), this->image, nullptr);
+  vkFreeMemory(this->device.getHandle(), this->imageMemory, nullptr);
+  this->image = VK_NULL_HANDLE;
+}
+
+void DepthPyramid::build(
+  CommandRecorder& recorder,
+  uint32_t frameIndex,
+  VkImage depthImage,
+  VkImageView depthImageView,
+  VkFormat depthFormat,
+  VkExtent2D extent
+) {
+  if (extent.width != this->extent.width || extent.height != this->extent.height) {
+    // the pyramid and its table entry may still be read by frames in flight
+    vkDeviceWaitIdle(this->device.getHandle());
+    this->destroy();
+    this->create(extent);
+  }
+
+  VkDescriptorImageInfo depthInfo{ this->sampler, depthImageView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+  VkDescriptorImageInfo levelInfo{ VK_NULL_HANDLE, this->levelViews[0], VK_IMAGE_LAYOUT_GENERAL };
+  DescriptorWriter(*this->setLayout, *this->descriptorPool)
+    .write(0, &depthInfo)
+    .write(1, &levelInfo)
+    .overwrite(this->depthSets[frameIndex]);
+
+  // layout transitions have to cover the stencil aspect too when the format has one
+  bool hasStencil = depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT || depthFormat == VK_FORMAT_D24_UNORM_S8_UINT;
+  VkImageMemoryBarrier depthBarrier{};
+  depthBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  depthBarrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  depthBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  depthBarrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  depthBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+  depthBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  depthBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  depthBarrier.image = depthImage;
+  depthBarrier.subresourceRange = {
+    VK_IMAGE_ASPECT_DEPTH_BIT | (hasStencil ? VK_IMAGE_ASPECT_STENCIL_BIT : 0u), 0, 1, 0, 1
+  };
+  recorder.imageBarrier(
+    VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+    depthBarrier
+  );
+
+  // previous readers of the pyramid (culling) are done before it is overwritten
+  VkImageMemoryBarrier pyramidBarrier{};
+  pyramidBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  pyramidBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  pyramidBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  pyramidBarrier.oldLayout = this->initialized ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_UNDEFINED;
+  pyramidBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+  pyramidBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  pyramidBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  pyramidBarrier.image = this->image;
+  pyramidBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, this->getLevelCount(), 0, 1 };
+  recorder.imageBarrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, pyramidBarrier);
+  this->initialized = true;
+
+  this->pipeline->bind(recorder);
+  int32_t sourceWidth = static_cast<int32_t>(extent.width);
+  int32_t sourceHeight = static_cast<int32_t>(extent.height);
+  for (uint32_t level = 0; level < this->getLevelCount(); level++) {
+    int32_t width = std::max(static_cast<int32_t>(extent.width >> level), 1);
+    int32_t height = std::max(static_cast<int32_t>(extent.height >> level), 1);
+    VkDescriptorSet set = level == 0 ? this->depthSets[frameIndex] : this->levelSets[level];
+    recorder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_COMPUTE, this->pipelineLayout, 0, 1, &set);
+    DepthPyramidPushConstantData data{ sourceWidth, sourceHeight, width, height, level == 0 };
+    recorder.pushConstants(this->pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(data), &data);
+    recorder.dispatch((width + GROUP_SIZE - 1) / GROUP_SIZE, (height + GROUP_SIZE - 1) / GROUP_SIZE, 1);
+    // each level reads the one written just before
+    recorder.memoryBarrier(
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      VK_ACCESS_SHADER_WRITE_BIT,
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      VK_ACCESS_SHADER_READ_BIT
+    );
+    sourceWidth = width;
+    sourceHeight = height;
+  }
+
+  depthBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  depthBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  depthBarrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+  depthBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  recorder.imageBarrier(
+    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+    VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+    depthBarrier
+  );
+}
@@ -1,4 +1,5 @@
 #include "engine/renderer/Descriptors.h"
+#include <engine/renderer/LayoutCache.h>
 
 #include <stdexcept>
 
@@ -8,7 +9,8 @@ DescriptorSetLayout::Builder& DescriptorSetLayout::Builder::addBinding(
   uint32_t binding,
   VkDescriptorType descriptorType,
   VkShaderStageFlags stageFlags,
-  uint32_t count
+  uint32_t count,
+  VkDescriptorBindingFlags flags
 ) {
   assert(bindings.count(binding) == 0 && "Binding already in use");
   VkDescriptorSetLayoutBinding layoutBinding{};
@@ -17,24 +19,44 @@ DescriptorSetLayout::Builder& DescriptorSetLayout::Builder::addBinding(
   layoutBinding.descriptorCount = count;
   layoutBinding.stageFlags = stageFlags;
   bindings[binding] = layoutBinding;
+  if (flags)
+    bindingFlags[binding] = flags;
   return *this;
 }
 
 std::unique_ptr<DescriptorSetLayout> DescriptorSetLayout::Builder::build() const {
-  return std::make_unique<DescriptorSetLayout>(this->device, this->bindings);
+  return std::make_unique<DescriptorSetLayout>(this->device, this->bindings, this->bindingFlags, this->layoutFlags);
+}
+
+std::shared_ptr<DescriptorSetLayout> DescriptorSetLayout::Builder::build(LayoutCache& cache) const {
+  return cache.getSetLayout(this->bindings, this->bindingFlags, this->layoutFlags);
 }
 
 // 
 
-DescriptorSetLayout::DescriptorSetLayout(Device& device, const BindingsMap& bindings)
-  : device{ device }, bindings{ bindings } {
+DescriptorSetLayout::DescriptorSetLayout(
+  Device& device,
+  const BindingsMap& bindings,
+  const BindingFlagsMap& bindingFlags,
+  VkDescriptorSetLayoutCreateFlags layoutFlags
+) : device{ device }, bindings{ bindings } {
   std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
+  std::vector<VkDescriptorBindingFlags> setLayoutBindingFlags{};
   for (auto kv : bindings) {
     setLayoutBindings.push_back(kv.second);
+    auto flags = bindingFlags.find(kv.first);
+    setLayoutBindingFlags.push_back(flags != bindingFlags.end() ? flags->second : 0);
   }
 
+  VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+  bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+  bindingFlagsInfo.bindingCount = static_cast<uint32_t>(setLayoutBindingFlags.size());
+  bindingFlagsInfo.pBindingFlags = setLayoutBindingFlags.data();
+
   VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
   descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  descriptorSetLayoutInfo.pNext = bindingFlags.empty() ? nullptr : &bindingFlagsInfo;
+  descriptorSetLayoutInfo.flags = layoutFlags;
   descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
   descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
 
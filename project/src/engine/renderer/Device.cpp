@@ -1,6 +1,9 @@
 #include "engine/renderer/Device.h"
 
 // std headers
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <set>
@@ -52,11 +55,11 @@ void DestroyDebugUtilsMessengerEXT(
 }
 
 // class member functions
-Device::Device(Window& window) : window{ window } {
+Device::Device(Window& window, std::string_view preferredDevice) : window{ window } {
   this->createInstance();
   this->setupDebugMessenger();
   this->createSurface();
-  this->pickPhysicalDevice();
+  this->pickPhysicalDevice(preferredDevice);
   this->createLogicalDevice();
   this->createCommandPool();
 }
@@ -84,7 +87,8 @@ void Device::createInstance() {
   appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
   appInfo.pEngineName = "No Engine";
   appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-  appInfo.apiVersion = VK_API_VERSION_1_0;
+  // 1.2 for core descriptor indexing (bindless resources)
+  appInfo.apiVersion = VK_API_VERSION_1_2;
 
   VkInstanceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -112,9 +116,50 @@ void Device::createInstance() {
   }
 
   hasGflwRequiredInstanceExtensions();
+  instanceDispatch.load(instance);
 }
 
-void Device::pickPhysicalDevice() {
+static std::string FormatUUID(const uint8_t uuid[VK_UUID_SIZE]) {
+  static constexpr char digits[] = "0123456789abcdef";
+  std::string formatted;
+  for (uint32_t i = 0; i < VK_UUID_SIZE; i++) {
+    if (i == 4 || i == 6 || i == 8 || i == 10)
+      formatted += '-';
+    formatted += digits[uuid[i] >> 4];
+    formatted += digits[uuid[i] & 0xf];
+  }
+  return formatted;
+}
+
+static std::string ToLower(std::string_view str) {
+  std::string lower(str);
+  std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+  return lower;
+}
+
+// Either the full UUID (dashes optional) or a case insensitive part of the device name
+static bool MatchesPreferredDevice(std::string_view name, const std::string& uuid, std::string_view preferred) {
+  std::string wanted = ToLower(preferred);
+  std::string bareUuid = uuid;
+  bareUuid.erase(std::remove(bareUuid.begin(), bareUuid.end(), '-'), bareUuid.end());
+  std::string bareWanted = wanted;
+  bareWanted.erase(std::remove(bareWanted.begin(), bareWanted.end(), '-'), bareWanted.end());
+  if (bareWanted == bareUuid)
+    return true;
+  return ToLower(name).find(wanted) != std::string::npos;
+}
+
+static const char* DeviceTypeName(VkPhysicalDeviceType type) {
+  switch (type) {
+  case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: return "discrete";
+  case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return "integrated";
+  case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: return "virtual";
+  case VK_PHYSICAL_DEVICE_TYPE_CPU: return "cpu";
+  default: return "other";
+  }
+}
+
+void Device::pickPhysicalDevice(std::string_view preferredDevice) {
   uint32_t deviceCount = 0;
   vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
   if (deviceCount == 0) {
@@ -124,19 +169,122 @@ void Device::pickPhysicalDevice() {
   std::vector<VkPhysicalDevice> devices(deviceCount);
   vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
 
+  if (preferredDevice.empty()) {
+    const char* env = std::getenv("SCOP_DEVICE");
+    if (env)
+      preferredDevice = env;
+  }
+
+  uint32_t bestScore = 0;
+  bool bestMatches = false;
   for (const auto& device : devices) {
-    if (isDeviceSuitable(device)) {
+    VkPhysicalDeviceIDProperties idProperties = {};
+    idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+    VkPhysicalDeviceProperties2 deviceProperties = {};
+    deviceProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    deviceProperties.pNext = &idProperties;
+    vkGetPhysicalDeviceProperties2(device, &deviceProperties);
+    const auto& props = deviceProperties.properties;
+    std::string uuid = FormatUUID(idProperties.deviceUUID);
+
+    std::cout << "\t" << props.deviceName << " (" << DeviceTypeName(props.deviceType) << ", " << uuid << ")";
+    if (!isDeviceSuitable(device)) {
+      std::cout << ": not suitable" << std::endl;
+      continue;
+    }
+    DeviceScore score = scorePhysicalDevice(device);
+    bool matches = !preferredDevice.empty() && MatchesPreferredDevice(props.deviceName, uuid, preferredDevice);
+    std::cout << ": score " << score.total()
+      << " (type " << score.type
+      << ", memory " << score.memory
+      << ", queues " << score.queues
+      << ", features " << score.features << ")"
+      << (matches ? " [preferred]" : "") << std::endl;
+
+    // a device matching the override always beats one that does not
+    if (physicalDevice == VK_NULL_HANDLE ||
+      (matches && !bestMatches) ||
+      (matches == bestMatches && score.total() > bestScore)) {
       physicalDevice = device;
-      break;
+      bestScore = score.total();
+      bestMatches = matches;
     }
   }
 
   if (physicalDevice == VK_NULL_HANDLE) {
     throw std::runtime_error("failed to find a suitable GPU!");
   }
+  if (!preferredDevice.empty() && !bestMatches) {
+    throw std::runtime_error("no suitable GPU matches \"" + std::string(preferredDevice) + "\"");
+  }
 
   vkGetPhysicalDeviceProperties(physicalDevice, &properties);
-  std::cout << "physical device: " << properties.deviceName << std::endl;
+  optionalFeatures = queryOptionalFeatures(physicalDevice);
+  std::cout << "physical device: " << properties.deviceName << " (score " << bestScore << ")" << std::endl;
+}
+
+OptionalFeatures Device::queryOptionalFeatures(VkPhysicalDevice device) const {
+  VkPhysicalDeviceFeatures2 features = {};
+  features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  vkGetPhysicalDeviceFeatures2(device, &features);
+
+  VkPhysicalDeviceProperties deviceProperties;
+  vkGetPhysicalDeviceProperties(device, &deviceProperties);
+
+  OptionalFeatures supported{};
+  supported.multiDrawIndirect = features.features.multiDrawIndirect;
+  supported.drawIndirectFirstInstance = features.features.drawIndirectFirstInstance;
+  supported.pipelineStatisticsQuery = features.features.pipelineStatisticsQuery && features.features.inheritedQueries;
+  supported.timestampQueries = deviceProperties.limits.timestampComputeAndGraphics;
+  return supported;
+}
+
+DeviceScore Device::scorePhysicalDevice(VkPhysicalDevice device) const {
+  DeviceScore score{};
+
+  VkPhysicalDeviceProperties deviceProperties;
+  vkGetPhysicalDeviceProperties(device, &deviceProperties);
+  switch (deviceProperties.deviceType) {
+  case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: score.type = 1000; break;
+  case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: score.type = 500; break;
+  case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: score.type = 250; break;
+  default: score.type = 0; break;
+  }
+
+  // 1 point per 256MiB of the largest device local heap
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  vkGetPhysicalDeviceMemoryProperties(device, &memoryProperties);
+  VkDeviceSize deviceLocal = 0;
+  for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+    const auto& heap = memoryProperties.memoryHeaps[i];
+    if (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+      deviceLocal = std::max(deviceLocal, heap.size);
+  }
+  score.memory = static_cast<uint32_t>(deviceLocal / (256ull * 1024 * 1024));
+
+  uint32_t queueFamilyCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+  std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+  bool asyncCompute = false, dedicatedTransfer = false;
+  for (const auto& family : queueFamilies) {
+    if ((family.queueFlags & VK_QUEUE_COMPUTE_BIT) && !(family.queueFlags & VK_QUEUE_GRAPHICS_BIT))
+      asyncCompute = true;
+    if ((family.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(family.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+      dedicatedTransfer = true;
+  }
+  QueueFamilyIndices indices = findQueueFamilies(device);
+  score.queues = (asyncCompute ? 50 : 0) + (dedicatedTransfer ? 50 : 0) +
+    (indices.graphicsFamily == indices.presentFamily ? 25 : 0);
+
+  OptionalFeatures supported = queryOptionalFeatures(device);
+  for (bool feature : {
+    supported.multiDrawIndirect,
+    supported.drawIndirectFirstInstance,
+    supported.pipelineStatisticsQuery,
+    supported.timestampQueries })
+    score.features += feature ? 20 : 0;
+  return score;
 }
 
 void Device::createLogicalDevice() {
@@ -155,16 +303,34 @@ void Device::createLogicalDevice() {
     queueCreateInfos.push_back(queueCreateInfo);
   }
 
-  VkPhysicalDeviceFeatures deviceFeatures = {};
-  deviceFeatures.samplerAnisotropy = VK_TRUE;
+  VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+  vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+  vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+  vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+  vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+  vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+
+  VkPhysicalDeviceFeatures2 deviceFeatures = {};
+  deviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  deviceFeatures.pNext = &vulkan12Features;
+  deviceFeatures.features.samplerAnisotropy = VK_TRUE;
+  // the bindless arrays are indexed with push constants
+  deviceFeatures.features.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+  deviceFeatures.features.shaderStorageBufferArrayDynamicIndexing = VK_TRUE;
+  deviceFeatures.features.multiDrawIndirect = optionalFeatures.multiDrawIndirect;
+  deviceFeatures.features.drawIndirectFirstInstance = optionalFeatures.drawIndirectFirstInstance;
+  deviceFeatures.features.pipelineStatisticsQuery = optionalFeatures.pipelineStatisticsQuery;
+  deviceFeatures.features.inheritedQueries = optionalFeatures.pipelineStatisticsQuery;
 
   VkDeviceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  createInfo.pNext = &deviceFeatures;
 
   createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
   createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
-  createInfo.pEnabledFeatures = &deviceFeatures;
+  createInfo.pEnabledFeatures = nullptr;
   createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
   createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
@@ -182,6 +348,7 @@ void Device::createLogicalDevice() {
     throw std::runtime_error("failed to create logical device!");
   }
 
+  directDispatch.load(instanceDispatch, _device);
   vkGetDeviceQueue(_device, indices.graphicsFamily, 0, &_graphicsQueue);
   vkGetDeviceQueue(_device, indices.presentFamily, 0, &_presentQueue);
 }
@@ -217,7 +384,29 @@ bool Device::isDeviceSuitable(VkPhysicalDevice device) {
   vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
   return indices.isComplete() && extensionsSupported && swapChainAdequate &&
-    supportedFeatures.samplerAnisotropy;
+    supportedFeatures.samplerAnisotropy && checkDescriptorIndexingSupport(device);
+}
+
+bool Device::checkDescriptorIndexingSupport(VkPhysicalDevice device) const {
+  VkPhysicalDeviceProperties deviceProperties;
+  vkGetPhysicalDeviceProperties(device, &deviceProperties);
+  if (deviceProperties.apiVersion < VK_API_VERSION_1_2)
+    return false;
+
+  VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+  vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  VkPhysicalDeviceFeatures2 features = {};
+  features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features.pNext = &vulkan12Features;
+  vkGetPhysicalDeviceFeatures2(device, &features);
+
+  return features.features.shaderSampledImageArrayDynamicIndexing &&
+    features.features.shaderStorageBufferArrayDynamicIndexing &&
+    vulkan12Features.runtimeDescriptorArray &&
+    vulkan12Features.descriptorBindingPartiallyBound &&
+    vulkan12Features.descriptorBindingUpdateUnusedWhilePending &&
+    vulkan12Features.descriptorBindingSampledImageUpdateAfterBind &&
+    vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind;
 }
 
 void Device::populateDebugMessengerCreateInfo(
@@ -357,22 +546,22 @@ QueueFamilyIndices Device::findQueueFamilies(VkPhysicalDevice device) const {
 
 SwapChainSupportDetails Device::querySwapChainSupport(VkPhysicalDevice device) const {
   SwapChainSupportDetails details;
-  vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, _surface, &details.capabilities);
+  instanceDispatch.vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, _surface, &details.capabilities);
 
   uint32_t formatCount;
-  vkGetPhysicalDeviceSurfaceFormatsKHR(device, _surface, &formatCount, nullptr);
+  instanceDispatch.vkGetPhysicalDeviceSurfaceFormatsKHR(device, _surface, &formatCount, nullptr);
 
   if (formatCount != 0) {
     details.formats.resize(formatCount);
-    vkGetPhysicalDeviceSurfaceFormatsKHR(device, _surface, &formatCount, details.formats.data());
+    instanceDispatch.vkGetPhysicalDeviceSurfaceFormatsKHR(device, _surface, &formatCount, details.formats.data());
   }
 
   uint32_t presentModeCount;
-  vkGetPhysicalDeviceSurfacePresentModesKHR(device, _surface, &presentModeCount, nullptr);
+  instanceDispatch.vkGetPhysicalDeviceSurfacePresentModesKHR(device, _surface, &presentModeCount, nullptr);
 
   if (presentModeCount != 0) {
     details.presentModes.resize(presentModeCount);
-    vkGetPhysicalDeviceSurfacePresentModesKHR(
+    instanceDispatch.vkGetPhysicalDeviceSurfacePresentModesKHR(
       device,
       _surface,
       &presentModeCount,
@@ -398,6 +587,12 @@ VkFormat Device::findSupportedFormat(
   throw std::runtime_error("failed to find supported format!");
 }
 
+VkFormatProperties Device::getFormatProperties(VkFormat format) const {
+  VkFormatProperties props;
+  vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
+  return props;
+}
+
 uint32_t Device::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
   VkPhysicalDeviceMemoryProperties memProperties;
   vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
@@ -474,12 +669,13 @@ void Device::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
   vkFreeCommandBuffers(_device, commandPool, 1, &commandBuffer);
 }
 
-void Device::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
+void Device::copyBuffer(
+  VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset, VkDeviceSize dstOffset) {
   VkCommandBuffer commandBuffer = beginSingleTimeCommands();
 
   VkBufferCopy copyRegion{};
-  copyRegion.srcOffset = 0;  // Optional
-  copyRegion.dstOffset = 0;  // Optional
+  copyRegion.srcOffset = srcOffset;
+  copyRegion.dstOffset = dstOffset;
   copyRegion.size = size;
   vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
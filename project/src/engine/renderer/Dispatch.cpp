@@ -0,0 +1,34 @@
+#include "engine/renderer/Dispatch.h"
+
+#include <stdexcept>
+
+using Scop::Renderer::InstanceDispatch;
+using Scop::Renderer::DeviceDispatch;
+
+void InstanceDispatch::load(VkInstance instance) {
+#define SCOP_LOAD_PFN(name) \
+  this->name = reinterpret_cast<PFN_##name>(vkGetInstanceProcAddr(instance, #name)); \
+  if (!this->name) \
+    throw std::runtime_error("Failed to load instance function " #name);
+
+  SCOP_INSTANCE_FUNCTIONS(SCOP_LOAD_PFN)
+#undef SCOP_LOAD_PFN
+}
+
+void DeviceDispatch::load(const InstanceDispatch& instanceDispatch, VkDevice device) {
+#define SCOP_LOAD_PFN(name) \
+  this->name = reinterpret_cast<PFN_##name>(instanceDispatch.vkGetDeviceProcAddr(device, #name)); \
+  if (!this->name) \
+    throw std::runtime_error("Failed to load device function " #name);
+
+  SCOP_DEVICE_FUNCTIONS(SCOP_LOAD_PFN)
+#undef SCOP_LOAD_PFN
+}
+
+DeviceDispatch DeviceDispatch::Loader() {
+  DeviceDispatch dispatch{};
+#define SCOP_LOADER_PFN(name) dispatch.name = &::name;
+  SCOP_DEVICE_FUNCTIONS(SCOP_LOADER_PFN)
+#undef SCOP_LOADER_PFN
+  return dispatch;
+}
@@ -0,0 +1,38 @@
+#include "engine/renderer/DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+using Scop::Renderer::DynamicResolution;
+
+void DynamicResolution::update(float frameMs) {
+  if (!this->enabled || frameMs <= 0.0f)
+    return;
+  if (frameMs > this->budgetMs) {
+    this->fastFrames = 0;
+    if (++this->slowFrames < SETTLE_FRAMES)
+      return;
+    // the cost follows the pixel count, at least one step down
+    float target = this->scale * std::sqrt(this->budgetMs / frameMs);
+    float stepped = std::floor(target / STEP) * STEP;
+    this->scale = std::max(std::min(stepped, this->scale - STEP), MIN_SCALE);
+    this->slowFrames = 0;
+  }
+  else if (frameMs < this->budgetMs * HEADROOM) {
+    this->slowFrames = 0;
+    if (++this->fastFrames < SETTLE_FRAMES)
+      return;
+    this->scale = std::min(this->scale + STEP, 1.0f);
+    this->fastFrames = 0;
+  }
+  else {
+    this->slowFrames = 0;
+    this->fastFrames = 0;
+  }
+}
+
+void DynamicResolution::setEnabled(bool enabled) {
+  this->enabled = enabled;
+  this->slowFrames = 0;
+  this->fastFrames = 0;
+}
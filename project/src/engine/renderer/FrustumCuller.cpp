@@ -0,0 +1,159 @@
+#include "engine/renderer/FrustumCuller.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <thread>
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+using Scop::Renderer::FrustumCuller;
+
+void FrustumCuller::clear() {
+  this->centerX.clear();
+  this->centerY.clear();
+  this->centerZ.clear();
+  this->extentX.clear();
+  this->extentY.clear();
+  this->extentZ.clear();
+}
+
+void FrustumCuller::reserve(size_t count) {
+  this->centerX.reserve(count);
+  this->centerY.reserve(count);
+  this->centerZ.reserve(count);
+  this->extentX.reserve(count);
+  this->extentY.reserve(count);
+  this->extentZ.reserve(count);
+}
+
+void FrustumCuller::add(const glm::mat4& transform, const Model::Bounds& bounds) {
+  glm::vec3 center = glm::vec3(transform * glm::vec4((bounds.min + bounds.max) * 0.5f, 1.0f));
+  glm::vec3 extent = (bounds.max - bounds.min) * 0.5f;
+  // the box of the transformed box, from the absolute rotation and scale
+  glm::mat3 absolute{ glm::abs(glm::vec3(transform[0])), glm::abs(glm::vec3(transform[1])), glm::abs(glm::vec3(transform[2])) };
+  extent = absolute * extent;
+  this->centerX.push_back(center.x);
+  this->centerY.push_back(center.y);
+  this->centerZ.push_back(center.z);
+  this->extentX.push_back(extent.x);
+  this->extentY.push_back(extent.y);
+  this->extentZ.push_back(extent.z);
+}
+
+FrustumCuller::Planes FrustumCuller::ExtractPlanes(const glm::mat4& m) {
+  // Gribb-Hartmann, rows of the column major clip matrix, depth is [0, 1]
+  auto row = [&](int i) { return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]); };
+  std::array<glm::vec4, 6> rows = {
+    row(3) + row(0),
+    row(3) - row(0),
+    row(3) + row(1),
+    row(3) - row(1),
+    row(2),
+    row(3) - row(2),
+  };
+  Planes planes{};
+  for (size_t i = 0; i < rows.size(); i++) {
+    glm::vec4 plane = rows[i] / glm::length(glm::vec3(rows[i]));
+    planes.x[i] = plane.x;
+    planes.y[i] = plane.y;
+    planes.z[i] = plane.z;
+    planes.w[i] = plane.w;
+    planes.absX[i] = std::abs(plane.x);
+    planes.absY[i] = std::abs(plane.y);
+    planes.absZ[i] = std::abs(plane.z);
+  }
+  return planes;
+}
+
+void FrustumCuller::cullRange(const Planes& planes, uint32_t first, uint32_t last, std::vector<uint32_t>& visible) const {
+  // a box is outside when it is fully behind one plane: dot(n, c) + w < -dot(|n|, e)
+  uint32_t i = first;
+#if defined(__AVX2__)
+  for (; i + 8 <= last; i += 8) {
+    __m256 cx = _mm256_loadu_ps(&this->centerX[i]);
+    __m256 cy = _mm256_loadu_ps(&this->centerY[i]);
+    __m256 cz = _mm256_loadu_ps(&this->centerZ[i]);
+    __m256 ex = _mm256_loadu_ps(&this->extentX[i]);
+    __m256 ey = _mm256_loadu_ps(&this->extentY[i]);
+    __m256 ez = _mm256_loadu_ps(&this->extentZ[i]);
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (size_t p = 0; p < 6; p++) {
+      __m256 distance = _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes.x[p]), cx), _mm256_mul_ps(_mm256_set1_ps(planes.y[p]), cy)),
+        _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes.z[p]), cz), _mm256_set1_ps(planes.w[p]))
+      );
+      __m256 radius = _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes.absX[p]), ex), _mm256_mul_ps(_mm256_set1_ps(planes.absY[p]), ey)),
+        _mm256_mul_ps(_mm256_set1_ps(planes.absZ[p]), ez)
+      );
+      inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_GE_OQ));
+    }
+    for (uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(inside)); mask; mask &= mask - 1)
+      visible.push_back(i + static_cast<uint32_t>(std::countr_zero(mask)));
+  }
+#elif defined(__SSE2__) || defined(_M_X64)
+  for (; i + 4 <= last; i += 4) {
+    __m128 cx = _mm_loadu_ps(&this->centerX[i]);
+    __m128 cy = _mm_loadu_ps(&this->centerY[i]);
+    __m128 cz = _mm_loadu_ps(&this->centerZ[i]);
+    __m128 ex = _mm_loadu_ps(&this->extentX[i]);
+    __m128 ey = _mm_loadu_ps(&this->extentY[i]);
+    __m128 ez = _mm_loadu_ps(&this->extentZ[i]);
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (size_t p = 0; p < 6; p++) {
+      __m128 distance = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes.x[p]), cx), _mm_mul_ps(_mm_set1_ps(planes.y[p]), cy)),
+        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes.z[p]), cz), _mm_set1_ps(planes.w[p]))
+      );
+      __m128 radius = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes.absX[p]), ex), _mm_mul_ps(_mm_set1_ps(planes.absY[p]), ey)),
+        _mm_mul_ps(_mm_set1_ps(planes.absZ[p]), ez)
+      );
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+    }
+    for (uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(inside)); mask; mask &= mask - 1)
+      visible.push_back(i + static_cast<uint32_t>(std::countr_zero(mask)));
+  }
+#endif
+  // tail, or everything without SIMD
+  for (; i < last; i++) {
+    bool inside = true;
+    for (size_t p = 0; p < 6 && inside; p++) {
+      float distance = planes.x[p] * this->centerX[i] + planes.y[p] * this->centerY[i] + planes.z[p] * this->centerZ[i] + planes.w[p];
+      float radius = planes.absX[p] * this->extentX[i] + planes.absY[p] * this->extentY[i] + planes.absZ[p] * this->extentZ[i];
+      inside = distance + radius >= 0.0f;
+    }
+    if (inside)
+      visible.push_back(i);
+  }
+}
+
+void FrustumCuller::cull(const glm::mat4& projectionView, std::vector<uint32_t>& visible, uint32_t threadCount) const {
+  const Planes planes = ExtractPlanes(projectionView);
+  const auto count = static_cast<uint32_t>(this->size());
+  uint32_t chunks = std::clamp<uint32_t>(count / MIN_OBJECTS_PER_THREAD, 1, std::max(threadCount, 1u));
+  if (chunks == 1) {
+    this->cullRange(planes, 0, count, visible);
+    return;
+  }
+
+  // contiguous chunks keep the output in add order once concatenated
+  std::vector<std::vector<uint32_t>> results(chunks);
+  std::vector<std::thread> workers;
+  workers.reserve(chunks - 1);
+  uint32_t chunkSize = (count + chunks - 1) / chunks;
+  for (uint32_t chunk = 1; chunk < chunks; chunk++) {
+    workers.emplace_back([&, chunk]() {
+      uint32_t first = chunk * chunkSize;
+      this->cullRange(planes, first, std::min(first + chunkSize, count), results[chunk]);
+      });
+  }
+  this->cullRange(planes, 0, std::min(chunkSize, count), results[0]);
+  for (auto& worker : workers)
+    worker.join();
+  for (const auto& result : results)
+    visible.insert(visible.end(), result.begin(), result.end());
+}
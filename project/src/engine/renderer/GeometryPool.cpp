@@ -0,0 +1,174 @@
+#include "engine/renderer/GeometryPool.h"
+
+#include <array>
+#include <cassert>
+#include <cstring>
+
+using Scop::Renderer::GeometryPool;
+using Scop::Renderer::MemBuffer;
+
+static constexpr VkBufferUsageFlags VertexUsage =
+  VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+  VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+static constexpr VkBufferUsageFlags IndexUsage =
+  VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+  VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+GeometryPool::GeometryPool(Device& device, std::vector<VkDeviceSize> vertexStrides) : device{ device } {
+  assert(!vertexStrides.empty() && "Geometry pool needs at least one vertex stream");
+  for (VkDeviceSize stride : vertexStrides)
+    this->vertexBuffers.push_back(this->createBuffer(stride, this->vertexRanges.getCapacity(), VertexUsage));
+  this->indexBuffer = this->createBuffer(sizeof(uint32_t), this->indexRanges.getCapacity(), IndexUsage);
+}
+
+GeometryPool::~GeometryPool() {}
+
+std::optional<uint32_t> GeometryPool::RangeAllocator::allocate(uint32_t count) {
+  for (auto it = this->freeBlocks.begin(); it != this->freeBlocks.end(); it++) {
+    auto [offset, size] = *it;
+    if (size < count)
+      continue;
+    this->freeBlocks.erase(it);
+    if (size > count)
+      this->freeBlocks.emplace(offset + count, size - count);
+    return offset;
+  }
+  if (this->end + count > this->capacity)
+    return std::nullopt;
+  uint32_t offset = this->end;
+  this->end += count;
+  return offset;
+}
+
+void GeometryPool::RangeAllocator::release(uint32_t offset, uint32_t count) {
+  auto next = this->freeBlocks.lower_bound(offset);
+  // merge with the following block
+  if (next != this->freeBlocks.end() && offset + count == next->first) {
+    count += next->second;
+    next = this->freeBlocks.erase(next);
+  }
+  // and with the previous one
+  if (next != this->freeBlocks.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == offset) {
+      offset = prev->first;
+      count += prev->second;
+      this->freeBlocks.erase(prev);
+    }
+  }
+  if (offset + count == this->end)
+    this->end = offset;
+  else
+    this->freeBlocks.emplace(offset, count);
+}
+
+std::unique_ptr<MemBuffer> GeometryPool::createBuffer(VkDeviceSize elementSize, uint32_t capacity, VkBufferUsageFlags usage) {
+  return std::make_unique<MemBuffer>(
+    this->device,
+    elementSize,
+    capacity,
+    usage,
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+  );
+}
+
+uint32_t GeometryPool::allocateRange(
+  RangeAllocator& ranges,
+  std::span<std::unique_ptr<MemBuffer>> buffers,
+  VkBufferUsageFlags usage,
+  uint32_t count
+) {
+  if (auto offset = ranges.allocate(count))
+    return *offset;
+
+  uint32_t capacity = ranges.getCapacity();
+  while (capacity < ranges.getEnd() + count)
+    capacity *= 2;
+
+  // only the used part needs to move, offsets stay valid
+  vkDeviceWaitIdle(this->device.getHandle());
+  for (auto& buffer : buffers) {
+    auto grown = this->createBuffer(buffer->getInstanceSize(), capacity, usage);
+    if (ranges.getEnd() > 0)
+      this->device.copyBuffer(buffer->getHandle(), grown->getHandle(), ranges.getEnd() * buffer->getInstanceSize());
+    buffer = std::move(grown);
+  }
+  ranges.setCapacity(capacity);
+  this->generation++;
+
+  auto offset = ranges.allocate(count);
+  assert(offset && "Geometry pool still full after growing");
+  return *offset;
+}
+
+void GeometryPool::upload(MemBuffer& buffer, const void* data, VkDeviceSize size, VkDeviceSize offset) {
+  MemBuffer stagingBuffer{
+    this->device,
+    size,
+    1,
+    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+  };
+  stagingBuffer.map();
+  stagingBuffer.writeTo(data);
+  this->device.copyBuffer(stagingBuffer.getHandle(), buffer.getHandle(), size, 0, offset);
+}
+
+void GeometryPool::download(MemBuffer& buffer, void* data, VkDeviceSize size, VkDeviceSize offset) {
+  MemBuffer stagingBuffer{
+    this->device,
+    size,
+    1,
+    VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+  };
+  stagingBuffer.map();
+  this->device.copyBuffer(buffer.getHandle(), stagingBuffer.getHandle(), size, offset, 0);
+  std::memcpy(data, stagingBuffer.getMappedMemory(), size);
+}
+
+GeometryPool::Allocation GeometryPool::allocate(
+  std::span<const void* const> streams,
+  uint32_t vertexCount,
+  const uint32_t* indices,
+  uint32_t indexCount
+) {
+  assert(vertexCount > 0 && indexCount > 0 && "Cannot allocate empty geometry");
+  assert(streams.size() == this->vertexBuffers.size() && "One vertex array per stream");
+  Allocation allocation{};
+  allocation.vertexCount = vertexCount;
+  allocation.indexCount = indexCount;
+  allocation.firstVertex = this->allocateRange(this->vertexRanges, this->vertexBuffers, VertexUsage, vertexCount);
+  allocation.firstIndex = this->allocateRange(this->indexRanges, { &this->indexBuffer, 1 }, IndexUsage, indexCount);
+
+  for (size_t i = 0; i < streams.size(); i++) {
+    VkDeviceSize stride = this->vertexBuffers[i]->getInstanceSize();
+    this->upload(*this->vertexBuffers[i], streams[i], vertexCount * stride, allocation.firstVertex * stride);
+  }
+  this->upload(*this->indexBuffer, indices, indexCount * sizeof(uint32_t), allocation.firstIndex * sizeof(uint32_t));
+  return allocation;
+}
+
+void GeometryPool::release(const Allocation& allocation) {
+  this->vertexRanges.release(allocation.firstVertex, allocation.vertexCount);
+  this->indexRanges.release(allocation.firstIndex, allocation.indexCount);
+}
+
+void GeometryPool::read(const Allocation& allocation, std::span<void* const> streams, uint32_t* indices) {
+  assert(streams.size() == this->vertexBuffers.size() && "One vertex array per stream");
+  for (size_t i = 0; i < streams.size(); i++) {
+    VkDeviceSize stride = this->vertexBuffers[i]->getInstanceSize();
+    this->download(*this->vertexBuffers[i], streams[i], allocation.vertexCount * stride, allocation.firstVertex * stride);
+  }
+  this->download(*this->indexBuffer, indices, allocation.indexCount * sizeof(uint32_t), allocation.firstIndex * sizeof(uint32_t));
+}
+
+void GeometryPool::bind(CommandRecorder& recorder) const {
+  std::array<VkBuffer, CommandRecorder::MAX_VERTEX_BINDINGS> buffers{};
+  std::array<VkDeviceSize, CommandRecorder::MAX_VERTEX_BINDINGS> offsets{};
+  assert(this->vertexBuffers.size() <= buffers.size() && "Too many vertex streams");
+  for (size_t i = 0; i < this->vertexBuffers.size(); i++)
+    buffers[i] = this->vertexBuffers[i]->getHandle();
+  recorder.bindVertexBuffers(0, this->getStreamCount(), buffers.data(), offsets.data());
+  recorder.bindIndexBuffer(this->indexBuffer->getHandle(), 0, VK_INDEX_TYPE_UINT32);
+}
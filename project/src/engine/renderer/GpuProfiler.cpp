@@ -0,0 +1,140 @@
+#include "engine/renderer/GpuProfiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+using Scop::Renderer::GpuProfiler;
+
+GpuProfiler::GpuProfiler(Device& device)
+  : device{ device },
+  supported{ device.getOptionalFeatures().timestampQueries },
+  statisticsSupported{ device.getOptionalFeatures().pipelineStatisticsQuery } {
+  if (this->statisticsSupported) {
+    VkQueryPoolCreateInfo statisticsInfo{};
+    statisticsInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    statisticsInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+    statisticsInfo.queryCount = 1;
+    statisticsInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+    for (auto& frame : this->frames) {
+      if (vkCreateQueryPool(this->device.getHandle(), &statisticsInfo, nullptr, &frame.statisticsPool) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create pipeline statistics query pool");
+    }
+  }
+  if (!this->supported)
+    return;
+  VkQueryPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  poolInfo.queryCount = MAX_SCOPES * 2;
+  for (auto& frame : this->frames) {
+    if (vkCreateQueryPool(this->device.getHandle(), &poolInfo, nullptr, &frame.pool) != VK_SUCCESS)
+      throw std::runtime_error("Failed to create timestamp query pool");
+  }
+}
+
+GpuProfiler::~GpuProfiler() {
+  for (auto& frame : this->frames) {
+    if (frame.pool != VK_NULL_HANDLE)
+      vkDestroyQueryPool(this->device.getHandle(), frame.pool, nullptr);
+    if (frame.statisticsPool != VK_NULL_HANDLE)
+      vkDestroyQueryPool(this->device.getHandle(), frame.statisticsPool, nullptr);
+  }
+}
+
+void GpuProfiler::collect(FrameQueries& queries) {
+  if (queries.statisticsWritten) {
+    uint64_t invocations = 0;
+    VkResult result = vkGetQueryPoolResults(
+      this->device.getHandle(),
+      queries.statisticsPool,
+      0, 1,
+      sizeof(uint64_t), &invocations,
+      sizeof(uint64_t),
+      VK_QUERY_RESULT_64_BIT
+    );
+    if (result == VK_SUCCESS)
+      this->fragmentInvocations = invocations;
+  }
+  if (queries.scopes.empty())
+    return;
+  std::array<uint64_t, MAX_SCOPES * 2> timestamps{};
+  uint32_t count = static_cast<uint32_t>(queries.scopes.size()) * 2;
+  VkResult result = vkGetQueryPoolResults(
+    this->device.getHandle(),
+    queries.pool,
+    0, count,
+    count * sizeof(uint64_t), timestamps.data(),
+    sizeof(uint64_t),
+    VK_QUERY_RESULT_64_BIT
+  );
+  if (result != VK_SUCCESS)
+    return;
+
+  const double period = this->device.properties.limits.timestampPeriod;
+  for (size_t i = 0; i < queries.scopes.size(); i++) {
+    double ms = static_cast<double>(timestamps[i * 2 + 1] - timestamps[i * 2]) * period / 1e6;
+    auto it = std::find_if(this->times.begin(), this->times.end(),
+      [&](const auto& time) { return time.first == queries.scopes[i]; });
+    if (it != this->times.end())
+      it->second = ms;
+    else
+      this->times.emplace_back(queries.scopes[i], ms);
+  }
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+  this->frameIndex = frameIndex;
+  auto& queries = this->frames[frameIndex];
+  // the fence of this slot has been waited on, its queries are done
+  this->collect(queries);
+  queries.scopes.clear();
+  queries.statisticsWritten = false;
+  if (this->statisticsSupported)
+    this->device.getDispatch().vkCmdResetQueryPool(commandBuffer, queries.statisticsPool, 0, 1);
+  if (this->supported)
+    this->device.getDispatch().vkCmdResetQueryPool(commandBuffer, queries.pool, 0, MAX_SCOPES * 2);
+}
+
+void GpuProfiler::beginScope(VkCommandBuffer commandBuffer, std::string_view name) {
+  if (!this->supported)
+    return;
+  auto& queries = this->frames[this->frameIndex];
+  if (queries.scopes.size() >= MAX_SCOPES)
+    return;
+  uint32_t query = static_cast<uint32_t>(queries.scopes.size()) * 2;
+  queries.scopes.emplace_back(name);
+  this->device.getDispatch().vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queries.pool, query);
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer, std::string_view name) {
+  if (!this->supported)
+    return;
+  auto& queries = this->frames[this->frameIndex];
+  auto it = std::find(queries.scopes.begin(), queries.scopes.end(), name);
+  if (it == queries.scopes.end())
+    return;
+  uint32_t query = static_cast<uint32_t>(it - queries.scopes.begin()) * 2 + 1;
+  this->device.getDispatch().vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queries.pool, query);
+}
+
+void GpuProfiler::beginStatistics(VkCommandBuffer commandBuffer) {
+  if (!this->statisticsSupported)
+    return;
+  auto& queries = this->frames[this->frameIndex];
+  this->device.getDispatch().vkCmdBeginQuery(commandBuffer, queries.statisticsPool, 0, 0);
+}
+
+void GpuProfiler::endStatistics(VkCommandBuffer commandBuffer) {
+  if (!this->statisticsSupported)
+    return;
+  auto& queries = this->frames[this->frameIndex];
+  this->device.getDispatch().vkCmdEndQuery(commandBuffer, queries.statisticsPool, 0);
+  queries.statisticsWritten = true;
+}
+
+double GpuProfiler::getTime(std::string_view name) const {
+  auto it = std::find_if(this->times.begin(), this->times.end(),
+    [&](const auto& time) { return time.first == name; });
+  return it != this->times.end() ? it->second : 0.0;
+}
@@ -0,0 +1,285 @@
+#include "engine/renderer/Impostors.h"
+#include <engine/renderer/CommandRecorder.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <glm/gtc/matrix_transform.hpp>
+
+using Scop::Renderer::Impostors;
+
+// matches PushConstantData in impostor_bake.vert
+struct ImpostorBakePushConstantData {
+  glm::mat4 projectionView;
+};
+
+// direction of the view baked into cell (x, y), matches the octahedral decode in impostor.vert
+static glm::vec3 CellDirection(uint32_t x, uint32_t y) {
+  glm::vec2 uv = (glm::vec2(x, y) + 0.5f) / static_cast<float>(Impostors::GRID) * 2.0f - 1.0f;
+  glm::vec3 direction{ uv.x, 1.0f - std::abs(uv.x) - std::abs(uv.y), uv.y };
+  if (direction.y < 0.0f) {
+    direction.x = (1.0f - std::abs(uv.y)) * (uv.x >= 0.0f ? 1.0f : -1.0f);
+    direction.z = (1.0f - std::abs(uv.x)) * (uv.y >= 0.0f ? 1.0f : -1.0f);
+  }
+  return glm::normalize(direction);
+}
+
+Impostors::Impostors(Device& device, LayoutCache& layoutCache, BindlessTable& bindlessTable, Model::VertexLayout vertexLayout)
+  : device{ device }, bindlessTable{ bindlessTable } {
+  this->depthFormat = this->device.findSupportedFormat(
+    { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
+    VK_IMAGE_TILING_OPTIMAL,
+    VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
+  );
+  this->createRenderPass();
+  this->pipelineLayout = layoutCache.getPipelineLayout(
+    {},
+    { { VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ImpostorBakePushConstantData) } }
+  );
+  Pipeline::ConfigInfo config{};
+  Pipeline::SetupDefaultConfigInfo(config);
+  Pipeline::SetVertexLayout(config, vertexLayout);
+  VkPipelineColorBlendAttachmentState output{};
+  output.colorWriteMask =
+    VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT |
+    VK_COLOR_COMPONENT_A_BIT;
+  output.blendEnable = VK_FALSE;
+  config.colorBlendAttachments = { output, output };
+  config.colorBlendingInfo.attachmentCount = static_cast<uint32_t>(config.colorBlendAttachments.size());
+  config.colorBlendingInfo.pAttachments = config.colorBlendAttachments.data();
+  config.renderPass = this->renderPass;
+  config.pipelineLayout = this->pipelineLayout;
+  this->pipeline = std::make_unique<Pipeline>(
+    this->device,
+    SHADERS_PATH"impostor_bake.vert.spv",
+    SHADERS_PATH"impostor_bake.frag.spv",
+    config
+  );
+
+  // filtered within a view, views are picked in the shader so they never bleed into each other
+  VkSamplerCreateInfo samplerInfo{};
+  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter = VK_FILTER_LINEAR;
+  samplerInfo.minFilter = VK_FILTER_LINEAR;
+  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  if (vkCreateSampler(this->device.getHandle(), &samplerInfo, nullptr, &this->sampler) != VK_SUCCESS)
+    throw std::runtime_error("Failed to create impostor sampler");
+}
+
+Impostors::~Impostors() {
+  for (auto& [id, atlas] : this->atlases) {
+    this->bindlessTable.releaseImage(atlas.colorIndex);
+    this->bindlessTable.releaseImage(atlas.normalIndex);
+    vkDestroyImageView(this->device.getHandle(), atlas.colorView, nullptr);
+    vkDestroyImage(this->device.getHandle(), atlas.colorImage, nullptr);
+    vkFreeMemory(this->device.getHandle(), atlas.colorMemory, nullptr);
+    vkDestroyImageView(this->device.getHandle(), atlas.normalView, nullptr);
+    vkDestroyImage(this->device.getHandle(), atlas.normalImage, nullptr);
+    vkFreeMemory(this->device.getHandle(), atlas.normalMemory, nullptr);
+  }
+  vkDestroySampler(this->device.getHandle(), this->sampler, nullptr);
+  vkDestroyRenderPass(this->device.getHandle(), this->renderPass, nullptr);
+}
+
+void Impostors::createRenderPass() {
+  // cleared to a coverage of 0, left ready to be sampled
+  VkAttachmentDescription colorAttachment{};
+  colorAttachment.format = COLOR_FORMAT;
+  colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  colorAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  VkAttachmentDescription normalAttachment = colorAttachment;
+  normalAttachment.format = NORMAL_FORMAT;
+
+  VkAttachmentDescription depthAttachment{};
+  depthAttachment.format = this->depthFormat;
+  depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+  std::array<VkAttachmentReference, 2> colorAttachmentRefs = {
+    VkAttachmentReference{ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
+    VkAttachmentReference{ 1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
+  };
+  VkAttachmentReference depthAttachmentRef{ 2, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+
+  VkSubpassDescription subpass = {};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = static_cast<uint32_t>(colorAttachmentRefs.size());
+  subpass.pColorAttachments = colorAttachmentRefs.data();
+  subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+  // the impostor pipelines sample the atlas
+  VkSubpassDependency dependency{};
+  dependency.srcSubpass = 0;
+  dependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+  dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  dependency.dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  dependency.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+  std::array<VkAttachmentDescription, 3> attachments = { colorAttachment, normalAttachment, depthAttachment };
+  VkRenderPassCreateInfo renderPassInfo = {};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+  renderPassInfo.pAttachments = attachments.data();
+  renderPassInfo.subpassCount = 1;
+  renderPassInfo.pSubpasses = &subpass;
+  renderPassInfo.dependencyCount = 1;
+  renderPassInfo.pDependencies = &dependency;
+  if (vkCreateRenderPass(this->device.getHandle(), &renderPassInfo, nullptr, &this->renderPass) != VK_SUCCESS)
+    throw std::runtime_error("Failed to create impostor render pass");
+}
+
+void Impostors::createImage(
+  VkFormat format,
+  VkImageUsageFlags usage,
+  VkImageAspectFlags aspect,
+  VkImage& image,
+  VkDeviceMemory& memory,
+  VkImageView& view
+) {
+  VkImageCreateInfo imageInfo{};
+  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageInfo.extent = { ATLAS_SIZE, ATLAS_SIZE, 1 };
+  imageInfo.mipLevels = 1;
+  imageInfo.arrayLayers = 1;
+  imageInfo.format = format;
+  imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  imageInfo.usage = usage;
+  imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  this->device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, memory);
+
+  VkImageViewCreateInfo viewInfo{};
+  viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewInfo.image = image;
+  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.format = format;
+  viewInfo.subresourceRange = { aspect, 0, 1, 0, 1 };
+  if (vkCreateImageView(this->device.getHandle(), &viewInfo, nullptr, &view) != VK_SUCCESS)
+    throw std::runtime_error("Failed to create impostor image view");
+}
+
+void Impostors::bake(Model& model) {
+  if (this->atlases.contains(model.getId()))
+    return;
+  Atlas atlas{};
+  constexpr VkImageUsageFlags targetUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+  this->createImage(COLOR_FORMAT, targetUsage, VK_IMAGE_ASPECT_COLOR_BIT, atlas.colorImage, atlas.colorMemory, atlas.colorView);
+  this->createImage(NORMAL_FORMAT, targetUsage, VK_IMAGE_ASPECT_COLOR_BIT, atlas.normalImage, atlas.normalMemory, atlas.normalView);
+  VkImage depthImage;
+  VkDeviceMemory depthMemory;
+  VkImageView depthView;
+  this->createImage(
+    this->depthFormat,
+    VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+    VK_IMAGE_ASPECT_DEPTH_BIT,
+    depthImage, depthMemory, depthView
+  );
+
+  std::array<VkImageView, 3> attachments = { atlas.colorView, atlas.normalView, depthView };
+  VkFramebufferCreateInfo framebufferInfo = {};
+  framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+  framebufferInfo.renderPass = this->renderPass;
+  framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+  framebufferInfo.pAttachments = attachments.data();
+  framebufferInfo.width = ATLAS_SIZE;
+  framebufferInfo.height = ATLAS_SIZE;
+  framebufferInfo.layers = 1;
+  VkFramebuffer framebuffer;
+  if (vkCreateFramebuffer(this->device.getHandle(), &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS)
+    throw std::runtime_error("Failed to create impostor framebuffer");
+
+  VkCommandBuffer commandBuffer = this->device.beginSingleTimeCommands();
+  const auto& dispatch = this->device.getDispatch();
+  CommandRecorder recorder;
+  recorder.begin(commandBuffer, dispatch);
+
+  std::array<VkClearValue, 3> clearValues{};
+  clearValues[0].color = { 0.0f, 0.0f, 0.0f, 0.0f };
+  clearValues[1].color = { 0.5f, 0.5f, 0.5f, 0.0f };
+  clearValues[2].depthStencil = { 1.0f, 0 };
+  VkRenderPassBeginInfo renderPassInfo{};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+  renderPassInfo.renderPass = this->renderPass;
+  renderPassInfo.framebuffer = framebuffer;
+  renderPassInfo.renderArea = { { 0, 0 }, { ATLAS_SIZE, ATLAS_SIZE } };
+  renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+  renderPassInfo.pClearValues = clearValues.data();
+  dispatch.vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+  this->pipeline->bind(recorder);
+  model.bind(recorder);
+
+  // every view is an orthographic projection of the bounding sphere, looking at its center
+  const glm::vec3 center{ model.getBoundingSphere() };
+  const float radius = std::max(model.getBoundingSphere().w, 1e-4f);
+  const glm::mat4 projection = glm::ortho(-radius, radius, -radius, radius, 0.0f, 2.0f * radius);
+  for (uint32_t y = 0; y < GRID; y++) {
+    for (uint32_t x = 0; x < GRID; x++) {
+      VkViewport viewport{
+        static_cast<float>(x * VIEW_SIZE), static_cast<float>(y * VIEW_SIZE),
+        static_cast<float>(VIEW_SIZE), static_cast<float>(VIEW_SIZE),
+        0.0f, 1.0f
+      };
+      VkRect2D scissor{ { static_cast<int32_t>(x * VIEW_SIZE), static_cast<int32_t>(y * VIEW_SIZE) }, { VIEW_SIZE, VIEW_SIZE } };
+      dispatch.vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+      dispatch.vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+      // same up vector as impostor.vert, away from the poles
+      const glm::vec3 direction = CellDirection(x, y);
+      const glm::vec3 up = std::abs(direction.y) > 0.999f ? glm::vec3{ 0.0f, 0.0f, 1.0f } : glm::vec3{ 0.0f, 1.0f, 0.0f };
+      ImpostorBakePushConstantData data{ projection * glm::lookAt(center + direction * radius, center, up) };
+      recorder.pushConstants(this->pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(data), &data);
+      model.draw(recorder);
+    }
+  }
+  dispatch.vkCmdEndRenderPass(commandBuffer);
+  this->device.endSingleTimeCommands(commandBuffer);
+
+  vkDestroyFramebuffer(this->device.getHandle(), framebuffer, nullptr);
+  vkDestroyImageView(this->device.getHandle(), depthView, nullptr);
+  vkDestroyImage(this->device.getHandle(), depthImage, nullptr);
+  vkFreeMemory(this->device.getHandle(), depthMemory, nullptr);
+
+  atlas.colorIndex = this->bindlessTable.registerImage(atlas.colorView, this->sampler);
+  atlas.normalIndex = this->bindlessTable.registerImage(atlas.normalView, this->sampler);
+  this->atlases.emplace(model.getId(), atlas);
+}
+
+const Impostors::Atlas* Impostors::find(const Model& model) const {
+  auto it = this->atlases.find(model.getId());
+  return it == this->atlases.end() ? nullptr : &it->second;
+}
+
+void Impostors::update(const glm::mat4& projection, const glm::vec3& cameraPosition, float viewportHeight) {
+  this->cameraPosition = cameraPosition;
+  this->pixelScale = projection[1][1] * viewportHeight * 0.5f;
+}
+
+bool Impostors::isDistant(const Model& model, const Components::Transform& transform) const {
+  if (!this->enabled || !this->atlases.contains(model.getId()))
+    return false;
+  const glm::vec4& sphere = model.getBoundingSphere();
+  const glm::vec3 center = glm::vec3(static_cast<glm::mat4>(transform) * glm::vec4(glm::vec3(sphere), 1.0f));
+  const glm::vec3 scale = glm::abs(transform.scale);
+  const float radius = sphere.w * std::max(scale.x, std::max(scale.y, scale.z));
+  const float distance = glm::length(center - this->cameraPosition);
+  // the camera inside the sphere always gets the real geometry
+  if (distance <= radius)
+    return false;
+  return 2.0f * radius * this->pixelScale / distance < this->threshold;
+}
@@ -0,0 +1,117 @@
+#include "engine/renderer/LayoutCache.h"
+#include <utils/hash.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+using Scop::Renderer::LayoutCache;
+using Scop::Renderer::DescriptorSetLayout;
+using Scop::Utils::HashCombine;
+
+LayoutCache::~LayoutCache() {
+  for (auto& [key, layout] : this->pipelineLayouts)
+    vkDestroyPipelineLayout(this->device.getHandle(), layout, nullptr);
+  this->pipelineLayouts.clear();
+  this->setLayouts.clear();
+}
+
+bool LayoutCache::SetLayoutKey::operator==(const SetLayoutKey& other) const {
+  return this->layoutFlags == other.layoutFlags && this->bindingFlags == other.bindingFlags && std::equal(
+    this->bindings.begin(), this->bindings.end(),
+    other.bindings.begin(), other.bindings.end(),
+    [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) {
+      return a.binding == b.binding &&
+        a.descriptorType == b.descriptorType &&
+        a.descriptorCount == b.descriptorCount &&
+        a.stageFlags == b.stageFlags &&
+        a.pImmutableSamplers == b.pImmutableSamplers;
+    });
+}
+
+bool LayoutCache::PipelineLayoutKey::operator==(const PipelineLayoutKey& other) const {
+  return this->setLayouts == other.setLayouts && std::equal(
+    this->pushConstantRanges.begin(), this->pushConstantRanges.end(),
+    other.pushConstantRanges.begin(), other.pushConstantRanges.end(),
+    [](const VkPushConstantRange& a, const VkPushConstantRange& b) {
+      return a.stageFlags == b.stageFlags && a.offset == b.offset && a.size == b.size;
+    });
+}
+
+size_t LayoutCache::KeyHash::operator()(const SetLayoutKey& key) const {
+  size_t seed = key.bindings.size();
+  HashCombine(seed, key.layoutFlags);
+  for (const auto flags : key.bindingFlags)
+    HashCombine(seed, flags);
+  for (const auto& binding : key.bindings) {
+    HashCombine(
+      seed,
+      binding.binding,
+      static_cast<uint32_t>(binding.descriptorType),
+      binding.descriptorCount,
+      binding.stageFlags,
+      binding.pImmutableSamplers
+    );
+  }
+  return seed;
+}
+
+size_t LayoutCache::KeyHash::operator()(const PipelineLayoutKey& key) const {
+  size_t seed = key.setLayouts.size();
+  for (const auto layout : key.setLayouts)
+    HashCombine(seed, layout);
+  for (const auto& range : key.pushConstantRanges)
+    HashCombine(seed, range.stageFlags, range.offset, range.size);
+  return seed;
+}
+
+std::shared_ptr<DescriptorSetLayout> LayoutCache::getSetLayout(
+  const DescriptorSetLayout::BindingsMap& bindings,
+  const DescriptorSetLayout::BindingFlagsMap& bindingFlags,
+  VkDescriptorSetLayoutCreateFlags layoutFlags
+) {
+  // the map is unordered, sort by binding slot so equal layouts produce equal keys
+  SetLayoutKey key{};
+  key.layoutFlags = layoutFlags;
+  key.bindings.reserve(bindings.size());
+  for (const auto& [slot, binding] : bindings)
+    key.bindings.push_back(binding);
+  std::sort(key.bindings.begin(), key.bindings.end(),
+    [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) {
+      return a.binding < b.binding;
+    });
+  key.bindingFlags.reserve(key.bindings.size());
+  for (const auto& binding : key.bindings) {
+    auto flags = bindingFlags.find(binding.binding);
+    key.bindingFlags.push_back(flags != bindingFlags.end() ? flags->second : 0);
+  }
+
+  auto it = this->setLayouts.find(key);
+  if (it != this->setLayouts.end())
+    return it->second;
+  auto layout = std::make_shared<DescriptorSetLayout>(this->device, bindings, bindingFlags, layoutFlags);
+  this->setLayouts.emplace(std::move(key), layout);
+  return layout;
+}
+
+VkPipelineLayout LayoutCache::getPipelineLayout(
+  const std::vector<VkDescriptorSetLayout>& setLayouts,
+  const std::vector<VkPushConstantRange>& pushConstantRanges
+) {
+  PipelineLayoutKey key{ setLayouts, pushConstantRanges };
+  auto it = this->pipelineLayouts.find(key);
+  if (it != this->pipelineLayouts.end())
+    return it->second;
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+  pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+  pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+  pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+
+  VkPipelineLayout layout;
+  if (vkCreatePipelineLayout(this->device.getHandle(), &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS)
+    throw std::runtime_error("Failed to create pipeline layout");
+  this->pipelineLayouts.emplace(std::move(key), layout);
+  return layout;
+}
@@ -1,10 +1,12 @@
 #include "engine/renderer/Model.h"
 #include <utils/hash.h>
 
+#include <atomic>
 #include <cassert>
 #include <cstring>
 #include <stdexcept>
 #include <iostream>
+#include <numeric>
 #include <unordered_map>
 
 #define TINYOBJLOADER_IMPLEMENTATION
@@ -25,101 +27,61 @@ namespace std {
   };
 };
 
+static std::atomic<uint32_t> NextModelId{ 0 };
+
 Model::Model(
   Renderer::Device& device,
+  GeometryPool& pool,
   const Builder& builder
-) : device{ device } {
-  this->createVertexBuffer(builder.vertices);
-  this->createIndexBuffer(builder.indices);
+) : device{ device }, pool{ pool }, id{ NextModelId++ } {
+  uint32_t vertexCount = static_cast<uint32_t>(builder.vertices.size());
+  assert(vertexCount >= 3 && "vertex count must be at least 3");
+  this->bounds = builder.computeBounds();
+
+  if (builder.indices.empty()) {
+    std::vector<uint32_t> indices(vertexCount);
+    std::iota(indices.begin(), indices.end(), 0u);
+    this->allocation = Model::Upload(pool, builder.vertices, indices);
+  }
+  else
+    this->allocation = Model::Upload(pool, builder.vertices, builder.indices);
 }
 
-Model::~Model() {}
-
-void Model::createVertexBuffer(const std::vector<Vertex>& vertices) {
-  this->vertexCount = static_cast<uint32_t>(vertices.size());
-  assert(this->vertexCount >= 3 && "vertex count must be at least 3");
-  size_t vertexSize = sizeof(Vertex);
-  VkDeviceSize bufferSize = vertexSize * this->vertexCount;
-  MemBuffer stagingBuffer{
-    this->device,
-    vertexSize,
-    vertexCount,
-    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-  };
-
-  stagingBuffer.map();
-  stagingBuffer.writeTo(vertices.data());
-
-  this->vertexBuffer = std::make_unique<MemBuffer>(
-    this->device,
-    vertexSize,
-    vertexCount,
-    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-  );
-
-  this->device.copyBuffer(
-    static_cast<VkBuffer>(stagingBuffer),
-    static_cast<VkBuffer>(*this->vertexBuffer),
-    bufferSize
-  );
+Model::~Model() {
+  this->pool.release(this->allocation);
 }
 
-void Model::createIndexBuffer(const std::vector<uint32_t>& indices) {
-  this->indexCount = static_cast<uint32_t>(indices.size());
-  this->hasIndexBuffer = this->indexCount > 0;
-  if (!this->hasIndexBuffer)
-    return;
-  size_t indexSize = sizeof(uint32_t);
-  VkDeviceSize bufferSize = indexSize * this->indexCount;
-
-  MemBuffer stagingBuffer{
-    this->device,
-    indexSize,
-    this->indexCount,
-    VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-  };
-
-  stagingBuffer.map();
-  stagingBuffer.writeTo(indices.data());
-
-  this->indexBuffer = std::make_unique<MemBuffer>(
-    this->device,
-    indexSize,
-    this->indexCount,
-    VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-  );
-
-  this->device.copyBuffer(
-    static_cast<VkBuffer>(stagingBuffer),
-    static_cast<VkBuffer>(*this->indexBuffer),
-    bufferSize
-  );
+void Model::bind(CommandRecorder& recorder) {
+  this->pool.bind(recorder);
 }
 
-void Model::bind(VkCommandBuffer commandBuffer) {
-  VkBuffer buffers[] = { static_cast<VkBuffer>(*this->vertexBuffer) };
-  VkDeviceSize offsets[] = { 0 };
-  vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
-  if (this->hasIndexBuffer)
-    vkCmdBindIndexBuffer(
-      commandBuffer,
-      static_cast<VkBuffer>(*this->indexBuffer),
-      0, VK_INDEX_TYPE_UINT32
-    );
+void Model::draw(CommandRecorder& recorder, uint32_t instanceCount, uint32_t firstInstance) {
+  recorder.drawIndexed(
+    this->allocation.indexCount,
+    instanceCount,
+    this->allocation.firstIndex,
+    static_cast<int32_t>(this->allocation.firstVertex),
+    firstInstance
+  );
 }
 
-void Model::draw(VkCommandBuffer commandBuffer) {
-  if (this->hasIndexBuffer)
-    vkCmdDrawIndexed(commandBuffer, this->indexCount, 1, 0, 0, 0);
-  else
-    vkCmdDraw(commandBuffer, this->vertexCount, 1, 0, 0);
+VkDrawIndexedIndirectCommand Model::getIndirectCommand(uint32_t instanceCount, uint32_t firstInstance) const {
+  return {
+    this->allocation.indexCount,
+    instanceCount,
+    this->allocation.firstIndex,
+    static_cast<int32_t>(this->allocation.firstVertex),
+    firstInstance
+  };
 }
 
-std::vector<VkVertexInputBindingDescription> Model::Vertex::GetBindingDescriptions() {
+std::vector<VkVertexInputBindingDescription> Model::Vertex::GetBindingDescriptions(VertexLayout layout) {
+  if (layout == VertexLayout::SplitPosition) {
+    return {
+      { 0, sizeof(glm::vec3), VK_VERTEX_INPUT_RATE_VERTEX },
+      { 1, sizeof(VertexAttributes), VK_VERTEX_INPUT_RATE_VERTEX },
+    };
+  }
   std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
   bindingDescriptions[0].binding = 0;
   bindingDescriptions[0].stride = sizeof(Vertex);
@@ -127,9 +89,16 @@ std::vector<VkVertexInputBindingDescription> Model::Vertex::GetBindingDescriptio
   return bindingDescriptions;
 }
 
-std::vector<VkVertexInputAttributeDescription> Model::Vertex::GetAttributeDescriptions() {
+std::vector<VkVertexInputAttributeDescription> Model::Vertex::GetAttributeDescriptions(VertexLayout layout) {
   std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
 
+  if (layout == VertexLayout::SplitPosition) {
+    attributeDescriptions.push_back({ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0 });
+    attributeDescriptions.push_back({ 1, 1, VK_FORMAT_R32G32B32_SFLOAT, offsetof(VertexAttributes, color) });
+    attributeDescriptions.push_back({ 2, 1, VK_FORMAT_R32G32B32_SFLOAT, offsetof(VertexAttributes, normal) });
+    attributeDescriptions.push_back({ 3, 1, VK_FORMAT_R32G32_SFLOAT, offsetof(VertexAttributes, uv) });
+    return attributeDescriptions;
+  }
   attributeDescriptions.push_back({ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position) });
   attributeDescriptions.push_back({ 1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, color) });
   attributeDescriptions.push_back({ 2, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, normal) });
@@ -138,12 +107,82 @@ std::vector<VkVertexInputAttributeDescription> Model::Vertex::GetAttributeDescri
   return attributeDescriptions;
 }
 
-std::unique_ptr<Model> Model::CreateFromFile(Device& device, const std::string_view filePath) {
+std::vector<VkDeviceSize> Model::GetVertexStrides(VertexLayout layout) {
+  if (layout == VertexLayout::SplitPosition)
+    return { sizeof(glm::vec3), sizeof(VertexAttributes) };
+  return { sizeof(Vertex) };
+}
+
+Model::VertexLayout Model::GetVertexLayout(const GeometryPool& pool) {
+  return pool.getStreamCount() > 1 ? VertexLayout::SplitPosition : VertexLayout::Interleaved;
+}
+
+Scop::Renderer::GeometryPool::Allocation Model::Upload(
+  GeometryPool& pool,
+  std::span<const Vertex> vertices,
+  std::span<const uint32_t> indices
+) {
+  const auto vertexCount = static_cast<uint32_t>(vertices.size());
+  const auto indexCount = static_cast<uint32_t>(indices.size());
+  if (Model::GetVertexLayout(pool) == VertexLayout::Interleaved) {
+    const void* streams[] = { vertices.data() };
+    return pool.allocate(streams, vertexCount, indices.data(), indexCount);
+  }
+  std::vector<glm::vec3> positions(vertices.size());
+  std::vector<VertexAttributes> attributes(vertices.size());
+  for (size_t i = 0; i < vertices.size(); i++) {
+    positions[i] = vertices[i].position;
+    attributes[i] = { vertices[i].color, vertices[i].normal, vertices[i].uv };
+  }
+  const void* streams[] = { positions.data(), attributes.data() };
+  return pool.allocate(streams, vertexCount, indices.data(), indexCount);
+}
+
+void Model::Download(
+  GeometryPool& pool,
+  const GeometryPool::Allocation& allocation,
+  std::span<Vertex> vertices,
+  std::span<uint32_t> indices
+) {
+  assert(vertices.size() >= allocation.vertexCount && indices.size() >= allocation.indexCount && "Download target too small");
+  if (Model::GetVertexLayout(pool) == VertexLayout::Interleaved) {
+    void* streams[] = { vertices.data() };
+    pool.read(allocation, streams, indices.data());
+    return;
+  }
+  std::vector<glm::vec3> positions(allocation.vertexCount);
+  std::vector<VertexAttributes> attributes(allocation.vertexCount);
+  void* streams[] = { positions.data(), attributes.data() };
+  pool.read(allocation, streams, indices.data());
+  for (uint32_t i = 0; i < allocation.vertexCount; i++)
+    vertices[i] = { positions[i], attributes[i].color, attributes[i].normal, attributes[i].uv };
+}
+
+std::unique_ptr<Model> Model::CreateFromFile(Device& device, GeometryPool& pool, const std::string_view filePath) {
   Builder builder{};
   if (!builder.loadModel(filePath))
     return nullptr;
   std::cout << "Loaded model " << filePath << " with " << builder.vertices.size() << " vertices" << std::endl;
-  return std::make_unique<Model>(device, builder);
+  return std::make_unique<Model>(device, pool, builder);
+}
+
+Model::Bounds Model::Builder::computeBounds() const {
+  Bounds bounds{};
+  if (this->vertices.empty())
+    return bounds;
+  bounds.min = this->vertices[0].position;
+  bounds.max = bounds.min;
+  for (const auto& vertex : this->vertices) {
+    bounds.min = glm::min(bounds.min, vertex.position);
+    bounds.max = glm::max(bounds.max, vertex.position);
+  }
+  // centered on the box, loose but cheap and stable
+  glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+  float radius = 0.0f;
+  for (const auto& vertex : this->vertices)
+    radius = glm::max(radius, glm::length(vertex.position - center));
+  bounds.sphere = glm::vec4(center, radius);
+  return bounds;
 }
 
 bool Model::Builder::loadModel(const std::string_view filePath) {
@@ -47,10 +47,12 @@ void Pipeline::createGraphicsPipeline(
   assert(configInfo.pipelineLayout != VK_NULL_HANDLE && "pipeline layout is null");
   assert(configInfo.renderPass != VK_NULL_HANDLE && "render pass is null");
   auto vertCode = this->ReadFile(vertFilePath);
-  auto fragCode = this->ReadFile(fragFilePath);
-
   this->createShaderModule(vertCode, &this->vertShaderModule);
-  this->createShaderModule(fragCode, &this->fragShaderModule);
+  // depth only pipelines have no fragment stage
+  if (!fragFilePath.empty()) {
+    auto fragCode = this->ReadFile(fragFilePath);
+    this->createShaderModule(fragCode, &this->fragShaderModule);
+  }
 
   VkPipelineShaderStageCreateInfo shaderStages[2];
   shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -78,7 +80,7 @@ void Pipeline::createGraphicsPipeline(
 
   VkGraphicsPipelineCreateInfo pipelineInfo{};
   pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-  pipelineInfo.stageCount = 2;
+  pipelineInfo.stageCount = this->fragShaderModule != VK_NULL_HANDLE ? 2 : 1;
   pipelineInfo.pStages = shaderStages;
   pipelineInfo.pVertexInputState = &vertexInputInfo;
   pipelineInfo.pInputAssemblyState = &configInfo.inputAssemblyInfo;
@@ -188,6 +190,11 @@ void Pipeline::SetupDefaultConfigInfo(Pipeline::ConfigInfo& configInfo) {
   configInfo.attributeDescriptions = Model::Vertex::GetAttributeDescriptions();
 }
 
+void Pipeline::SetVertexLayout(Pipeline::ConfigInfo& configInfo, Model::VertexLayout layout) {
+  configInfo.bindingDescriptions = Model::Vertex::GetBindingDescriptions(layout);
+  configInfo.attributeDescriptions = Model::Vertex::GetAttributeDescriptions(layout);
+}
+
 void Pipeline::EnableAlphaBlending(Pipeline::ConfigInfo& configInfo) {
   configInfo.colorBlendAttachment.colorWriteMask =
     VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT |
@@ -201,6 +208,55 @@ void Pipeline::EnableAlphaBlending(Pipeline::ConfigInfo& configInfo) {
   configInfo.colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
 }
 
-void Pipeline::bind(VkCommandBuffer commandBuffer) {
-  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, this->graphicsPipeline);
+void Pipeline::EnableWeightedBlending(Pipeline::ConfigInfo& configInfo) {
+  // sum of the weighted premultiplied colors and of the weights
+  VkPipelineColorBlendAttachmentState accumulation{};
+  accumulation.colorWriteMask =
+    VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT |
+    VK_COLOR_COMPONENT_A_BIT;
+  accumulation.blendEnable = VK_TRUE;
+  accumulation.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+  accumulation.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+  accumulation.colorBlendOp = VK_BLEND_OP_ADD;
+  accumulation.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+  accumulation.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+  accumulation.alphaBlendOp = VK_BLEND_OP_ADD;
+  // product of (1 - alpha)
+  VkPipelineColorBlendAttachmentState revealage{};
+  revealage.colorWriteMask = VK_COLOR_COMPONENT_R_BIT;
+  revealage.blendEnable = VK_TRUE;
+  revealage.srcColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+  revealage.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_COLOR;
+  revealage.colorBlendOp = VK_BLEND_OP_ADD;
+  revealage.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+  revealage.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+  revealage.alphaBlendOp = VK_BLEND_OP_ADD;
+
+  configInfo.colorBlendAttachments = { accumulation, revealage };
+  configInfo.colorBlendingInfo.attachmentCount = static_cast<uint32_t>(configInfo.colorBlendAttachments.size());
+  configInfo.colorBlendingInfo.pAttachments = configInfo.colorBlendAttachments.data();
+  configInfo.depthStencilInfo.depthWriteEnable = VK_FALSE;
+}
+
+void Pipeline::EnableGBufferOutputs(Pipeline::ConfigInfo& configInfo) {
+  VkPipelineColorBlendAttachmentState output{};
+  output.colorWriteMask =
+    VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT |
+    VK_COLOR_COMPONENT_A_BIT;
+  output.blendEnable = VK_FALSE;
+
+  configInfo.colorBlendAttachments = { output, output, output };
+  configInfo.colorBlendingInfo.attachmentCount = static_cast<uint32_t>(configInfo.colorBlendAttachments.size());
+  configInfo.colorBlendingInfo.pAttachments = configInfo.colorBlendAttachments.data();
+}
+
+void Pipeline::EnableDepthOnly(Pipeline::ConfigInfo& configInfo) {
+  // the position is the first attribute and binding 0 in every layout
+  configInfo.attributeDescriptions.resize(1);
+  configInfo.bindingDescriptions.resize(1);
+  configInfo.colorBlendAttachment.colorWriteMask = 0;
+}
+
+void Pipeline::bind(CommandRecorder& recorder) {
+  recorder.bindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, this->graphicsPipeline);
 }
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include "engine/renderer/RenderQueue.h"
+#include <utils/RadixSort.h>
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <stdexcept>
+
+using Scop::Renderer::RenderQueue;
+
+uint16_t RenderQueue::registerOwner(Owner& owner) {
+  auto it = std::find(this->owners.begin(), this->owners.end(), nullptr);
+  if (it != this->owners.end()) {
+    *it = &owner;
+    return static_cast<uint16_t>(it - this->owners.begin());
+  }
+  if (this->owners.size() >= MAX_OWNERS)
+    throw std::runtime_error("Too many render queue owners");
+  this->owners.push_back(&owner);
+  return static_cast<uint16_t>(this->owners.size() - 1);
+}
+
+void RenderQueue::unregisterOwner(uint16_t id) {
+  assert(id < this->owners.size() && "Unknown render queue owner");
+  this->owners[id] = nullptr;
+}
+
+uint64_t RenderQueue::MakeKey(Pass pass, uint16_t pipeline, uint32_t model, float depth) {
+  // positive floats order like their bit patterns, keep the top 24 of the 31 used bits
+  uint64_t quantized = (std::bit_cast<uint32_t>(std::max(depth, 0.f)) >> 7) & 0xffffff;
+  uint64_t pipelineBits = pipeline & 0x3fff;
+  uint64_t modelBits = model & 0xffffff;
+  uint64_t passBits = static_cast<uint64_t>(pass) << 62;
+  if (pass == Pass::Transparent || pass == Pass::LowResolution)
+    return passBits | ((0xffffff - quantized) << 38) | (pipelineBits << 24) | modelBits;
+  return passBits | (pipelineBits << 48) | (modelBits << 24) | quantized;
+}
+
+void RenderQueue::sort() {
+  Utils::RadixSort(this->packets, this->scratch, [](const Packet& packet) { return packet.key; });
+}
+
+template <typename Fn>
+void RenderQueue::forEachRun(std::span<const Packet> packets, Fn fn) const {
+  size_t first = 0;
+  while (first < packets.size()) {
+    uint16_t owner = packets[first].owner;
+    size_t last = first + 1;
+    while (last < packets.size() && packets[last].owner == owner)
+      last++;
+    if (this->owners[owner])
+      fn(*this->owners[owner], packets.subspan(first, last - first));
+    first = last;
+  }
+}
+
+void RenderQueue::prepare(const FrameInfo& frameInfo, Scene& scene) const {
+  this->forEachRun(this->packets, [&](Owner& owner, std::span<const Packet> packets) {
+    owner.preparePackets(frameInfo, scene, packets);
+    });
+}
+
+void RenderQueue::replay(const FrameInfo& frameInfo, Scene& scene) const {
+  this->forEachRun(this->packets, [&](Owner& owner, std::span<const Packet> packets) {
+    owner.drawPackets(frameInfo, scene, packets);
+    });
+}
+
+void RenderQueue::replay(const FrameInfo& frameInfo, Scene& scene, Pass pass) const {
+  auto passOf = [](const Packet& packet) { return static_cast<Pass>(packet.key >> 62); };
+  auto first = std::partition_point(this->packets.begin(), this->packets.end(),
+    [&](const Packet& packet) { return passOf(packet) < pass; });
+  auto last = std::partition_point(first, this->packets.end(),
+    [&](const Packet& packet) { return passOf(packet) == pass; });
+  this->forEachRun(std::span(first, last), [&](Owner& owner, std::span<const Packet> packets) {
+    owner.drawPackets(frameInfo, scene, packets);
+    });
+}
@@ -1,7 +1,9 @@
 #include "engine/renderer/Renderer.h"
 
+#include <algorithm>
 #include <stdexcept>
 #include <array>
+#include <cmath>
 
 using Scop::Renderer::Renderer;
 
@@ -31,6 +33,8 @@ void Renderer::recreateSwapchain() {
       throw std::runtime_error("Swapchain image or depth format has changed");
     }
   }
+  if (!this->swapchain->isUpscaleSupported())
+    this->renderScale = 1.0f;
 }
 
 void Renderer::createCommandBuffers() {
@@ -72,14 +76,85 @@ VkCommandBuffer Renderer::beginFrame() {
   VkCommandBufferBeginInfo beginInfo{};
   beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
-  if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+  if (this->device.getDispatch().vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
     throw std::runtime_error("Failed to begin recording command buffer");
+  this->recorder.begin(commandBuffer, this->device.getDispatch());
   return commandBuffer;
 }
+VkExtent2D Renderer::getRenderExtent() const {
+  VkExtent2D extent = this->swapchain->getExtent();
+  return {
+    std::max(static_cast<uint32_t>(std::lround(extent.width * this->renderScale)), 1u),
+    std::max(static_cast<uint32_t>(std::lround(extent.height * this->renderScale)), 1u)
+  };
+}
+
+void Renderer::setRenderScale(float scale) {
+  assert(!this->isFrameStarted && "Cannot change the render scale while frame is in progress");
+  this->renderScale = this->swapchain->isUpscaleSupported() ? std::clamp(scale, 0.01f, 1.0f) : 1.0f;
+}
+
+void Renderer::upscale(VkCommandBuffer commandBuffer) {
+  const VkExtent2D renderExtent = this->getRenderExtent();
+  const VkExtent2D extent = this->swapchain->getExtent();
+  VkImage sceneColor = this->swapchain->getSceneColorImage(this->currentImageIndex);
+  VkImage swapchainImage = this->swapchain->getImage(this->currentImageIndex);
+
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+  if (!this->swapchain->isUpscaleSupported()) {
+    // the passes rendered into the swapchain image at full resolution
+    barrier.image = swapchainImage;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    this->recorder.imageBarrier(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, barrier);
+    return;
+  }
+  barrier.image = sceneColor;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  this->recorder.imageBarrier(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, barrier);
+  // the previous contents are overwritten entirely
+  barrier.image = swapchainImage;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  this->recorder.imageBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, barrier);
+
+  VkImageBlit region{};
+  region.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+  region.srcOffsets[1] = { static_cast<int32_t>(renderExtent.width), static_cast<int32_t>(renderExtent.height), 1 };
+  region.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+  region.dstOffsets[1] = { static_cast<int32_t>(extent.width), static_cast<int32_t>(extent.height), 1 };
+  this->device.getDispatch().vkCmdBlitImage(
+    commandBuffer,
+    sceneColor, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+    swapchainImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+    1, &region,
+    this->swapchain->isLinearUpscaleSupported() ? VK_FILTER_LINEAR : VK_FILTER_NEAREST
+  );
+
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = 0;
+  this->recorder.imageBarrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, barrier);
+}
+
 void Renderer::endFrame() {
   assert(this->isFrameStarted && "Cannot call endFrame while frame is not in progress");
   auto cmdBuffer = this->getCurrentCommandBuffer();
-  if (vkEndCommandBuffer(cmdBuffer) != VK_SUCCESS)
+  this->upscale(cmdBuffer);
+  if (this->device.getDispatch().vkEndCommandBuffer(cmdBuffer) != VK_SUCCESS)
     throw std::runtime_error("Failed to record command buffer");
   VkResult result = this->swapchain->submitCommandBuffers(&cmdBuffer, &this->currentImageIndex);
   if (
@@ -96,39 +171,133 @@ void Renderer::endFrame() {
   this->isFrameStarted = false;
   this->currentFrameIndex = (this->currentFrameIndex + 1) % Swapchain::MAX_FRAMES_IN_FLIGHT;
 }
-void Renderer::beginSwapchainRenderPass(VkCommandBuffer commandBuffer) {
+void Renderer::beginSwapchainRenderPass(VkCommandBuffer commandBuffer, bool loadContents, VkSubpassContents contents) {
+  std::array<VkClearValue, 2> clearValues{};
+  clearValues[0].color = { 0.01f, 0.01f, 0.01f, 1.0f };
+  clearValues[1].depthStencil = { 1.0f, 0 };
+  this->beginRenderPass(
+    commandBuffer,
+    loadContents ? this->swapchain->getLoadRenderPass() : this->swapchain->getRenderPass(),
+    this->swapchain->getFrameBuffer(this->currentImageIndex),
+    clearValues,
+    this->getRenderExtent(),
+    contents
+  );
+}
+void Renderer::beginLightingRenderPass(VkCommandBuffer commandBuffer) {
+  std::array<VkClearValue, 2> clearValues{};
+  clearValues[0].color = { 0.01f, 0.01f, 0.01f, 1.0f };
+  this->beginRenderPass(
+    commandBuffer,
+    this->swapchain->getLightingRenderPass(),
+    this->swapchain->getFrameBuffer(this->currentImageIndex),
+    clearValues,
+    this->getRenderExtent()
+  );
+}
+void Renderer::endSwapchainRenderPass(VkCommandBuffer commandBuffer) {
+  assert(this->isFrameStarted && "Cannot end render pass when frame is not in progress.");
+  assert(commandBuffer == this->getCurrentCommandBuffer() && "Can only end render pass for command buffer which is being recorded.");
+  this->device.getDispatch().vkCmdEndRenderPass(commandBuffer);
+}
+void Renderer::beginTransparencyRenderPass(VkCommandBuffer commandBuffer) {
+  // nothing accumulated, fully revealed; the depth attachment is loaded
+  std::array<VkClearValue, 3> clearValues{};
+  clearValues[0].color = { 0.0f, 0.0f, 0.0f, 0.0f };
+  clearValues[1].color = { 1.0f, 0.0f, 0.0f, 0.0f };
+  this->beginRenderPass(
+    commandBuffer,
+    this->swapchain->getTransparencyRenderPass(),
+    this->swapchain->getTransparencyFrameBuffer(this->currentImageIndex),
+    clearValues,
+    this->getRenderExtent()
+  );
+}
+void Renderer::endTransparencyRenderPass(VkCommandBuffer commandBuffer) {
+  this->endSwapchainRenderPass(commandBuffer);
+}
+void Renderer::beginGBufferRenderPass(VkCommandBuffer commandBuffer, bool loadContents, VkSubpassContents contents) {
+  // 0 view depth is the background
+  std::array<VkClearValue, 4> clearValues{};
+  clearValues[0].color = { 0.5f, 0.5f, 0.5f, 0.0f };
+  clearValues[1].color = { 0.0f, 0.0f, 0.0f, 0.0f };
+  clearValues[2].color = { 0.0f, 0.0f, 0.0f, 0.0f };
+  clearValues[3].depthStencil = { 1.0f, 0 };
+  this->beginRenderPass(
+    commandBuffer,
+    loadContents ? this->swapchain->getGBufferLoadRenderPass() : this->swapchain->getGBufferRenderPass(),
+    this->swapchain->getGBufferFrameBuffer(this->currentImageIndex),
+    clearValues,
+    this->getRenderExtent(),
+    contents
+  );
+}
+void Renderer::endGBufferRenderPass(VkCommandBuffer commandBuffer) {
+  this->endSwapchainRenderPass(commandBuffer);
+}
+VkExtent2D Renderer::getLowResolutionExtent(uint32_t divisor) const {
+  const VkExtent2D extent = this->getRenderExtent();
+  return { (extent.width + divisor - 1) / divisor, (extent.height + divisor - 1) / divisor };
+}
+void Renderer::beginLowResolutionRenderPass(VkCommandBuffer commandBuffer, uint32_t divisor) {
+  assert(divisor >= Swapchain::LOW_RESOLUTION_DIVISOR && "Low resolution pass larger than its targets.");
+  // nothing drawn, fully transmitted; the depth is written by the downsample
+  std::array<VkClearValue, 2> clearValues{};
+  clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
+  clearValues[1].depthStencil = { 1.0f, 0 };
+  this->beginRenderPass(
+    commandBuffer,
+    this->swapchain->getLowResolutionRenderPass(),
+    this->swapchain->getLowResolutionFrameBuffer(this->currentImageIndex),
+    clearValues,
+    this->getLowResolutionExtent(divisor)
+  );
+}
+void Renderer::endLowResolutionRenderPass(VkCommandBuffer commandBuffer) {
+  this->endSwapchainRenderPass(commandBuffer);
+}
+void Renderer::beginUpsampleRenderPass(VkCommandBuffer commandBuffer) {
+  this->beginRenderPass(
+    commandBuffer,
+    this->swapchain->getUpsampleRenderPass(),
+    this->swapchain->getFrameBuffer(this->currentImageIndex),
+    {},
+    this->getRenderExtent()
+  );
+}
+void Renderer::beginRenderPass(
+  VkCommandBuffer commandBuffer,
+  VkRenderPass renderPass,
+  VkFramebuffer framebuffer,
+  std::span<const VkClearValue> clearValues,
+  VkExtent2D extent,
+  VkSubpassContents contents
+) {
   assert(this->isFrameStarted && "Cannot begin render pass when frame is not in progress.");
   assert(commandBuffer == this->getCurrentCommandBuffer() && "Can only begin render pass for command buffer which is being recorded.");
   VkRenderPassBeginInfo renderPassInfo{};
   renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-  renderPassInfo.renderPass = this->swapchain->getRenderPass();
-  renderPassInfo.framebuffer = this->swapchain->getFrameBuffer(this->currentImageIndex);
+  renderPassInfo.renderPass = renderPass;
+  renderPassInfo.framebuffer = framebuffer;
   renderPassInfo.renderArea.offset = { 0, 0 };
-  renderPassInfo.renderArea.extent = this->swapchain->getExtent();
-
-  std::array<VkClearValue, 2> clearValues{};
-  clearValues[0].color = { 0.01f, 0.01f, 0.01f, 1.0f };
-  clearValues[1].depthStencil = { 1.0f, 0 };
-
+  renderPassInfo.renderArea.extent = extent;
   renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
   renderPassInfo.pClearValues = clearValues.data();
 
-  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+  this->device.getDispatch().vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+  // only executeCommands is allowed in the pass, secondary buffers set their own viewport
+  if (contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS)
+    return;
 
   VkViewport viewport{};
-  VkRect2D scissor{ {0,0}, this->swapchain->getExtent() };
+  VkRect2D scissor{ {0,0}, extent };
   viewport.x = 0.0f;
   viewport.y = 0.0f;
-  viewport.width = static_cast<float>(this->swapchain->getExtent().width);
-  viewport.height = static_cast<float>(this->swapchain->getExtent().height);
+  viewport.width = static_cast<float>(extent.width);
+  viewport.height = static_cast<float>(extent.height);
   viewport.minDepth = 0.0f;
   viewport.maxDepth = 1.0f;
 
-  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-}
-void Renderer::endSwapchainRenderPass(VkCommandBuffer commandBuffer) {
-  assert(this->isFrameStarted && "Cannot end render pass when frame is not in progress.");
-  assert(commandBuffer == this->getCurrentCommandBuffer() && "Can only end render pass for command buffer which is being recorded.");
-  vkCmdEndRenderPass(commandBuffer);
+  this->device.getDispatch().vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+  this->device.getDispatch().vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 }
\ No newline at end of file
@@ -27,7 +27,18 @@ void Swapchain::init() {
   this->createImageViews();
   this->createRenderPass();
   this->createDepthResources();
+  this->createSceneColorResources();
   this->createFramebuffers();
+  this->createTransparencyResources();
+  this->createTransparencyRenderPass();
+  this->createTransparencyFramebuffers();
+  this->createGBufferResources();
+  this->createGBufferRenderPass();
+  this->createGBufferFramebuffers();
+  this->createLowResolutionResources();
+  this->createLowResolutionRenderPass();
+  this->createLowResolutionFramebuffers();
+  this->createUpsampleRenderPass();
   this->createSyncObjects();
 }
 
@@ -48,11 +59,63 @@ Swapchain::~Swapchain() {
     vkFreeMemory(device.getHandle(), depthImageMemorys[i], nullptr);
   }
 
+  for (uint32_t i = 0; i < sceneColorImages.size(); i++) {
+    vkDestroyImageView(device.getHandle(), sceneColorImageViews[i], nullptr);
+    vkDestroyImage(device.getHandle(), sceneColorImages[i], nullptr);
+    vkFreeMemory(device.getHandle(), sceneColorImageMemorys[i], nullptr);
+  }
+
+  for (uint32_t i = 0; i < accumulationImages.size(); i++) {
+    vkDestroyImageView(device.getHandle(), accumulationImageViews[i], nullptr);
+    vkDestroyImage(device.getHandle(), accumulationImages[i], nullptr);
+    vkFreeMemory(device.getHandle(), accumulationImageMemorys[i], nullptr);
+    vkDestroyImageView(device.getHandle(), revealageImageViews[i], nullptr);
+    vkDestroyImage(device.getHandle(), revealageImages[i], nullptr);
+    vkFreeMemory(device.getHandle(), revealageImageMemorys[i], nullptr);
+  }
+
+  for (uint32_t i = 0; i < normalImages.size(); i++) {
+    vkDestroyImageView(device.getHandle(), normalImageViews[i], nullptr);
+    vkDestroyImage(device.getHandle(), normalImages[i], nullptr);
+    vkFreeMemory(device.getHandle(), normalImageMemorys[i], nullptr);
+    vkDestroyImageView(device.getHandle(), albedoImageViews[i], nullptr);
+    vkDestroyImage(device.getHandle(), albedoImages[i], nullptr);
+    vkFreeMemory(device.getHandle(), albedoImageMemorys[i], nullptr);
+    vkDestroyImageView(device.getHandle(), linearDepthImageViews[i], nullptr);
+    vkDestroyImage(device.getHandle(), linearDepthImages[i], nullptr);
+    vkFreeMemory(device.getHandle(), linearDepthImageMemorys[i], nullptr);
+  }
+
+  for (uint32_t i = 0; i < lowResolutionColorImages.size(); i++) {
+    vkDestroyImageView(device.getHandle(), lowResolutionColorImageViews[i], nullptr);
+    vkDestroyImage(device.getHandle(), lowResolutionColorImages[i], nullptr);
+    vkFreeMemory(device.getHandle(), lowResolutionColorImageMemorys[i], nullptr);
+    vkDestroyImageView(device.getHandle(), lowResolutionDepthImageViews[i], nullptr);
+    vkDestroyImage(device.getHandle(), lowResolutionDepthImages[i], nullptr);
+    vkFreeMemory(device.getHandle(), lowResolutionDepthImageMemorys[i], nullptr);
+  }
+
   for (auto framebuffer : swapChainFramebuffers) {
     vkDestroyFramebuffer(device.getHandle(), framebuffer, nullptr);
   }
+  for (auto framebuffer : transparencyFramebuffers) {
+    vkDestroyFramebuffer(device.getHandle(), framebuffer, nullptr);
+  }
+  for (auto framebuffer : gbufferFramebuffers) {
+    vkDestroyFramebuffer(device.getHandle(), framebuffer, nullptr);
+  }
+  for (auto framebuffer : lowResolutionFramebuffers) {
+    vkDestroyFramebuffer(device.getHandle(), framebuffer, nullptr);
+  }
 
   vkDestroyRenderPass(device.getHandle(), renderPass, nullptr);
+  vkDestroyRenderPass(device.getHandle(), loadRenderPass, nullptr);
+  vkDestroyRenderPass(device.getHandle(), lightingRenderPass, nullptr);
+  vkDestroyRenderPass(device.getHandle(), transparencyRenderPass, nullptr);
+  vkDestroyRenderPass(device.getHandle(), gbufferRenderPass, nullptr);
+  vkDestroyRenderPass(device.getHandle(), gbufferLoadRenderPass, nullptr);
+  vkDestroyRenderPass(device.getHandle(), lowResolutionRenderPass, nullptr);
+  vkDestroyRenderPass(device.getHandle(), upsampleRenderPass, nullptr);
 
   // cleanup synchronization objects
   for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
@@ -63,14 +126,15 @@ Swapchain::~Swapchain() {
 }
 
 VkResult Swapchain::acquireNextImage(uint32_t* imageIndex) {
-  vkWaitForFences(
+  const auto& dispatch = device.getDispatch();
+  dispatch.vkWaitForFences(
     device.getHandle(),
     1,
     &inFlightFences[currentFrame],
     VK_TRUE,
     std::numeric_limits<uint64_t>::max());
 
-  VkResult result = vkAcquireNextImageKHR(
+  VkResult result = dispatch.vkAcquireNextImageKHR(
     device.getHandle(),
     swapChain,
     std::numeric_limits<uint64_t>::max(),
@@ -83,8 +147,9 @@ VkResult Swapchain::acquireNextImage(uint32_t* imageIndex) {
 
 VkResult Swapchain::submitCommandBuffers(
   const VkCommandBuffer* buffers, uint32_t* imageIndex) {
+  const auto& dispatch = device.getDispatch();
   if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE) {
-    vkWaitForFences(device.getHandle(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
+    dispatch.vkWaitForFences(device.getHandle(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
   }
   imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
 
@@ -92,7 +157,10 @@ VkResult Swapchain::submitCommandBuffers(
   submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
   VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame] };
-  VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+  // the swapchain image is only written by the upscale blit, or by the passes without it
+  VkPipelineStageFlags waitStages[] = {
+    upscaleSupported ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+  };
   submitInfo.waitSemaphoreCount = 1;
   submitInfo.pWaitSemaphores = waitSemaphores;
   submitInfo.pWaitDstStageMask = waitStages;
@@ -104,8 +172,8 @@ VkResult Swapchain::submitCommandBuffers(
   submitInfo.signalSemaphoreCount = 1;
   submitInfo.pSignalSemaphores = signalSemaphores;
 
-  vkResetFences(device.getHandle(), 1, &inFlightFences[currentFrame]);
-  if (vkQueueSubmit(device.getGraphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) !=
+  dispatch.vkResetFences(device.getHandle(), 1, &inFlightFences[currentFrame]);
+  if (dispatch.vkQueueSubmit(device.getGraphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) !=
     VK_SUCCESS) {
     throw std::runtime_error("failed to submit draw command buffer!");
   }
@@ -122,7 +190,7 @@ VkResult Swapchain::submitCommandBuffers(
 
   presentInfo.pImageIndices = imageIndex;
 
-  auto result = vkQueuePresentKHR(device.getPresentQueue(), &presentInfo);
+  auto result = dispatch.vkQueuePresentKHR(device.getPresentQueue(), &presentInfo);
 
   currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 
@@ -151,7 +219,16 @@ void Swapchain::createSwapChain() {
   createInfo.imageColorSpace = surfaceFormat.colorSpace;
   createInfo.imageExtent = extent;
   createInfo.imageArrayLayers = 1;
+  // the scene color has the swapchain format, so one format serves both ends of the blit
+  const VkFormatProperties formatProperties = device.getFormatProperties(surfaceFormat.format);
+  const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+  upscaleSupported = (swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT) &&
+    (formatProperties.optimalTilingFeatures & blitFeatures) == blitFeatures;
+  linearUpscaleSupported = upscaleSupported &&
+    (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT);
   createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+  if (upscaleSupported)
+    createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 
   QueueFamilyIndices indices = device.findPhysicalQueueFamilies();
   uint32_t queueFamilyIndices[] = { indices.graphicsFamily, indices.presentFamily };
@@ -213,14 +290,22 @@ void Swapchain::createImageViews() {
 }
 
 void Swapchain::createRenderPass() {
+  renderPass = createRenderPass(false, false);
+  // framebuffers only need a compatible render pass, so every pass shares them
+  loadRenderPass = createRenderPass(true, true);
+  lightingRenderPass = createRenderPass(false, true);
+}
+
+VkRenderPass Swapchain::createRenderPass(bool loadColor, bool loadDepth) {
   VkAttachmentDescription depthAttachment{};
   depthAttachment.format = findDepthFormat();
   depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-  depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-  depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthAttachment.loadOp = loadDepth ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+  // kept for the depth pyramid of occlusion culling
+  depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
   depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-  depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  depthAttachment.initialLayout = loadDepth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
   depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
   VkAttachmentReference depthAttachmentRef{};
@@ -230,12 +315,12 @@ void Swapchain::createRenderPass() {
   VkAttachmentDescription colorAttachment = {};
   colorAttachment.format = getImageFormat();
   colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-  colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  colorAttachment.loadOp = loadColor ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
   colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
   colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-  colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  colorAttachment.initialLayout = loadColor ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+  colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
   VkAttachmentReference colorAttachmentRef = {};
   colorAttachmentRef.attachment = 0;
@@ -249,7 +334,8 @@ void Swapchain::createRenderPass() {
 
   VkSubpassDependency dependency = {};
   dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-  dependency.srcAccessMask = 0;
+  // a loading pass also has to wait for the writes of the previous one
+  dependency.srcAccessMask = loadColor ? VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT : 0;
   dependency.srcStageMask =
     VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
   dependency.dstSubpass = 0;
@@ -257,6 +343,13 @@ void Swapchain::createRenderPass() {
     VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
   dependency.dstAccessMask =
     VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  if (loadColor)
+    dependency.dstAccessMask |= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
+  if (loadDepth) {
+    dependency.srcStageMask |= VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependency.srcAccessMask |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependency.dstAccessMask |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+  }
 
   std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
   VkRenderPassCreateInfo renderPassInfo = {};
@@ -268,15 +361,18 @@ void Swapchain::createRenderPass() {
   renderPassInfo.dependencyCount = 1;
   renderPassInfo.pDependencies = &dependency;
 
-  if (vkCreateRenderPass(device.getHandle(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+  VkRenderPass pass;
+  if (vkCreateRenderPass(device.getHandle(), &renderPassInfo, nullptr, &pass) != VK_SUCCESS) {
     throw std::runtime_error("failed to create render pass!");
   }
+  return pass;
 }
 
 void Swapchain::createFramebuffers() {
   swapChainFramebuffers.resize(getImageCount());
   for (size_t i = 0; i < getImageCount(); i++) {
-    std::array<VkImageView, 2> attachments = { swapChainImageViews[i], depthImageViews[i] };
+    VkImageView colorView = upscaleSupported ? sceneColorImageViews[i] : swapChainImageViews[i];
+    std::array<VkImageView, 2> attachments = { colorView, depthImageViews[i] };
 
     VkExtent2D swapChainExtent = getExtent();
     VkFramebufferCreateInfo framebufferInfo = {};
@@ -301,52 +397,527 @@ void Swapchain::createFramebuffers() {
 void Swapchain::createDepthResources() {
   VkFormat depthFormat = findDepthFormat();
   this->swapChainDepthFormat = depthFormat;
-  VkExtent2D swapChainExtent = getExtent();
 
   depthImages.resize(getImageCount());
   depthImageMemorys.resize(getImageCount());
   depthImageViews.resize(getImageCount());
 
   for (uint32_t i = 0; i < depthImages.size(); i++) {
-    VkImageCreateInfo imageInfo{};
-    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    imageInfo.imageType = VK_IMAGE_TYPE_2D;
-    imageInfo.extent.width = swapChainExtent.width;
-    imageInfo.extent.height = swapChainExtent.height;
-    imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = 1;
-    imageInfo.arrayLayers = 1;
-    imageInfo.format = depthFormat;
-    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    imageInfo.flags = 0;
-
-    device.createImageWithInfo(
-      imageInfo,
-      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-      depthImages[i],
-      depthImageMemorys[i]);
+    createDepthTarget(getExtent(), depthImages[i], depthImageMemorys[i], depthImageViews[i]);
+  }
+}
 
-    VkImageViewCreateInfo viewInfo{};
-    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-    viewInfo.image = depthImages[i];
-    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-    viewInfo.format = depthFormat;
-    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-    viewInfo.subresourceRange.baseMipLevel = 0;
-    viewInfo.subresourceRange.levelCount = 1;
-    viewInfo.subresourceRange.baseArrayLayer = 0;
-    viewInfo.subresourceRange.layerCount = 1;
+void Swapchain::createDepthTarget(VkExtent2D extent, VkImage& image, VkDeviceMemory& memory, VkImageView& view) {
+  VkImageCreateInfo imageInfo{};
+  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageInfo.extent.width = extent.width;
+  imageInfo.extent.height = extent.height;
+  imageInfo.extent.depth = 1;
+  imageInfo.mipLevels = 1;
+  imageInfo.arrayLayers = 1;
+  imageInfo.format = swapChainDepthFormat;
+  imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+  imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  imageInfo.flags = 0;
+
+  device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, memory);
+
+  VkImageViewCreateInfo viewInfo{};
+  viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewInfo.image = image;
+  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.format = swapChainDepthFormat;
+  viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+  viewInfo.subresourceRange.baseMipLevel = 0;
+  viewInfo.subresourceRange.levelCount = 1;
+  viewInfo.subresourceRange.baseArrayLayer = 0;
+  viewInfo.subresourceRange.layerCount = 1;
+
+  if (vkCreateImageView(device.getHandle(), &viewInfo, nullptr, &view) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create texture image view!");
+  }
+}
 
-    if (vkCreateImageView(device.getHandle(), &viewInfo, nullptr, &depthImageViews[i]) != VK_SUCCESS) {
-      throw std::runtime_error("failed to create texture image view!");
+void Swapchain::createSceneColorResources() {
+  if (!upscaleSupported)
+    return;
+  sceneColorImages.resize(getImageCount());
+  sceneColorImageMemorys.resize(getImageCount());
+  sceneColorImageViews.resize(getImageCount());
+
+  for (uint32_t i = 0; i < sceneColorImages.size(); i++) {
+    createColorTarget(
+      getImageFormat(),
+      getExtent(),
+      sceneColorImages[i],
+      sceneColorImageMemorys[i],
+      sceneColorImageViews[i],
+      VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+    );
+  }
+}
+
+void Swapchain::createColorTarget(
+  VkFormat format,
+  VkExtent2D extent,
+  VkImage& image,
+  VkDeviceMemory& memory,
+  VkImageView& view,
+  VkImageUsageFlags extraUsage
+) {
+  VkImageCreateInfo imageInfo{};
+  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageInfo.extent.width = extent.width;
+  imageInfo.extent.height = extent.height;
+  imageInfo.extent.depth = 1;
+  imageInfo.mipLevels = 1;
+  imageInfo.arrayLayers = 1;
+  imageInfo.format = format;
+  imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | extraUsage;
+  imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  imageInfo.flags = 0;
+
+  device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, memory);
+
+  VkImageViewCreateInfo viewInfo{};
+  viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewInfo.image = image;
+  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.format = format;
+  viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  viewInfo.subresourceRange.baseMipLevel = 0;
+  viewInfo.subresourceRange.levelCount = 1;
+  viewInfo.subresourceRange.baseArrayLayer = 0;
+  viewInfo.subresourceRange.layerCount = 1;
+
+  if (vkCreateImageView(device.getHandle(), &viewInfo, nullptr, &view) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create texture image view!");
+  }
+}
+
+void Swapchain::createTransparencyResources() {
+  accumulationImages.resize(getImageCount());
+  accumulationImageMemorys.resize(getImageCount());
+  accumulationImageViews.resize(getImageCount());
+  revealageImages.resize(getImageCount());
+  revealageImageMemorys.resize(getImageCount());
+  revealageImageViews.resize(getImageCount());
+
+  for (uint32_t i = 0; i < accumulationImages.size(); i++) {
+    createColorTarget(ACCUMULATION_FORMAT, getExtent(), accumulationImages[i], accumulationImageMemorys[i], accumulationImageViews[i]);
+    createColorTarget(REVEALAGE_FORMAT, getExtent(), revealageImages[i], revealageImageMemorys[i], revealageImageViews[i]);
+  }
+}
+
+void Swapchain::createTransparencyRenderPass() {
+  // accumulation starts at 0, revealage at 1 (nothing covers the pixel)
+  VkAttachmentDescription accumulationAttachment{};
+  accumulationAttachment.format = ACCUMULATION_FORMAT;
+  accumulationAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  accumulationAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  accumulationAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  accumulationAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  accumulationAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  accumulationAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  accumulationAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+  VkAttachmentDescription revealageAttachment = accumulationAttachment;
+  revealageAttachment.format = REVEALAGE_FORMAT;
+
+  // tested against, never written: transparent surfaces do not occlude each other
+  VkAttachmentDescription depthAttachment{};
+  depthAttachment.format = swapChainDepthFormat;
+  depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+  depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+  std::array<VkAttachmentReference, 2> colorAttachmentRefs = {
+    VkAttachmentReference{ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
+    VkAttachmentReference{ 1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
+  };
+  VkAttachmentReference depthAttachmentRef{ 2, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+
+  VkSubpassDescription subpass = {};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = static_cast<uint32_t>(colorAttachmentRefs.size());
+  subpass.pColorAttachments = colorAttachmentRefs.data();
+  subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+  std::array<VkSubpassDependency, 2> dependencies{};
+  // depth of the opaque passes, and the composite of the previous frame still reading the targets
+  dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[0].dstSubpass = 0;
+  dependencies[0].srcStageMask =
+    VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  dependencies[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  dependencies[0].dstStageMask =
+    VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[0].dstAccessMask =
+    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+    VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  // the composite samples both targets
+  dependencies[1].srcSubpass = 0;
+  dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+  std::array<VkAttachmentDescription, 3> attachments = { accumulationAttachment, revealageAttachment, depthAttachment };
+  VkRenderPassCreateInfo renderPassInfo = {};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+  renderPassInfo.pAttachments = attachments.data();
+  renderPassInfo.subpassCount = 1;
+  renderPassInfo.pSubpasses = &subpass;
+  renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+  renderPassInfo.pDependencies = dependencies.data();
+
+  if (vkCreateRenderPass(device.getHandle(), &renderPassInfo, nullptr, &transparencyRenderPass) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create transparency render pass!");
+  }
+}
+
+void Swapchain::createTransparencyFramebuffers() {
+  transparencyFramebuffers.resize(getImageCount());
+  for (size_t i = 0; i < getImageCount(); i++) {
+    std::array<VkImageView, 3> attachments = { accumulationImageViews[i], revealageImageViews[i], depthImageViews[i] };
+
+    VkFramebufferCreateInfo framebufferInfo = {};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = transparencyRenderPass;
+    framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    framebufferInfo.pAttachments = attachments.data();
+    framebufferInfo.width = swapChainExtent.width;
+    framebufferInfo.height = swapChainExtent.height;
+    framebufferInfo.layers = 1;
+
+    if (vkCreateFramebuffer(
+      device.getHandle(),
+      &framebufferInfo,
+      nullptr,
+      &transparencyFramebuffers[i]) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create framebuffer!");
     }
   }
 }
 
+void Swapchain::createGBufferResources() {
+  normalImages.resize(getImageCount());
+  normalImageMemorys.resize(getImageCount());
+  normalImageViews.resize(getImageCount());
+  albedoImages.resize(getImageCount());
+  albedoImageMemorys.resize(getImageCount());
+  albedoImageViews.resize(getImageCount());
+  linearDepthImages.resize(getImageCount());
+  linearDepthImageMemorys.resize(getImageCount());
+  linearDepthImageViews.resize(getImageCount());
+
+  for (uint32_t i = 0; i < normalImages.size(); i++) {
+    createColorTarget(NORMAL_FORMAT, getExtent(), normalImages[i], normalImageMemorys[i], normalImageViews[i]);
+    createColorTarget(ALBEDO_FORMAT, getExtent(), albedoImages[i], albedoImageMemorys[i], albedoImageViews[i]);
+    createColorTarget(LINEAR_DEPTH_FORMAT, getExtent(), linearDepthImages[i], linearDepthImageMemorys[i], linearDepthImageViews[i]);
+  }
+}
+
+void Swapchain::createGBufferRenderPass() {
+  gbufferRenderPass = createGBufferRenderPass(false);
+  gbufferLoadRenderPass = createGBufferRenderPass(true);
+}
+
+VkRenderPass Swapchain::createGBufferRenderPass(bool loadContents) {
+  // a linear depth of 0 marks the pixels no geometry covered
+  VkAttachmentDescription normalAttachment{};
+  normalAttachment.format = NORMAL_FORMAT;
+  normalAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  normalAttachment.loadOp = loadContents ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+  normalAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  normalAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  normalAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  normalAttachment.initialLayout = loadContents ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+  normalAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+  VkAttachmentDescription albedoAttachment = normalAttachment;
+  albedoAttachment.format = ALBEDO_FORMAT;
+  VkAttachmentDescription linearDepthAttachment = normalAttachment;
+  linearDepthAttachment.format = LINEAR_DEPTH_FORMAT;
+
+  // the depth of the frame, kept for the depth pyramid and the forward passes after lighting
+  VkAttachmentDescription depthAttachment{};
+  depthAttachment.format = swapChainDepthFormat;
+  depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  depthAttachment.loadOp = loadContents ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+  depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthAttachment.initialLayout = loadContents ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+  depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+  std::array<VkAttachmentReference, 3> colorAttachmentRefs = {
+    VkAttachmentReference{ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
+    VkAttachmentReference{ 1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
+    VkAttachmentReference{ 2, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
+  };
+  VkAttachmentReference depthAttachmentRef{ 3, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+
+  VkSubpassDescription subpass = {};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = static_cast<uint32_t>(colorAttachmentRefs.size());
+  subpass.pColorAttachments = colorAttachmentRefs.data();
+  subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+  std::array<VkSubpassDependency, 2> dependencies{};
+  // the lighting pass of the previous frame still reading the targets, or the early half of this one
+  dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[0].dstSubpass = 0;
+  dependencies[0].srcStageMask =
+    VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+    VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[0].srcAccessMask =
+    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  dependencies[0].dstStageMask =
+    VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[0].dstAccessMask =
+    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  // the lighting pass samples the color targets
+  dependencies[1].srcSubpass = 0;
+  dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+  std::array<VkAttachmentDescription, 4> attachments = { normalAttachment, albedoAttachment, linearDepthAttachment, depthAttachment };
+  VkRenderPassCreateInfo renderPassInfo = {};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+  renderPassInfo.pAttachments = attachments.data();
+  renderPassInfo.subpassCount = 1;
+  renderPassInfo.pSubpasses = &subpass;
+  renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+  renderPassInfo.pDependencies = dependencies.data();
+
+  VkRenderPass pass;
+  if (vkCreateRenderPass(device.getHandle(), &renderPassInfo, nullptr, &pass) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create g-buffer render pass!");
+  }
+  return pass;
+}
+
+void Swapchain::createGBufferFramebuffers() {
+  gbufferFramebuffers.resize(getImageCount());
+  for (size_t i = 0; i < getImageCount(); i++) {
+    std::array<VkImageView, 4> attachments = {
+      normalImageViews[i], albedoImageViews[i], linearDepthImageViews[i], depthImageViews[i]
+    };
+
+    VkFramebufferCreateInfo framebufferInfo = {};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = gbufferRenderPass;
+    framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    framebufferInfo.pAttachments = attachments.data();
+    framebufferInfo.width = swapChainExtent.width;
+    framebufferInfo.height = swapChainExtent.height;
+    framebufferInfo.layers = 1;
+
+    if (vkCreateFramebuffer(
+      device.getHandle(),
+      &framebufferInfo,
+      nullptr,
+      &gbufferFramebuffers[i]) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create framebuffer!");
+    }
+  }
+}
+
+VkExtent2D Swapchain::getLowResolutionExtent() const {
+  return {
+    (swapChainExtent.width + LOW_RESOLUTION_DIVISOR - 1) / LOW_RESOLUTION_DIVISOR,
+    (swapChainExtent.height + LOW_RESOLUTION_DIVISOR - 1) / LOW_RESOLUTION_DIVISOR
+  };
+}
+
+void Swapchain::createLowResolutionResources() {
+  lowResolutionColorImages.resize(getImageCount());
+  lowResolutionColorImageMemorys.resize(getImageCount());
+  lowResolutionColorImageViews.resize(getImageCount());
+  lowResolutionDepthImages.resize(getImageCount());
+  lowResolutionDepthImageMemorys.resize(getImageCount());
+  lowResolutionDepthImageViews.resize(getImageCount());
+
+  for (uint32_t i = 0; i < lowResolutionColorImages.size(); i++) {
+    createColorTarget(
+      LOW_RESOLUTION_COLOR_FORMAT,
+      getLowResolutionExtent(),
+      lowResolutionColorImages[i],
+      lowResolutionColorImageMemorys[i],
+      lowResolutionColorImageViews[i]
+    );
+    createDepthTarget(
+      getLowResolutionExtent(),
+      lowResolutionDepthImages[i],
+      lowResolutionDepthImageMemorys[i],
+      lowResolutionDepthImageViews[i]
+    );
+  }
+}
+
+void Swapchain::createLowResolutionRenderPass() {
+  // color over transmittance, cleared to nothing drawn and everything behind visible
+  VkAttachmentDescription colorAttachment{};
+  colorAttachment.format = LOW_RESOLUTION_COLOR_FORMAT;
+  colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  colorAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+  // written by the depth downsample at the start of the pass, sampled by the upsample after it
+  VkAttachmentDescription depthAttachment = colorAttachment;
+  depthAttachment.format = swapChainDepthFormat;
+
+  VkAttachmentReference colorAttachmentRef{ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+  VkAttachmentReference depthAttachmentRef{ 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+
+  VkSubpassDescription subpass = {};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = 1;
+  subpass.pColorAttachments = &colorAttachmentRef;
+  subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+  std::array<VkSubpassDependency, 2> dependencies{};
+  // the upsample of the previous frame still reading both targets
+  dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[0].dstSubpass = 0;
+  dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  dependencies[0].srcAccessMask = 0;
+  dependencies[0].dstStageMask =
+    VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[0].dstAccessMask =
+    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+    VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  // the upsample samples both targets
+  dependencies[1].srcSubpass = 0;
+  dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[1].srcStageMask =
+    VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[1].srcAccessMask =
+    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+  std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
+  VkRenderPassCreateInfo renderPassInfo = {};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+  renderPassInfo.pAttachments = attachments.data();
+  renderPassInfo.subpassCount = 1;
+  renderPassInfo.pSubpasses = &subpass;
+  renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+  renderPassInfo.pDependencies = dependencies.data();
+
+  if (vkCreateRenderPass(device.getHandle(), &renderPassInfo, nullptr, &lowResolutionRenderPass) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create low resolution render pass!");
+  }
+}
+
+void Swapchain::createLowResolutionFramebuffers() {
+  VkExtent2D extent = getLowResolutionExtent();
+  lowResolutionFramebuffers.resize(getImageCount());
+  for (size_t i = 0; i < getImageCount(); i++) {
+    std::array<VkImageView, 2> attachments = { lowResolutionColorImageViews[i], lowResolutionDepthImageViews[i] };
+
+    VkFramebufferCreateInfo framebufferInfo = {};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = lowResolutionRenderPass;
+    framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    framebufferInfo.pAttachments = attachments.data();
+    framebufferInfo.width = extent.width;
+    framebufferInfo.height = extent.height;
+    framebufferInfo.layers = 1;
+
+    if (vkCreateFramebuffer(
+      device.getHandle(),
+      &framebufferInfo,
+      nullptr,
+      &lowResolutionFramebuffers[i]) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create framebuffer!");
+    }
+  }
+}
+
+void Swapchain::createUpsampleRenderPass() {
+  // compatible with the main pass, so it shares its framebuffers
+  VkAttachmentDescription colorAttachment = {};
+  colorAttachment.format = getImageFormat();
+  colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+  colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  colorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+  // read only, so the upsample can sample it while it is attached;
+  // handed back in the layout every other pass expects
+  VkAttachmentDescription depthAttachment{};
+  depthAttachment.format = swapChainDepthFormat;
+  depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+  depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+  depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+  VkAttachmentReference colorAttachmentRef{ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+  VkAttachmentReference depthAttachmentRef{ 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+
+  VkSubpassDescription subpass = {};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = 1;
+  subpass.pColorAttachments = &colorAttachmentRef;
+  subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+  // the main pass wrote the color, the low resolution pass made its targets visible already
+  VkSubpassDependency dependency = {};
+  dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependency.dstSubpass = 0;
+  dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+  std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
+  VkRenderPassCreateInfo renderPassInfo = {};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+  renderPassInfo.pAttachments = attachments.data();
+  renderPassInfo.subpassCount = 1;
+  renderPassInfo.pSubpasses = &subpass;
+  renderPassInfo.dependencyCount = 1;
+  renderPassInfo.pDependencies = &dependency;
+
+  if (vkCreateRenderPass(device.getHandle(), &renderPassInfo, nullptr, &upsampleRenderPass) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create upsample render pass!");
+  }
+}
+
 void Swapchain::createSyncObjects() {
   imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
   renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
@@ -425,5 +996,5 @@ VkFormat Swapchain::findDepthFormat() {
   return device.findSupportedFormat(
     { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
     VK_IMAGE_TILING_OPTIMAL,
-    VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+    VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
 }
\ No newline at end of file
@@ -9,29 +9,31 @@ Base::Base(
   const SystemInfo& deps,
   const std::string_view vertFilePath,
   const std::string_view fragFilePath
-) : device(deps.device), vertFilePath(vertFilePath), fragFilePath(fragFilePath) {}
+) : device(deps.device),
+  renderQueue(deps.renderQueue),
+  queueId(deps.renderQueue.registerOwner(*this)),
+  vertFilePath(vertFilePath),
+  fragFilePath(fragFilePath),
+  vertexLayout(deps.vertexLayout) {}
+
+Base::~Base() {
+  this->renderQueue.unregisterOwner(this->queueId);
+}
 
 void Base::init(const SystemInfo& deps, std::function<void(Pipeline::ConfigInfo&)> pipelineCb) {
-  this->createPipelineLayout(deps.globalDescriptorSetLayout);
+  this->createPipelineLayout(deps);
   this->createPipeline(deps.renderPass, pipelineCb);
 }
 
-Base::~Base() {
-  vkDestroyPipelineLayout(this->device.getHandle(), this->pipelineLayout, nullptr);
+VkPipelineLayout Base::GetSharedPipelineLayout(const SystemInfo& deps) {
+  return deps.layoutCache.getPipelineLayout(
+    { deps.globalDescriptorSetLayout, deps.bindlessTable.getSetLayout() },
+    { Base::SharedPushConstantRange }
+  );
 }
 
-void Base::createPipelineLayout(VkDescriptorSetLayout globalDescriptorSetLayout) {
-  std::vector<VkDescriptorSetLayout> layouts = { globalDescriptorSetLayout };
-
-  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-  pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(layouts.size());
-  pipelineLayoutInfo.pSetLayouts = layouts.data();
-  pipelineLayoutInfo.pushConstantRangeCount = 0;
-  pipelineLayoutInfo.pPushConstantRanges = nullptr;
-
-  if (vkCreatePipelineLayout(this->device.getHandle(), &pipelineLayoutInfo, nullptr, &this->pipelineLayout) != VK_SUCCESS)
-    throw std::runtime_error("Failed to create pipeline layout");
+void Base::createPipelineLayout(const SystemInfo& deps) {
+  this->pipelineLayout = Base::GetSharedPipelineLayout(deps);
 }
 
 void Base::createPipeline(
@@ -42,6 +44,7 @@ void Base::createPipeline(
   Pipeline::ConfigInfo pipelineConfig{};
 
   Pipeline::SetupDefaultConfigInfo(pipelineConfig);
+  Pipeline::SetVertexLayout(pipelineConfig, this->vertexLayout);
   pipelineConfig.renderPass = renderPass;
   pipelineConfig.pipelineLayout = this->pipelineLayout;
   if (cb)
@@ -54,3 +57,78 @@ void Base::createPipeline(
     pipelineConfig
   );
 }
+
+void Base::createGBufferPipeline(VkRenderPass gbufferRenderPass, const std::string_view fragFilePath) {
+  assert(this->pipelineLayout != VK_NULL_HANDLE && "pipeline layout is null");
+  Pipeline::ConfigInfo pipelineConfig{};
+
+  Pipeline::SetupDefaultConfigInfo(pipelineConfig);
+  Pipeline::SetVertexLayout(pipelineConfig, this->vertexLayout);
+  Pipeline::EnableGBufferOutputs(pipelineConfig);
+  pipelineConfig.renderPass = gbufferRenderPass;
+  pipelineConfig.pipelineLayout = this->pipelineLayout;
+
+  this->gbufferPipeline = std::make_unique<Pipeline>(
+    this->device,
+    this->vertFilePath,
+    fragFilePath,
+    pipelineConfig
+  );
+}
+
+void Base::createDepthPrepassPipelines(VkRenderPass renderPass, const std::string_view depthVertFilePath) {
+  assert(this->pipelineLayout != VK_NULL_HANDLE && "pipeline layout is null");
+  Pipeline::ConfigInfo depthConfig{};
+  Pipeline::SetupDefaultConfigInfo(depthConfig);
+  Pipeline::SetVertexLayout(depthConfig, this->vertexLayout);
+  Pipeline::EnableDepthOnly(depthConfig);
+  depthConfig.renderPass = renderPass;
+  depthConfig.pipelineLayout = this->pipelineLayout;
+  this->depthPipeline = std::make_unique<Pipeline>(this->device, depthVertFilePath, "", depthConfig);
+
+  // only the fragment that won the pre-pass passes, so each pixel is shaded once
+  Pipeline::ConfigInfo equalConfig{};
+  Pipeline::SetupDefaultConfigInfo(equalConfig);
+  Pipeline::SetVertexLayout(equalConfig, this->vertexLayout);
+  equalConfig.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_EQUAL;
+  equalConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+  equalConfig.renderPass = renderPass;
+  equalConfig.pipelineLayout = this->pipelineLayout;
+  this->equalPipeline = std::make_unique<Pipeline>(
+    this->device,
+    this->vertFilePath,
+    this->fragFilePath,
+    equalConfig
+  );
+}
+
+std::unique_ptr<Scop::Renderer::Pipeline> Base::createPipelineVariant(
+  VkRenderPass renderPass,
+  const std::string_view vertFilePath,
+  const std::string_view fragFilePath,
+  std::function<void(Pipeline::ConfigInfo&)> cb
+) const {
+  assert(this->pipelineLayout != VK_NULL_HANDLE && "pipeline layout is null");
+  Pipeline::ConfigInfo pipelineConfig{};
+
+  Pipeline::SetupDefaultConfigInfo(pipelineConfig);
+  Pipeline::SetVertexLayout(pipelineConfig, this->vertexLayout);
+  pipelineConfig.renderPass = renderPass;
+  pipelineConfig.pipelineLayout = this->pipelineLayout;
+  if (cb)
+    cb(pipelineConfig);
+
+  return std::make_unique<Pipeline>(this->device, vertFilePath, fragFilePath, pipelineConfig);
+}
+
+void Base::bindGlobalDescriptorSet(const FrameInfo& frameInfo) {
+  // the shared sets are bound once per render pass with the shared layout,
+  // so only systems with their own layout need to bind the global one again
+  if (this->pipelineLayout == frameInfo.globalPipelineLayout)
+    return;
+  frameInfo.recorder.bindDescriptorSets(
+    VK_PIPELINE_BIND_POINT_GRAPHICS,
+    this->pipelineLayout,
+    0, 1, &frameInfo.globalDescriptorSet
+  );
+}
@@ -1,96 +1,461 @@
 #include "engine/renderer/systems/Billboards.h"
 #include <engine/scene/components/Billboard.h>
-#include <engine/scene/Entity.h>
+#include <engine/scene/components/Mesh.h>
+#include <engine/scene/components/Static.h>
+#include <utils/RadixSort.h>
 
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <limits>
+#include <stdexcept>
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
-#include <iostream>
-#include <map>
-
 using Scop::Renderer::Systems::Billboards;
 
 struct BillboardsPushConstantData {
+  uint32_t instanceBuffer;
+};
+static_assert(sizeof(BillboardsPushConstantData) <= Billboards::SharedPushConstantRange.size);
+
+struct ImpostorPushConstantData {
+  uint32_t instanceBuffer;
+  // bindless sampled image indices of the atlas of the draw
+  uint32_t colorAtlas;
+  uint32_t normalAtlas;
+};
+static_assert(sizeof(ImpostorPushConstantData) <= Billboards::SharedPushConstantRange.size);
+
+struct BillboardsResolutionPushConstantData {
+  uint32_t divisor;
+};
+static_assert(sizeof(BillboardsResolutionPushConstantData) <= Billboards::SharedPushConstantRange.size);
+
+// std430 layout, matches Instance in billboard.vert
+struct BillboardInstanceData {
   glm::vec4 position;
   glm::vec4 color;
-  float width;
-  float height;
-  bool rounded;
-  uint8_t _pad0[4];
+  glm::vec2 size;
+  uint32_t rounded;
+  uint32_t _pad0;
 };
 
-Billboards::Billboards(const SystemInfo& deps) : Base(
+// std430 layout, matches Instance in impostor.vert
+struct ImpostorInstanceData {
+  glm::mat4 modelMatrix;
+  glm::mat4 normalMatrix;
+  glm::vec4 color;
+  glm::vec4 boundingSphere;
+};
+
+Billboards::Billboards(const SystemInfo& deps, const Impostors& impostors) : Base(
   deps,
   SHADERS_PATH"billboard.vert.spv",
   SHADERS_PATH"billboard.frag.spv"
-) {
+), bindlessTable(deps.bindlessTable), impostors(impostors) {
   this->init(deps, [](Pipeline::ConfigInfo& config) {
     config.attributeDescriptions.clear();
     config.bindingDescriptions.clear();
     Pipeline::EnableAlphaBlending(config);
     });
+  for (auto& instances : this->instances)
+    this->reserveInstances(instances, sizeof(BillboardInstanceData), INITIAL_INSTANCE_CAPACITY);
+  for (auto& instances : this->impostorInstances)
+    this->reserveInstances(instances, sizeof(ImpostorInstanceData), INITIAL_INSTANCE_CAPACITY);
+  // opaque and alpha tested, in the main render pass
+  this->impostorPipeline = this->createPipelineVariant(
+    deps.renderPass,
+    SHADERS_PATH"impostor.vert.spv",
+    SHADERS_PATH"impostor.frag.spv",
+    [](Pipeline::ConfigInfo& config) {
+      config.attributeDescriptions.clear();
+      config.bindingDescriptions.clear();
+    }
+  );
+
+  Pipeline::ConfigInfo weightedConfig{};
+  Pipeline::SetupDefaultConfigInfo(weightedConfig);
+  weightedConfig.attributeDescriptions.clear();
+  weightedConfig.bindingDescriptions.clear();
+  Pipeline::EnableWeightedBlending(weightedConfig);
+  weightedConfig.renderPass = deps.transparencyRenderPass;
+  weightedConfig.pipelineLayout = this->pipelineLayout;
+  this->weightedPipeline = std::make_unique<Pipeline>(
+    this->device,
+    SHADERS_PATH"billboard.vert.spv",
+    SHADERS_PATH"billboard_oit.frag.spv",
+    weightedConfig
+  );
+
+  this->compositeSetLayout = DescriptorSetLayout::Builder(this->device)
+    .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+    .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+    .build(deps.layoutCache);
+  this->lowResolutionSetLayout = DescriptorSetLayout::Builder(this->device)
+    .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+    .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+    .addBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+    .build(deps.layoutCache);
+  this->compositePool = DescriptorPool::Builder(this->device)
+    .setMaxSets(Swapchain::MAX_FRAMES_IN_FLIGHT * 2)
+    .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, Swapchain::MAX_FRAMES_IN_FLIGHT * 5)
+    .build();
+  for (auto& set : this->compositeSets) {
+    if (!this->compositePool->allocSet(this->compositeSetLayout->getHandle(), set))
+      throw std::runtime_error("Failed to allocate billboard composite descriptor set");
+  }
+  for (auto& set : this->lowResolutionSets) {
+    if (!this->compositePool->allocSet(this->lowResolutionSetLayout->getHandle(), set))
+      throw std::runtime_error("Failed to allocate billboard low resolution descriptor set");
+  }
+  this->compositePipelineLayout = deps.layoutCache.getPipelineLayout(
+    { deps.globalDescriptorSetLayout, deps.bindlessTable.getSetLayout(), this->compositeSetLayout->getHandle() },
+    { Base::SharedPushConstantRange }
+  );
+  Pipeline::ConfigInfo compositeConfig{};
+  Pipeline::SetupDefaultConfigInfo(compositeConfig);
+  compositeConfig.attributeDescriptions.clear();
+  compositeConfig.bindingDescriptions.clear();
+  Pipeline::EnableAlphaBlending(compositeConfig);
+  compositeConfig.depthStencilInfo.depthTestEnable = VK_FALSE;
+  compositeConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+  compositeConfig.renderPass = deps.renderPass;
+  compositeConfig.pipelineLayout = this->compositePipelineLayout;
+  this->compositePipeline = std::make_unique<Pipeline>(
+    this->device,
+    SHADERS_PATH"fullscreen.vert.spv",
+    SHADERS_PATH"oit_composite.frag.spv",
+    compositeConfig
+  );
+
+  // color over transmittance: the color is blended as usual, the alpha keeps the product of (1 - alpha).
+  // Tested against the downsampled depth without writing it, the upsample compares against it
+  this->lowResolutionPipeline = this->createPipelineVariant(
+    deps.lowResolutionRenderPass,
+    SHADERS_PATH"billboard.vert.spv",
+    SHADERS_PATH"billboard.frag.spv",
+    [](Pipeline::ConfigInfo& config) {
+      config.attributeDescriptions.clear();
+      config.bindingDescriptions.clear();
+      Pipeline::EnableAlphaBlending(config);
+      config.colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+      config.colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+      config.depthStencilInfo.depthWriteEnable = VK_FALSE;
+    }
+  );
+
+  this->lowResolutionPipelineLayout = deps.layoutCache.getPipelineLayout(
+    { deps.globalDescriptorSetLayout, deps.bindlessTable.getSetLayout(), this->lowResolutionSetLayout->getHandle() },
+    { Base::SharedPushConstantRange }
+  );
+  // depth only, every fragment writes the depth of its footprint
+  Pipeline::ConfigInfo downsampleConfig{};
+  Pipeline::SetupDefaultConfigInfo(downsampleConfig);
+  downsampleConfig.attributeDescriptions.clear();
+  downsampleConfig.bindingDescriptions.clear();
+  downsampleConfig.colorBlendAttachment.colorWriteMask = 0;
+  downsampleConfig.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_ALWAYS;
+  downsampleConfig.renderPass = deps.lowResolutionRenderPass;
+  downsampleConfig.pipelineLayout = this->lowResolutionPipelineLayout;
+  this->depthDownsamplePipeline = std::make_unique<Pipeline>(
+    this->device,
+    SHADERS_PATH"fullscreen.vert.spv",
+    SHADERS_PATH"billboard_depth_downsample.frag.spv",
+    downsampleConfig
+  );
+  // frame * transmittance + color
+  Pipeline::ConfigInfo upsampleConfig{};
+  Pipeline::SetupDefaultConfigInfo(upsampleConfig);
+  upsampleConfig.attributeDescriptions.clear();
+  upsampleConfig.bindingDescriptions.clear();
+  Pipeline::EnableAlphaBlending(upsampleConfig);
+  upsampleConfig.colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+  upsampleConfig.colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+  upsampleConfig.colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+  upsampleConfig.colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+  upsampleConfig.depthStencilInfo.depthTestEnable = VK_FALSE;
+  upsampleConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+  upsampleConfig.renderPass = deps.upsampleRenderPass;
+  upsampleConfig.pipelineLayout = this->lowResolutionPipelineLayout;
+  this->upsamplePipeline = std::make_unique<Pipeline>(
+    this->device,
+    SHADERS_PATH"fullscreen.vert.spv",
+    SHADERS_PATH"billboard_upsample.frag.spv",
+    upsampleConfig
+  );
+
+  // the targets match the framebuffer, texels are fetched one to one
+  VkSamplerCreateInfo samplerInfo{};
+  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter = VK_FILTER_NEAREST;
+  samplerInfo.minFilter = VK_FILTER_NEAREST;
+  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  if (vkCreateSampler(this->device.getHandle(), &samplerInfo, nullptr, &this->sampler) != VK_SUCCESS)
+    throw std::runtime_error("Failed to create billboard composite sampler");
 }
 
-void Billboards::createPipelineLayout(VkDescriptorSetLayout globalDescriptorSetLayout) {
-  VkPushConstantRange pushConstantRange{};
-  pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-  pushConstantRange.offset = 0;
-  pushConstantRange.size = sizeof(BillboardsPushConstantData);
+Billboards::~Billboards() {
+  for (auto& instances : this->instances)
+    this->bindlessTable.releaseBuffer(instances.tableIndex);
+  for (auto& instances : this->impostorInstances)
+    this->bindlessTable.releaseBuffer(instances.tableIndex);
+  vkDestroySampler(this->device.getHandle(), this->sampler, nullptr);
+}
 
-  std::vector<VkDescriptorSetLayout> layouts = { globalDescriptorSetLayout };
+void Billboards::reserveInstances(FrameInstances& instances, VkDeviceSize instanceSize, uint32_t count) {
+  if (instances.buffer && instances.buffer->getInstanceCount() >= count)
+    return;
+  uint32_t capacity = instances.buffer ? instances.buffer->getInstanceCount() : INITIAL_INSTANCE_CAPACITY;
+  while (capacity < count)
+    capacity *= 2;
 
-  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-  pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(layouts.size());
-  pipelineLayoutInfo.pSetLayouts = layouts.data();
-  pipelineLayoutInfo.pushConstantRangeCount = 1;
-  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+  // the previous buffer of this frame slot is no longer in flight
+  instances.buffer = std::make_unique<MemBuffer>(
+    this->device,
+    instanceSize,
+    capacity,
+    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+  );
+  instances.buffer->map();
+  if (instances.tableIndex == BindlessTable::INVALID_INDEX)
+    instances.tableIndex = this->bindlessTable.registerBuffer(*instances.buffer);
+  else
+    this->bindlessTable.updateBuffer(instances.tableIndex, *instances.buffer);
+}
 
-  if (vkCreatePipelineLayout(this->device.getHandle(), &pipelineLayoutInfo, nullptr, &this->pipelineLayout) != VK_SUCCESS)
-    throw std::runtime_error("Failed to create pipeline layout");
+void Billboards::setResolutionDivisor(uint32_t divisor) {
+  this->resolutionDivisor = std::bit_floor(std::clamp(divisor, 1u, MAX_RESOLUTION_DIVISOR));
 }
 
-void Billboards::render(const FrameInfo& frameInfo, Scene& scene) {
-  std::map<float, Entity> sorted;
-  auto group = scene.viewEntitiesWith<Components::Billboard, Components::Transform>();
-  for (auto entity : group) {
-    auto [billboard, transform] = group.get<Components::Billboard, Components::Transform>(entity);
+void Billboards::enqueue(const FrameInfo& frameInfo, Scene& scene, RenderQueue& queue) {
+  // the meshes Systems::Simple leaves out this frame, static ones stay in their batch
+  auto meshes = scene.viewEntitiesWith<Components::Mesh, Components::Transform>(entt::exclude<Components::Static>);
+  this->impostorItems.clear();
+  for (auto entity : meshes) {
+    auto [mesh, transform] = meshes.get<Components::Mesh, Components::Transform>(entity);
+    if (mesh.model && this->impostors.isDistant(*mesh.model, transform))
+      this->impostorItems.push_back({ this->impostors.find(*mesh.model), entity });
+  }
+  // the atlas indices are push constants, so instances sharing an atlas are drawn together
+  std::sort(this->impostorItems.begin(), this->impostorItems.end(),
+    [](const ImpostorItem& a, const ImpostorItem& b) { return std::less<>{}(a.atlas, b.atlas); });
+  // an infinite depth sorts first in the transparent pass, ahead of any blending
+  if (!this->impostorItems.empty()) {
+    uint64_t key = RenderQueue::MakeKey(RenderQueue::Pass::Transparent, this->queueId, 0, std::numeric_limits<float>::infinity());
+    queue.push(this->queueId, key, IMPOSTOR_PAYLOAD);
+  }
 
-    auto distance = frameInfo.sceneCamera.getPosition() - transform.translation;
-    float distanceSqrd = glm::dot(distance, distance);
-    sorted[distanceSqrd] = Entity{ entity, scene };
+  auto group = scene.viewEntitiesWith<Components::Billboard, Components::Transform>();
+  this->items.clear();
+  if (this->orderIndependent) {
+    for (auto entity : group)
+      this->items.push_back({ 0, entity });
+    if (!this->items.empty())
+      queue.push(this->queueId, RenderQueue::MakeKey(RenderQueue::Pass::OrderIndependent, this->queueId, 0, 0.0f), 0);
+    return;
   }
-  this->pipeline->bind(frameInfo.commandBuffer);
 
-  vkCmdBindDescriptorSets(
-    frameInfo.commandBuffer,
-    VK_PIPELINE_BIND_POINT_GRAPHICS,
-    this->pipelineLayout,
-    0, 1, &frameInfo.globalDescriptorSet,
-    0, nullptr
-  );
+  const glm::vec3 cameraPosition = frameInfo.sceneCamera.getPosition();
+  float farthest = 0.0f;
+  for (auto entity : group) {
+    auto& transform = group.get<Components::Transform>(entity);
+    auto distance = cameraPosition - transform.translation;
+    float depth = glm::dot(distance, distance);
+    farthest = std::max(farthest, depth);
+    // positive floats order like their bits, inverted for back to front
+    this->items.push_back({ ~std::bit_cast<uint32_t>(depth), entity });
+  }
+  if (this->items.empty())
+    return;
+  // stable, billboards at the same distance keep their order instead of being dropped
+  Utils::RadixSort(this->items, this->scratch, [](const SortItem& item) { return item.key; });
+  // one packet for all of them, ordered against other transparent work by the farthest one
+  auto pass = this->isLowResolution() ? RenderQueue::Pass::LowResolution : RenderQueue::Pass::Transparent;
+  uint64_t key = RenderQueue::MakeKey(pass, this->queueId, 0, farthest);
+  queue.push(this->queueId, key, 0);
+}
 
-  (void)scene;
+void Billboards::preparePackets(const FrameInfo& frameInfo, Scene& scene, std::span<const RenderQueue::Packet> packets) {
+  // the impostor packet and the billboard one may come as a single run
+  for (const auto& packet : packets) {
+    if (packet.payload == IMPOSTOR_PAYLOAD)
+      this->prepareImpostors(frameInfo, scene);
+    else
+      this->prepareBillboards(frameInfo, scene);
+  }
+}
 
-  for (auto it = sorted.rbegin(); it != sorted.rend(); it++) {
-    auto entity = it->second;
-    auto [billboard, transform] = group.get<Components::Billboard, Components::Transform>(entity.getHandle());
+void Billboards::drawPackets(const FrameInfo& frameInfo, Scene&, std::span<const RenderQueue::Packet> packets) {
+  for (const auto& packet : packets) {
+    if (packet.payload == IMPOSTOR_PAYLOAD)
+      this->drawImpostors(frameInfo);
+    else
+      this->drawBillboards(frameInfo);
+  }
+}
 
-    BillboardsPushConstantData data;
-    data.position = glm::vec4(transform.translation, 1.0f);
-    data.color = billboard.color;
-    data.width = billboard.size.x;
-    data.height = billboard.size.y;
-    data.rounded = billboard.rounded;
+void Billboards::prepareImpostors(const FrameInfo& frameInfo, Scene& scene) {
+  auto group = scene.viewEntitiesWith<Components::Mesh, Components::Transform>();
+  auto& instances = this->impostorInstances[frameInfo.frameIndex];
+  this->reserveInstances(instances, sizeof(ImpostorInstanceData), this->getImpostorCount());
+  auto instanceData = static_cast<ImpostorInstanceData*>(instances.buffer->getMappedMemory());
+  this->impostorRuns.clear();
+  for (uint32_t i = 0; i < this->getImpostorCount(); i++) {
+    const auto& item = this->impostorItems[i];
+    if (this->impostorRuns.empty() || this->impostorRuns.back().atlas != item.atlas)
+      this->impostorRuns.push_back({ i, 0, item.atlas });
+    this->impostorRuns.back().instanceCount++;
+    auto [mesh, transform] = group.get<Components::Mesh, Components::Transform>(item.entity);
+    *instanceData++ = {
+      static_cast<glm::mat4>(transform),
+      glm::mat4(transform.computeNormalMatrix()),
+      glm::vec4(mesh.color, 1.0f),
+      mesh.model->getBoundingSphere()
+    };
+  }
+}
 
-    vkCmdPushConstants(
-      frameInfo.commandBuffer,
+void Billboards::drawImpostors(const FrameInfo& frameInfo) {
+  this->impostorPipeline->bind(frameInfo.recorder);
+  this->bindGlobalDescriptorSet(frameInfo);
+  for (const auto& run : this->impostorRuns) {
+    ImpostorPushConstantData data{
+      this->impostorInstances[frameInfo.frameIndex].tableIndex,
+      run.atlas->colorIndex,
+      run.atlas->normalIndex
+    };
+    frameInfo.recorder.pushConstants(
       this->pipelineLayout,
       VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
       0,
-      sizeof(BillboardsPushConstantData),
+      sizeof(ImpostorPushConstantData),
       &data
     );
-    vkCmdDraw(frameInfo.commandBuffer, 6, 1, 0, 0);
+    frameInfo.recorder.draw(6, run.instanceCount, 0, run.firstInstance);
+  }
+}
+
+void Billboards::prepareBillboards(const FrameInfo& frameInfo, Scene& scene) {
+  auto group = scene.viewEntitiesWith<Components::Billboard, Components::Transform>();
+  auto& instances = this->instances[frameInfo.frameIndex];
+  this->reserveInstances(instances, sizeof(BillboardInstanceData), this->getCount());
+  auto instanceData = static_cast<BillboardInstanceData*>(instances.buffer->getMappedMemory());
+  for (const auto& item : this->items) {
+    auto [billboard, transform] = group.get<Components::Billboard, Components::Transform>(item.entity);
+    *instanceData++ = {
+      glm::vec4(transform.translation, 1.0f),
+      billboard.color,
+      billboard.size,
+      billboard.rounded ? 1u : 0u,
+      0
+    };
   }
-}
\ No newline at end of file
+}
+
+void Billboards::drawBillboards(const FrameInfo& frameInfo) {
+  // packets of the order independent and low resolution passes are only replayed in their render pass
+  if (this->orderIndependent)
+    this->weightedPipeline->bind(frameInfo.recorder);
+  else if (this->isLowResolution())
+    this->lowResolutionPipeline->bind(frameInfo.recorder);
+  else
+    this->pipeline->bind(frameInfo.recorder);
+  this->bindGlobalDescriptorSet(frameInfo);
+  BillboardsPushConstantData data{ this->instances[frameInfo.frameIndex].tableIndex };
+  frameInfo.recorder.pushConstants(
+    this->pipelineLayout,
+    VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+    0,
+    sizeof(BillboardsPushConstantData),
+    &data
+  );
+  frameInfo.recorder.draw(6, this->getCount(), 0, 0);
+}
+
+void Billboards::composite(const FrameInfo& frameInfo, VkImageView accumulationView, VkImageView revealageView) {
+  VkDescriptorSet& set = this->compositeSets[frameInfo.frameIndex];
+  VkDescriptorImageInfo accumulationInfo{ this->sampler, accumulationView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+  VkDescriptorImageInfo revealageInfo{ this->sampler, revealageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+  DescriptorWriter(*this->compositeSetLayout, *this->compositePool)
+    .write(0, &accumulationInfo)
+    .write(1, &revealageInfo)
+    .overwrite(set);
+
+  this->compositePipeline->bind(frameInfo.recorder);
+  frameInfo.recorder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, this->compositePipelineLayout, 2, 1, &set);
+  frameInfo.recorder.draw(3, 1, 0, 0);
+}
+
+void Billboards::prepareLowResolution(
+  const FrameInfo& frameInfo,
+  VkImage depthImage,
+  VkFormat depthFormat,
+  VkImageView depthView,
+  VkImageView lowResolutionColorView,
+  VkImageView lowResolutionDepthView
+) {
+  VkDescriptorSet& set = this->lowResolutionSets[frameInfo.frameIndex];
+  VkDescriptorImageInfo depthInfo{ this->sampler, depthView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+  VkDescriptorImageInfo colorInfo{ this->sampler, lowResolutionColorView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+  VkDescriptorImageInfo lowDepthInfo{ this->sampler, lowResolutionDepthView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+  DescriptorWriter(*this->lowResolutionSetLayout, *this->compositePool)
+    .write(0, &depthInfo)
+    .write(1, &colorInfo)
+    .write(2, &lowDepthInfo)
+    .overwrite(set);
+
+  // layout transitions have to cover the stencil aspect too when the format has one
+  bool hasStencil = depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT || depthFormat == VK_FORMAT_D24_UNORM_S8_UINT;
+  VkImageMemoryBarrier depthBarrier{};
+  depthBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  depthBarrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  depthBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  depthBarrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  depthBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+  depthBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  depthBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  depthBarrier.image = depthImage;
+  depthBarrier.subresourceRange = {
+    VK_IMAGE_ASPECT_DEPTH_BIT | (hasStencil ? VK_IMAGE_ASPECT_STENCIL_BIT : 0u), 0, 1, 0, 1
+  };
+  frameInfo.recorder.imageBarrier(
+    VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+    depthBarrier
+  );
+}
+
+void Billboards::downsampleDepth(const FrameInfo& frameInfo) {
+  VkDescriptorSet& set = this->lowResolutionSets[frameInfo.frameIndex];
+  this->depthDownsamplePipeline->bind(frameInfo.recorder);
+  frameInfo.recorder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, this->lowResolutionPipelineLayout, 2, 1, &set);
+  BillboardsResolutionPushConstantData data{ this->resolutionDivisor };
+  frameInfo.recorder.pushConstants(
+    this->lowResolutionPipelineLayout,
+    VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+    0,
+    sizeof(BillboardsResolutionPushConstantData),
+    &data
+  );
+  frameInfo.recorder.draw(3, 1, 0, 0);
+}
+
+void Billboards::upsample(const FrameInfo& frameInfo) {
+  VkDescriptorSet& set = this->lowResolutionSets[frameInfo.frameIndex];
+  this->upsamplePipeline->bind(frameInfo.recorder);
+  frameInfo.recorder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, this->lowResolutionPipelineLayout, 2, 1, &set);
+  BillboardsResolutionPushConstantData data{ this->resolutionDivisor };
+  frameInfo.recorder.pushConstants(
+    this->lowResolutionPipelineLayout,
+    VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+    0,
+    sizeof(BillboardsResolutionPushConstantData),
+    &data
+  );
+  frameInfo.recorder.draw(3, 1, 0, 0);
+}
@@ -0,0 +1,78 @@
+#include "engine/renderer/systems/DeferredLighting.h"
+
+#include <stdexcept>
+
+using Scop::Renderer::Systems::DeferredLighting;
+
+DeferredLighting::DeferredLighting(const SystemInfo& deps) : device(deps.device) {
+  this->setLayout = DescriptorSetLayout::Builder(this->device)
+    .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+    .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+    .addBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+    .build(deps.layoutCache);
+  this->pool = DescriptorPool::Builder(this->device)
+    .setMaxSets(Swapchain::MAX_FRAMES_IN_FLIGHT)
+    .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, Swapchain::MAX_FRAMES_IN_FLIGHT * 3)
+    .build();
+  for (auto& set : this->sets) {
+    if (!this->pool->allocSet(this->setLayout->getHandle(), set))
+      throw std::runtime_error("Failed to allocate deferred lighting descriptor set");
+  }
+  this->pipelineLayout = deps.layoutCache.getPipelineLayout(
+    { deps.globalDescriptorSetLayout, deps.bindlessTable.getSetLayout(), this->setLayout->getHandle() },
+    { Base::SharedPushConstantRange }
+  );
+
+  Pipeline::ConfigInfo config{};
+  Pipeline::SetupDefaultConfigInfo(config);
+  config.attributeDescriptions.clear();
+  config.bindingDescriptions.clear();
+  // the depth stays for the forward passes that follow
+  config.depthStencilInfo.depthTestEnable = VK_FALSE;
+  config.depthStencilInfo.depthWriteEnable = VK_FALSE;
+  config.renderPass = deps.renderPass;
+  config.pipelineLayout = this->pipelineLayout;
+  this->pipeline = std::make_unique<Pipeline>(
+    this->device,
+    SHADERS_PATH"fullscreen.vert.spv",
+    SHADERS_PATH"deferred_lighting.frag.spv",
+    config
+  );
+
+  // the targets match the framebuffer, texels are fetched one to one
+  VkSamplerCreateInfo samplerInfo{};
+  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter = VK_FILTER_NEAREST;
+  samplerInfo.minFilter = VK_FILTER_NEAREST;
+  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  if (vkCreateSampler(this->device.getHandle(), &samplerInfo, nullptr, &this->sampler) != VK_SUCCESS)
+    throw std::runtime_error("Failed to create deferred lighting sampler");
+}
+
+DeferredLighting::~DeferredLighting() {
+  vkDestroySampler(this->device.getHandle(), this->sampler, nullptr);
+}
+
+void DeferredLighting::resolve(
+  const FrameInfo& frameInfo,
+  VkImageView normalView,
+  VkImageView albedoView,
+  VkImageView depthView
+) {
+  VkDescriptorSet& set = this->sets[frameInfo.frameIndex];
+  VkDescriptorImageInfo normalInfo{ this->sampler, normalView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+  VkDescriptorImageInfo albedoInfo{ this->sampler, albedoView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+  VkDescriptorImageInfo depthInfo{ this->sampler, depthView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+  DescriptorWriter(*this->setLayout, *this->pool)
+    .write(0, &normalInfo)
+    .write(1, &albedoInfo)
+    .write(2, &depthInfo)
+    .overwrite(set);
+
+  this->pipeline->bind(frameInfo.recorder);
+  frameInfo.recorder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, this->pipelineLayout, 2, 1, &set);
+  frameInfo.recorder.draw(3, 1, 0, 0);
+}
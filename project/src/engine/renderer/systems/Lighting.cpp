@@ -3,30 +3,193 @@
 
 
 #include <glm/glm.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
 #include <iostream>
 
 using Scop::Renderer::Systems::Lighting;
 
+Lighting::Lighting(const SystemInfo& deps, Scene& scene) : scene(scene), device(deps.device), bindlessTable(deps.bindlessTable) {
+  this->clusters.resize(CLUSTER_COUNT);
+  for (auto& frame : this->frames) {
+    this->reserve(frame.lights, sizeof(PointLightData), 0, INITIAL_LIGHT_CAPACITY);
+    this->reserve(frame.clusters, sizeof(ClusterData), CLUSTER_COUNT, CLUSTER_COUNT);
+    this->reserve(frame.lightIndices, sizeof(uint32_t), 0, INITIAL_LIGHT_CAPACITY * 4);
+  }
+
+  auto& registry = this->scene.getRegistry();
+  registry.on_construct<Components::PointLight>().connect<&Lighting::onEdit>(*this);
+  registry.on_update<Components::PointLight>().connect<&Lighting::onEdit>(*this);
+  registry.on_destroy<Components::PointLight>().connect<&Lighting::onEdit>(*this);
+  // a light seen without a Transform has no slot until one is added
+  registry.on_construct<Components::Transform>().connect<&Lighting::onEdit>(*this);
+  registry.on_update<Components::Transform>().connect<&Lighting::onEdit>(*this);
+  registry.on_destroy<Components::Transform>().connect<&Lighting::onEdit>(*this);
+  // lights created before the system
+  for (auto entity : registry.view<Components::PointLight, Components::Transform>())
+    this->pending.push_back(entity);
+}
+
+Lighting::~Lighting() {
+  auto& registry = this->scene.getRegistry();
+  registry.on_construct<Components::PointLight>().disconnect(this);
+  registry.on_update<Components::PointLight>().disconnect(this);
+  registry.on_destroy<Components::PointLight>().disconnect(this);
+  registry.on_construct<Components::Transform>().disconnect(this);
+  registry.on_update<Components::Transform>().disconnect(this);
+  registry.on_destroy<Components::Transform>().disconnect(this);
+  for (auto& frame : this->frames) {
+    this->bindlessTable.releaseBuffer(frame.lights.tableIndex);
+    this->bindlessTable.releaseBuffer(frame.clusters.tableIndex);
+    this->bindlessTable.releaseBuffer(frame.lightIndices.tableIndex);
+  }
+}
+
+bool Lighting::reserve(FrameBuffer& frameBuffer, VkDeviceSize elementSize, uint32_t count, uint32_t initialCapacity) {
+  if (frameBuffer.buffer && frameBuffer.buffer->getInstanceCount() >= count)
+    return false;
+  uint32_t capacity = frameBuffer.buffer ? frameBuffer.buffer->getInstanceCount() : initialCapacity;
+  while (capacity < count)
+    capacity *= 2;
+
+  // the previous buffer of this frame slot is no longer in flight
+  frameBuffer.buffer = std::make_unique<MemBuffer>(
+    this->device,
+    elementSize,
+    capacity,
+    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+  );
+  frameBuffer.buffer->map();
+  if (frameBuffer.tableIndex == BindlessTable::INVALID_INDEX)
+    frameBuffer.tableIndex = this->bindlessTable.registerBuffer(*frameBuffer.buffer);
+  else
+    this->bindlessTable.updateBuffer(frameBuffer.tableIndex, *frameBuffer.buffer);
+  return true;
+}
+
+void Lighting::onEdit(entt::registry& registry, entt::entity entity) {
+  // still there during on_destroy, the removal is seen by applyEdits
+  if (registry.all_of<Components::PointLight>(entity))
+    this->pending.push_back(entity);
+}
+
+bool Lighting::applyEdits(entt::registry& registry) {
+  bool changed = false;
+  for (auto entity : this->pending) {
+    auto it = this->slots.find(entity);
+    if (!registry.valid(entity) || !registry.all_of<Components::PointLight, Components::Transform>(entity)) {
+      if (it == this->slots.end())
+        continue;
+      // the last light moves into the freed slot
+      const uint32_t slot = it->second;
+      const uint32_t last = static_cast<uint32_t>(this->lights.size()) - 1;
+      this->slots.erase(it);
+      if (slot != last) {
+        this->lights[slot] = this->lights[last];
+        this->slotEntities[slot] = this->slotEntities[last];
+        this->lightStamps[slot] = this->stamp;
+        this->slots[this->slotEntities[slot]] = slot;
+      }
+      this->lights.pop_back();
+      this->slotEntities.pop_back();
+      this->lightStamps.pop_back();
+      changed = true;
+      continue;
+    }
+
+    auto [pointLight, transform] = registry.get<Components::PointLight, Components::Transform>(entity);
+    const PointLightData light{ glm::vec4(transform.translation, pointLight.range), pointLight.color };
+    if (it == this->slots.end()) {
+      this->slots.emplace(entity, static_cast<uint32_t>(this->lights.size()));
+      this->lights.push_back(light);
+      this->slotEntities.push_back(entity);
+      this->lightStamps.push_back(this->stamp);
+      changed = true;
+    }
+    else if (std::memcmp(&this->lights[it->second], &light, sizeof(PointLightData)) != 0) {
+      this->lights[it->second] = light;
+      this->lightStamps[it->second] = this->stamp;
+      changed = true;
+    }
+  }
+  this->pending.clear();
+  return changed;
+}
+
+void Lighting::uploadLights(FrameBuffers& frame) {
+  const auto count = static_cast<uint32_t>(this->lights.size());
+  const bool recreated = this->reserve(frame.lights, sizeof(PointLightData), count, INITIAL_LIGHT_CAPACITY);
+  auto stale = [&](uint32_t slot) { return recreated || this->lightStamps[slot] > frame.lightStamp; };
+  // one write per run of consecutive stale slots
+  for (uint32_t slot = 0; slot < count;) {
+    if (!stale(slot)) {
+      slot++;
+      continue;
+    }
+    uint32_t end = slot + 1;
+    while (end < count && stale(end))
+      end++;
+    const VkDeviceSize size = (end - slot) * sizeof(PointLightData);
+    frame.lights.buffer->writeTo(&this->lights[slot], size, slot * sizeof(PointLightData));
+    this->uploadBytes += size;
+    slot = end;
+  }
+  frame.lightStamp = this->stamp;
+}
+
 void Lighting::update(FrameInfo& frameInfo, Scene& scene) {
   auto rotateLight = glm::rotate(glm::mat4(1.f), 0.5f * frameInfo.deltaTime, { 0.f, -1.f, 0.f });
   if (Input::IsKeyDown(Input::Key::L))
     this->rotateLight = !this->rotateLight;
 
+  auto& registry = scene.getRegistry();
+  if (this->rotateLight) {
+    // patched so that the lights are uploaded again
+    for (auto entity : registry.view<Components::PointLight, Components::Transform>()) {
+      registry.patch<Components::Transform>(entity, [&](auto& transform) {
+        transform.translation = glm::vec3(rotateLight * glm::vec4(transform.translation, 1.f));
+        });
+    }
+  }
+  this->stamp++;
+  if (this->applyEdits(registry))
+    this->version++;
+
+  // slice = log(depth) * scale + bias, so slice k starts at near * (far / near)^(k / CLUSTERS_Z)
   GlobalUbo& ubo = frameInfo.globalUbo;
-  auto view = scene.viewEntitiesWith<Components::PointLight, Components::Transform>();
-  uint32_t lightIndex = 0;
-  for (auto entity : view) {
-    auto [pointLight, transform] = view.get<Components::PointLight, Components::Transform>(entity);
-    if (lightIndex >= MAX_LIGHTS) break;
-    // update light position
-    if (this->rotateLight)
-      transform.translation = glm::vec3(rotateLight * glm::vec4(transform.translation, 1.f));
-    ubo.pointLights[lightIndex].position = glm::vec4(transform.translation, 1.0f);
-    ubo.pointLights[lightIndex].color = pointLight.color;
-    ubo.pointLights[lightIndex].range = pointLight.range;
-    lightIndex++;
-  }
-  ubo.pointLightCount = lightIndex;
+  const float nearClip = frameInfo.sceneCamera.getPerspectiveNearClip();
+  const float farClip = frameInfo.sceneCamera.getPerspectiveFarClip();
+  const float logRatio = std::log(farClip / nearClip);
+  ubo.clusterGrid = glm::uvec4(CLUSTERS_X, CLUSTERS_Y, CLUSTERS_Z, 0);
+  ubo.clusterDepth = glm::vec4(CLUSTERS_Z / logRatio, -(CLUSTERS_Z * std::log(nearClip)) / logRatio, nearClip, farClip);
+  // the clip planes are part of the projection
+  if (this->clusterLightVersion != this->version || this->clusterView != ubo.view || this->clusterProjection != ubo.projection) {
+    this->buildClusters(ubo);
+    this->clusterLightVersion = this->version;
+    this->clusterView = ubo.view;
+    this->clusterProjection = ubo.projection;
+    this->clusterVersion++;
+  }
+
+  this->uploadBytes = 0;
+  auto& frame = this->frames[frameInfo.frameIndex];
+  this->uploadLights(frame);
+  const bool recreated = this->reserve(frame.lightIndices, sizeof(uint32_t), static_cast<uint32_t>(this->lightIndices.size()), INITIAL_LIGHT_CAPACITY * 4);
+  if (recreated || frame.clusterVersion != this->clusterVersion) {
+    frame.clusters.buffer->writeTo(this->clusters.data(), this->clusters.size() * sizeof(ClusterData));
+    this->uploadBytes += this->clusters.size() * sizeof(ClusterData);
+    if (!this->lightIndices.empty())
+      frame.lightIndices.buffer->writeTo(this->lightIndices.data(), this->lightIndices.size() * sizeof(uint32_t));
+    this->uploadBytes += this->lightIndices.size() * sizeof(uint32_t);
+    frame.clusterVersion = this->clusterVersion;
+  }
+  ubo.pointLightCount = static_cast<uint32_t>(this->lights.size());
+  ubo.lightBuffer = frame.lights.tableIndex;
+  ubo.clusterBuffer = frame.clusters.tableIndex;
+  ubo.lightIndexBuffer = frame.lightIndices.tableIndex;
   {
     auto view = scene.viewEntitiesWith<Components::GlobalLight, Components::Transform>();
     if (view.size_hint() == 0) return;  // No global light in the scene
@@ -36,4 +199,75 @@ void Lighting::update(FrameInfo& frameInfo, Scene& scene) {
     ubo.ambientLight.color = globalLight.color;
     ubo.ambientLight.range = -1.f;
   }
-}
\ No newline at end of file
+}
+
+void Lighting::buildClusters(const GlobalUbo& ubo) {
+  const float scale = ubo.clusterDepth.x;
+  const float bias = ubo.clusterDepth.y;
+  const float nearClip = ubo.clusterDepth.z;
+  const float farClip = ubo.clusterDepth.w;
+  std::array<float, CLUSTERS_Z + 1> sliceDepths;
+  for (uint32_t k = 0; k <= CLUSTERS_Z; k++)
+    sliceDepths[k] = nearClip * std::pow(farClip / nearClip, static_cast<float>(k) / CLUSTERS_Z);
+
+  // clip w is the view depth, x and y only scale with the symmetric perspective
+  const glm::mat4& projection = ubo.projection;
+  const glm::vec4 depthRow{ projection[0][3], projection[1][3], projection[2][3], projection[3][3] };
+  auto tile = [](float ndc, uint32_t count) {
+    return static_cast<uint32_t>(std::clamp((ndc * 0.5f + 0.5f) * count, 0.0f, count - 1.0f));
+  };
+  // calls fn with every cluster the view space box of the light touches
+  auto forEachCluster = [&](const PointLightData& light, auto&& fn) {
+    const glm::vec4 position = ubo.view * glm::vec4(glm::vec3(light.position), 1.0f);
+    // no range lights everything in front of the far plane
+    const float range = light.position.w > 0.0f ? light.position.w : farClip;
+    const float depth = glm::dot(depthRow, position);
+    const float minDepth = std::max(depth - range, nearClip);
+    const float maxDepth = std::min(depth + range, farClip);
+    if (minDepth > maxDepth)
+      return;
+    const auto firstSlice = static_cast<uint32_t>(std::clamp(std::log(minDepth) * scale + bias, 0.0f, CLUSTERS_Z - 1.0f));
+    const auto lastSlice = static_cast<uint32_t>(std::clamp(std::log(maxDepth) * scale + bias, 0.0f, CLUSTERS_Z - 1.0f));
+    for (uint32_t slice = firstSlice; slice <= lastSlice; slice++) {
+      // x / depth is monotonic over the box, its extremes are at the corners
+      const float nearDepth = std::max(minDepth, sliceDepths[slice]);
+      const float farDepth = std::min(maxDepth, sliceDepths[slice + 1]);
+      float minX = 1.0f, maxX = -1.0f, minY = 1.0f, maxY = -1.0f;
+      for (float sliceDepth : { nearDepth, farDepth }) {
+        for (float side : { -range, range }) {
+          const float x = projection[0][0] * (position.x + side) / sliceDepth;
+          const float y = projection[1][1] * (position.y + side) / sliceDepth;
+          minX = std::min(minX, x);
+          maxX = std::max(maxX, x);
+          minY = std::min(minY, y);
+          maxY = std::max(maxY, y);
+        }
+      }
+      if (maxX < -1.0f || minX > 1.0f || maxY < -1.0f || minY > 1.0f)
+        continue;
+      const uint32_t lastX = tile(maxX, CLUSTERS_X), lastY = tile(maxY, CLUSTERS_Y);
+      for (uint32_t y = tile(minY, CLUSTERS_Y); y <= lastY; y++)
+        for (uint32_t x = tile(minX, CLUSTERS_X); x <= lastX; x++)
+          fn((slice * CLUSTERS_Y + y) * CLUSTERS_X + x);
+    }
+  };
+
+  // count, prefix sum, then fill: every cluster list is contiguous in the index buffer
+  for (auto& cluster : this->clusters)
+    cluster = { 0, 0 };
+  for (const auto& light : this->lights)
+    forEachCluster(light, [&](uint32_t cluster) { this->clusters[cluster].count++; });
+  uint32_t offset = 0;
+  for (auto& cluster : this->clusters) {
+    cluster.offset = offset;
+    offset += cluster.count;
+    cluster.count = 0;
+  }
+  this->lightIndices.resize(offset);
+  for (uint32_t i = 0; i < this->lights.size(); i++) {
+    forEachCluster(this->lights[i], [&](uint32_t cluster) {
+      auto& data = this->clusters[cluster];
+      this->lightIndices[data.offset + data.count++] = i;
+      });
+  }
+}
@@ -1,73 +1,622 @@
 #include "engine/renderer/systems/Simple.h"
 #include <engine/scene/components/Mesh.h>
+#include <engine/scene/components/Static.h>
 
+#include <algorithm>
+#include <chrono>
+#include <thread>
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
 using Scop::Renderer::Systems::Simple;
 
-struct BillboardsPushConstantData {
-  glm::mat4 modelMatrix{ 1.0f };
-  glm::mat4 normalMatrix{ 1.0f };
+struct SimplePushConstantData {
+  uint32_t instanceBuffer;
+};
+static_assert(sizeof(SimplePushConstantData) <= Simple::SharedPushConstantRange.size);
+
+// matches PushConstantData in cull.comp
+struct CullPushConstantData {
+  uint32_t firstInstance;
+  uint32_t instanceCount;
+  uint32_t inputBuffer;
+  uint32_t outputBuffer;
+  uint32_t commandBuffer;
+  uint32_t visibilityBuffer;
+  uint32_t statsBuffer;
+  uint32_t phase;
+  uint32_t lateOffset;
+  uint32_t pyramid;
+  uint32_t pyramidWidth;
+  uint32_t pyramidHeight;
+  uint32_t pyramidLevels;
+};
+
+// matches PushConstantData in triangle_filter.comp
+struct FilterPushConstantData {
+  uint32_t instanceBuffer;
+  uint32_t instance;
+  uint32_t indexBuffer;
+  uint32_t positionBuffer;
+  uint32_t positionStride;
+  uint32_t firstIndex;
+  uint32_t firstVertex;
+  uint32_t triangleCount;
+  uint32_t outputBuffer;
+  uint32_t outputOffset;
+  uint32_t commandBuffer;
+  uint32_t command;
+  uint32_t statsBuffer;
+};
+
+// matches StatsBuffer in triangle_filter.comp, cull.comp only declares the first three
+struct CullStats {
+  uint32_t frustumCulled;
+  uint32_t occlusionCulled;
+  uint32_t drawn;
+  uint32_t trianglesTested;
+  uint32_t trianglesCulled;
 };
 
 Simple::Simple(
-  const SystemInfo& deps
+  const SystemInfo& deps,
+  GeometryPool& geometryPool,
+  const Impostors& impostors
 ) : Base(
   deps,
   SHADERS_PATH"simple.vert.spv",
   SHADERS_PATH"simple.frag.spv"
-) {
+), bindlessTable(deps.bindlessTable), geometryPool(geometryPool), impostors(impostors) {
   this->init(deps);
+  this->createGBufferPipeline(deps.gbufferRenderPass, SHADERS_PATH"gbuffer.frag.spv");
+  this->createDepthPrepassPipelines(deps.renderPass, SHADERS_PATH"depth_prepass.vert.spv");
+  this->cullPipelineLayout = deps.layoutCache.getPipelineLayout(
+    { deps.globalDescriptorSetLayout, deps.bindlessTable.getSetLayout() },
+    { { VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstantData) } }
+  );
+  this->cullPipeline = std::make_unique<ComputePipeline>(
+    this->device,
+    SHADERS_PATH"cull.comp.spv",
+    this->cullPipelineLayout
+  );
+  this->filterPipelineLayout = deps.layoutCache.getPipelineLayout(
+    { deps.globalDescriptorSetLayout, deps.bindlessTable.getSetLayout() },
+    { { VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(FilterPushConstantData) } }
+  );
+  this->filterPipeline = std::make_unique<ComputePipeline>(
+    this->device,
+    SHADERS_PATH"triangle_filter.comp.spv",
+    this->filterPipelineLayout
+  );
+  for (auto& instances : this->instances)
+    this->reserveInstances(instances, INITIAL_INSTANCE_CAPACITY);
+  for (auto& indirect : this->indirect) {
+    this->reserveIndirect(indirect, INITIAL_INSTANCE_CAPACITY);
+    indirect.stats = std::make_unique<MemBuffer>(
+      this->device,
+      sizeof(CullStats),
+      1,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    );
+    indirect.stats->map();
+    indirect.statsTableIndex = this->bindlessTable.registerBuffer(*indirect.stats);
+  }
+  this->reserveVisibility(INITIAL_INSTANCE_CAPACITY);
+  this->cpuCullThreads = std::max(std::thread::hardware_concurrency(), 1u);
+  this->setIndirectDraw(true);
 }
 
-void Simple::createPipelineLayout(VkDescriptorSetLayout globalDescriptorSetLayout) {
-  VkPushConstantRange pushConstantRange{};
-  pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-  pushConstantRange.offset = 0;
-  pushConstantRange.size = sizeof(BillboardsPushConstantData);
+Simple::~Simple() {
+  for (auto& instances : this->instances) {
+    this->bindlessTable.releaseBuffer(instances.tableIndex);
+    this->bindlessTable.releaseBuffer(instances.culledTableIndex);
+  }
+  for (auto& indirect : this->indirect) {
+    this->bindlessTable.releaseBuffer(indirect.tableIndex);
+    this->bindlessTable.releaseBuffer(indirect.statsTableIndex);
+  }
+  for (auto& filter : this->filters) {
+    this->bindlessTable.releaseBuffer(filter.indicesTableIndex);
+    this->bindlessTable.releaseBuffer(filter.commandsTableIndex);
+    this->bindlessTable.releaseBuffer(filter.poolIndicesTableIndex);
+    this->bindlessTable.releaseBuffer(filter.poolPositionsTableIndex);
+  }
+  this->bindlessTable.releaseBuffer(this->visibilityTableIndex);
+}
 
-  std::vector<VkDescriptorSetLayout> layouts = { globalDescriptorSetLayout };
+void Simple::reserveInstances(FrameInstances& instances, uint32_t count) {
+  if (instances.buffer && instances.buffer->getInstanceCount() >= count)
+    return;
+  uint32_t capacity = instances.buffer ? instances.buffer->getInstanceCount() : INITIAL_INSTANCE_CAPACITY;
+  while (capacity < count)
+    capacity *= 2;
 
-  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-  pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(layouts.size());
-  pipelineLayoutInfo.pSetLayouts = layouts.data();
-  pipelineLayoutInfo.pushConstantRangeCount = 1;
-  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+  // the previous buffer of this frame slot is no longer in flight, so it can be
+  // swapped out and its table entry rewritten in place
+  instances.buffer = std::make_unique<MemBuffer>(
+    this->device,
+    sizeof(InstanceData),
+    capacity,
+    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+  );
+  instances.buffer->map();
+  if (instances.tableIndex == BindlessTable::INVALID_INDEX)
+    instances.tableIndex = this->bindlessTable.registerBuffer(*instances.buffer);
+  else
+    this->bindlessTable.updateBuffer(instances.tableIndex, *instances.buffer);
 
-  if (vkCreatePipelineLayout(this->device.getHandle(), &pipelineLayoutInfo, nullptr, &this->pipelineLayout) != VK_SUCCESS)
-    throw std::runtime_error("Failed to create pipeline layout");
+  // only ever written and read by the GPU, early and late instances side by side
+  instances.culled = std::make_unique<MemBuffer>(
+    this->device,
+    sizeof(InstanceData),
+    capacity * 2,
+    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+  );
+  if (instances.culledTableIndex == BindlessTable::INVALID_INDEX)
+    instances.culledTableIndex = this->bindlessTable.registerBuffer(*instances.culled);
+  else
+    this->bindlessTable.updateBuffer(instances.culledTableIndex, *instances.culled);
 }
 
-void Simple::render(const FrameInfo& frameInfo, Scene& scene) {
-  this->pipeline->bind(frameInfo.commandBuffer);
+void Simple::reserveIndirect(FrameIndirect& indirect, uint32_t count) {
+  if (indirect.commands && indirect.commands->getInstanceCount() >= count)
+    return;
+  uint32_t capacity = indirect.commands ? indirect.commands->getInstanceCount() : INITIAL_INSTANCE_CAPACITY;
+  while (capacity < count)
+    capacity *= 2;
 
-  vkCmdBindDescriptorSets(
-    frameInfo.commandBuffer,
-    VK_PIPELINE_BIND_POINT_GRAPHICS,
-    this->pipelineLayout,
-    0, 1, &frameInfo.globalDescriptorSet,
-    0, nullptr
+  indirect.commands = std::make_unique<MemBuffer>(
+    this->device,
+    sizeof(VkDrawIndexedIndirectCommand),
+    capacity,
+    VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
   );
+  indirect.commands->map();
+  // the cull pass counts visible instances straight into the commands
+  if (indirect.tableIndex == BindlessTable::INVALID_INDEX)
+    indirect.tableIndex = this->bindlessTable.registerBuffer(*indirect.commands);
+  else
+    this->bindlessTable.updateBuffer(indirect.tableIndex, *indirect.commands);
+}
+
+void Simple::reserveFilter(FrameFilter& filter, uint32_t commandCount, uint32_t indexCount) {
+  if (!filter.commands || filter.commands->getInstanceCount() < commandCount) {
+    uint32_t capacity = filter.commands ? filter.commands->getInstanceCount() : INITIAL_INSTANCE_CAPACITY;
+    while (capacity < commandCount)
+      capacity *= 2;
+    // the filter pass counts kept indices straight into the commands
+    filter.commands = std::make_unique<MemBuffer>(
+      this->device,
+      sizeof(VkDrawIndexedIndirectCommand),
+      capacity,
+      VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    );
+    filter.commands->map();
+    if (filter.commandsTableIndex == BindlessTable::INVALID_INDEX)
+      filter.commandsTableIndex = this->bindlessTable.registerBuffer(*filter.commands);
+    else
+      this->bindlessTable.updateBuffer(filter.commandsTableIndex, *filter.commands);
+  }
+  if (indexCount == 0 || (filter.indices && filter.indices->getInstanceCount() >= indexCount))
+    return;
+  uint32_t capacity = filter.indices ? filter.indices->getInstanceCount() : GeometryPool::INITIAL_INDEX_CAPACITY;
+  while (capacity < indexCount)
+    capacity *= 2;
+  // room for every triangle of every filtered instance, only ever written by the GPU
+  filter.indices = std::make_unique<MemBuffer>(
+    this->device,
+    sizeof(uint32_t),
+    capacity,
+    VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+  );
+  if (filter.indicesTableIndex == BindlessTable::INVALID_INDEX)
+    filter.indicesTableIndex = this->bindlessTable.registerBuffer(*filter.indices);
+  else
+    this->bindlessTable.updateBuffer(filter.indicesTableIndex, *filter.indices);
+}
+
+void Simple::updatePoolTable(FrameFilter& filter) {
+  // growing the pool waits for the device, so no frame still reads the old buffers
+  const uint32_t generation = this->geometryPool.getGeneration();
+  if (filter.poolGeneration == generation)
+    return;
+  filter.poolGeneration = generation;
+  const MemBuffer& indices = this->geometryPool.getIndexMemBuffer();
+  // positions come first in stream 0 with either vertex layout
+  const MemBuffer& positions = this->geometryPool.getVertexMemBuffer(0);
+  if (filter.poolIndicesTableIndex == BindlessTable::INVALID_INDEX) {
+    filter.poolIndicesTableIndex = this->bindlessTable.registerBuffer(indices);
+    filter.poolPositionsTableIndex = this->bindlessTable.registerBuffer(positions);
+    return;
+  }
+  this->bindlessTable.updateBuffer(filter.poolIndicesTableIndex, indices);
+  this->bindlessTable.updateBuffer(filter.poolPositionsTableIndex, positions);
+}
+
+void Simple::reserveVisibility(uint32_t count) {
+  if (this->visibility && this->visibility->getInstanceCount() >= count)
+    return;
+  uint32_t capacity = this->visibility ? this->visibility->getInstanceCount() : INITIAL_INSTANCE_CAPACITY;
+  while (capacity < count)
+    capacity *= 2;
+
+  // every frame in flight reads it, rare enough to just wait for them
+  if (this->visibility)
+    vkDeviceWaitIdle(this->device.getHandle());
+  // a few bytes per entity, host memory keeps growing and clearing it trivial
+  auto grown = std::make_unique<MemBuffer>(
+    this->device,
+    sizeof(uint32_t),
+    capacity,
+    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+  );
+  grown->map();
+  auto data = static_cast<uint32_t*>(grown->getMappedMemory());
+  std::fill_n(data, capacity, 0u);
+  if (this->visibility)
+    std::copy_n(static_cast<const uint32_t*>(this->visibility->getMappedMemory()), this->visibility->getInstanceCount(), data);
+  this->visibility = std::move(grown);
+  if (this->visibilityTableIndex == BindlessTable::INVALID_INDEX)
+    this->visibilityTableIndex = this->bindlessTable.registerBuffer(*this->visibility);
+  else
+    this->bindlessTable.updateBuffer(this->visibilityTableIndex, *this->visibility);
+}
+
+void Simple::collectCullResults(FrameIndirect& indirect, FrameFilter& filter) {
+  // the frame that last used this slot has completed, its counters are final
+  auto stats = static_cast<CullStats*>(indirect.stats->getMappedMemory());
+  if (indirect.culled) {
+    this->visibleInstances = stats->drawn;
+    this->frustumCulled = stats->frustumCulled;
+    this->occlusionCulled = stats->occlusionCulled;
+  }
+  if (filter.filtered) {
+    this->filterTestedTriangles = stats->trianglesTested;
+    this->filterCulledTriangles = stats->trianglesCulled;
+  }
+  *stats = {};
+}
+
+void Simple::drawIndirect(CommandRecorder& recorder, const MemBuffer& commands, uint32_t firstCommand, uint32_t drawCount) {
+  const auto& features = this->device.getOptionalFeatures();
+  constexpr uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+  VkDeviceSize offset = firstCommand * stride;
+  if (features.multiDrawIndirect)
+    recorder.drawIndexedIndirect(commands.getHandle(), offset, drawCount, stride);
+  else {
+    // without multiDrawIndirect drawCount must be 0 or 1
+    for (uint32_t i = 0; i < drawCount; i++)
+      recorder.drawIndexedIndirect(commands.getHandle(), offset + i * stride, 1, stride);
+  }
+}
+
+void Simple::enqueue(const FrameInfo& frameInfo, Scene& scene, RenderQueue& queue) {
+  // static meshes are drawn by the static batches
+  auto group = scene.viewEntitiesWith<Components::Mesh, Components::Transform>(entt::exclude<Components::Static>);
+  const glm::vec3 cameraPosition = frameInfo.sceneCamera.getPosition();
+  uint32_t count = 0;
+  uint32_t entityCount = 0;
+  uint32_t filteredCount = 0;
+  uint32_t filteredIndices = 0;
+  auto push = [&](entt::entity entity, const Components::Mesh& mesh, const Components::Transform& transform) {
+    if (this->impostors.isDistant(*mesh.model, transform))
+      return;
+    auto distance = transform.translation - cameraPosition;
+    uint64_t key = RenderQueue::MakeKey(
+      RenderQueue::Pass::Opaque,
+      this->queueId,
+      mesh.model->getId(),
+      glm::dot(distance, distance)
+    );
+    queue.push(this->queueId, key, static_cast<uint32_t>(entity));
+    count++;
+    entityCount = std::max<uint32_t>(entityCount, entt::to_entity(entity) + 1);
+    if (this->isFiltered(*mesh.model)) {
+      filteredCount++;
+      filteredIndices += mesh.model->getAllocation().indexCount;
+    }
+  };
 
+  if (!this->cpuCulling) {
+    for (auto entity : group) {
+      auto [mesh, transform] = group.get<Components::Mesh, Components::Transform>(entity);
+      if (mesh.model)
+        push(entity, mesh, transform);
+    }
+  }
+  else {
+    this->culler.clear();
+    this->cullEntities.clear();
+    for (auto entity : group) {
+      auto [mesh, transform] = group.get<Components::Mesh, Components::Transform>(entity);
+      if (!mesh.model)
+        continue;
+      this->culler.add(static_cast<glm::mat4>(transform), mesh.model->getBounds());
+      this->cullEntities.push_back(entity);
+    }
+    auto cullStart = std::chrono::high_resolution_clock::now();
+    this->cullVisible.clear();
+    this->culler.cull(frameInfo.sceneCamera.getProjectionView(), this->cullVisible, this->cpuCullThreads);
+    auto cullEnd = std::chrono::high_resolution_clock::now();
+    this->cpuCullMicroseconds = std::chrono::duration<float, std::chrono::microseconds::period>(cullEnd - cullStart).count();
+    this->cpuCulled = static_cast<uint32_t>(this->cullEntities.size() - this->cullVisible.size());
+    for (uint32_t index : this->cullVisible) {
+      auto entity = this->cullEntities[index];
+      auto [mesh, transform] = group.get<Components::Mesh, Components::Transform>(entity);
+      push(entity, mesh, transform);
+    }
+  }
+  auto& indirect = this->indirect[frameInfo.frameIndex];
+  auto& filter = this->filters[frameInfo.frameIndex];
+  this->collectCullResults(indirect, filter);
+  indirect.culled = this->isCulling();
+  filter.filtered = filteredCount > 0;
+
+  this->queuedInstances = count;
+  this->instanceCount = 0;
+  this->filterCommandCount = 0;
+  this->filterIndexCount = 0;
+  this->drawCommands.clear();
+  this->batches.clear();
+  this->nextBatch = 0;
+  this->reserveInstances(this->instances[frameInfo.frameIndex], count);
+  // room for the late commands after the early ones
+  this->reserveIndirect(indirect, count * 2);
+  if (this->isOcclusionCulling())
+    this->reserveVisibility(entityCount);
+  if (filter.filtered)
+    this->reserveFilter(filter, filteredCount, filteredIndices);
+}
+
+void Simple::dispatchCulling(const FrameInfo& frameInfo, const Batch& batch, CullPhase phase, const DepthPyramid* pyramid) {
+  auto& recorder = frameInfo.recorder;
+  const auto& instances = this->instances[frameInfo.frameIndex];
+  const auto& indirect = this->indirect[frameInfo.frameIndex];
+  this->cullPipeline->bind(recorder);
+  VkDescriptorSet sets[] = { frameInfo.globalDescriptorSet, this->bindlessTable.getSet() };
+  recorder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_COMPUTE, this->cullPipelineLayout, 0, 2, sets);
+  CullPushConstantData data{
+    batch.firstInstance,
+    batch.instanceCount,
+    instances.tableIndex,
+    instances.culledTableIndex,
+    indirect.tableIndex,
+    this->visibilityTableIndex,
+    indirect.statsTableIndex,
+    static_cast<uint32_t>(phase),
+    this->queuedInstances,
+    pyramid ? pyramid->getTableIndex() : 0,
+    pyramid ? pyramid->getExtent().width : 0,
+    pyramid ? pyramid->getExtent().height : 0,
+    pyramid ? pyramid->getLevelCount() : 0
+  };
+  recorder.pushConstants(this->cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(data), &data);
+  recorder.dispatch((batch.instanceCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+  // the host reads the counters back once the frame has completed, for stats
+  recorder.memoryBarrier(
+    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+    VK_ACCESS_SHADER_WRITE_BIT,
+    VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+    VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_HOST_READ_BIT
+  );
+}
+
+void Simple::preparePackets(const FrameInfo& frameInfo, Scene& scene, std::span<const RenderQueue::Packet> packets) {
   auto group = scene.viewEntitiesWith<Components::Mesh, Components::Transform>();
-  for (auto entity : group) {
-    auto [mesh, transform] = group.get<Components::Mesh, Components::Transform>(entity);
-    BillboardsPushConstantData data;
-    auto modelMatrix = static_cast<glm::mat4>(transform);
-    data.modelMatrix = modelMatrix;
-    data.normalMatrix = transform.computeNormalMatrix();
-
-    vkCmdPushConstants(
-      frameInfo.commandBuffer,
-      this->pipelineLayout,
-      VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-      0,
-      sizeof(BillboardsPushConstantData),
-      &data
+  auto& indirect = this->indirect[frameInfo.frameIndex];
+  auto instanceData = static_cast<InstanceData*>(this->instances[frameInfo.frameIndex].buffer->getMappedMemory());
+  const bool culling = this->isCulling();
+  const uint32_t firstInstance = this->instanceCount;
+  const auto firstCommand = static_cast<uint32_t>(this->drawCommands.size());
+  auto& filter = this->filters[frameInfo.frameIndex];
+  const uint32_t firstFilterCommand = this->filterCommandCount;
+
+  // packets come sorted by model, one instanced draw per run sharing a model
+  const auto count = static_cast<uint32_t>(packets.size());
+  // filtered instances fill the batch from the back, out of reach of the cull pass
+  uint32_t next = 0;
+  uint32_t nextFiltered = count;
+  uint32_t first = 0;
+  while (first < count) {
+    auto& model = group.get<Components::Mesh>(static_cast<entt::entity>(packets[first].payload)).model;
+    uint32_t last = first + 1;
+    while (last < count && group.get<Components::Mesh>(static_cast<entt::entity>(packets[last].payload)).model == model)
+      last++;
+    const bool filtered = this->isFiltered(*model);
+    const uint32_t runFirst = next;
+    const auto command = static_cast<uint32_t>(this->drawCommands.size());
+    for (uint32_t i = first; i < last; i++) {
+      auto entity = static_cast<entt::entity>(packets[i].payload);
+      auto [mesh, transform] = group.get<Components::Mesh, Components::Transform>(entity);
+      const uint32_t slot = firstInstance + (filtered ? --nextFiltered : next++);
+      auto& instance = instanceData[slot];
+      instance.modelMatrix = static_cast<glm::mat4>(transform);
+      instance.normalMatrix = glm::mat4(transform.computeNormalMatrix());
+      instance.color = glm::vec4(mesh.color, 1.0f);
+      instance.boundingSphere = model->getBoundingSphere();
+      instance.info = glm::uvec4(filtered ? this->filterCommandCount : command, entt::to_entity(entity), 0, 0);
+      if (filtered) {
+        // the filter pass counts the kept indices into a draw of its own
+        const uint32_t filterCommand = this->filterCommandCount++;
+        const uint32_t outputOffset = this->filterIndexCount;
+        this->filterIndexCount += model->getAllocation().indexCount;
+        auto commands = static_cast<VkDrawIndexedIndirectCommand*>(filter.commands->getMappedMemory());
+        commands[filterCommand] = { 0, 1, outputOffset, static_cast<int32_t>(model->getAllocation().firstVertex), slot };
+        this->dispatchFilter(frameInfo, *model, slot, filterCommand, outputOffset);
+      }
+    }
+    // culled runs start empty, the cull pass counts their visible instances
+    if (!filtered)
+      this->drawCommands.push_back(model->getIndirectCommand(culling ? 0 : last - first, firstInstance + runFirst));
+    first = last;
+  }
+  this->instanceCount += count;
+  Batch batch{
+    firstInstance,
+    next,
+    firstCommand,
+    static_cast<uint32_t>(this->drawCommands.size()) - firstCommand,
+    firstFilterCommand,
+    this->filterCommandCount - firstFilterCommand,
+    group.get<Components::Mesh>(static_cast<entt::entity>(packets.front().payload)).model.get()
+  };
+  this->batches.push_back(batch);
+  if (batch.filteredCount > 0) {
+    // the compacted indices and their counts feed the draws, the stats go back to the host
+    frameInfo.recorder.memoryBarrier(
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      VK_ACCESS_SHADER_WRITE_BIT,
+      VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+      VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_HOST_READ_BIT
+    );
+  }
+
+  if (!this->indirectDraw)
+    return;
+  auto commands = static_cast<VkDrawIndexedIndirectCommand*>(indirect.commands->getMappedMemory());
+  std::copy_n(this->drawCommands.begin() + firstCommand, batch.commandCount, commands + firstCommand);
+  if (!culling)
+    return;
+  if (this->isOcclusionCulling()) {
+    // late copies, drawing into their own part of the culled instances
+    for (uint32_t i = 0; i < batch.commandCount; i++) {
+      auto& late = commands[firstCommand + i + this->queuedInstances];
+      late = commands[firstCommand + i];
+      late.firstInstance += this->queuedInstances;
+    }
+  }
+  this->dispatchCulling(frameInfo, batch, this->isOcclusionCulling() ? CullPhase::Early : CullPhase::Frustum);
+}
+
+void Simple::dispatchFilter(const FrameInfo& frameInfo, const Model& model, uint32_t instance, uint32_t command, uint32_t outputOffset) {
+  auto& recorder = frameInfo.recorder;
+  auto& filter = this->filters[frameInfo.frameIndex];
+  const auto& allocation = model.getAllocation();
+  // not at enqueue, the systems enqueued after this one may still grow the pool
+  this->updatePoolTable(filter);
+  this->filterPipeline->bind(recorder);
+  VkDescriptorSet sets[] = { frameInfo.globalDescriptorSet, this->bindlessTable.getSet() };
+  recorder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_COMPUTE, this->filterPipelineLayout, 0, 2, sets);
+  FilterPushConstantData data{
+    this->instances[frameInfo.frameIndex].tableIndex,
+    instance,
+    filter.poolIndicesTableIndex,
+    filter.poolPositionsTableIndex,
+    static_cast<uint32_t>(this->geometryPool.getVertexStride(0) / sizeof(float)),
+    allocation.firstIndex,
+    allocation.firstVertex,
+    model.getTriangleCount(),
+    filter.indicesTableIndex,
+    outputOffset,
+    filter.commandsTableIndex,
+    command,
+    this->indirect[frameInfo.frameIndex].statsTableIndex
+  };
+  recorder.pushConstants(this->filterPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(data), &data);
+  recorder.dispatch((model.getTriangleCount() + FILTER_GROUP_SIZE - 1) / FILTER_GROUP_SIZE, 1, 1);
+}
+
+void Simple::cullOcclusion(const FrameInfo& frameInfo, const DepthPyramid& pyramid) {
+  for (const auto& batch : this->batches)
+    this->dispatchCulling(frameInfo, batch, CullPhase::Late, &pyramid);
+}
+
+void Simple::bindForDraw(const FrameInfo& frameInfo, Pipeline& pipeline) {
+  const auto& instances = this->instances[frameInfo.frameIndex];
+  pipeline.bind(frameInfo.recorder);
+  this->bindGlobalDescriptorSet(frameInfo);
+  SimplePushConstantData data{ this->isCulling() ? instances.culledTableIndex : instances.tableIndex };
+  frameInfo.recorder.pushConstants(
+    this->pipelineLayout,
+    VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+    0,
+    sizeof(SimplePushConstantData),
+    &data
+  );
+}
+
+void Simple::drawPackets(const FrameInfo& frameInfo, Scene&, std::span<const RenderQueue::Packet>) {
+  const Batch& batch = this->batches[this->nextBatch++];
+  if (batch.commandCount == 0 && batch.filteredCount == 0)
+    return;
+
+  this->bindForDraw(frameInfo, this->getPipeline());
+  if (batch.commandCount > 0)
+    this->drawBatch(frameInfo, batch, batch.firstCommand);
+  if (batch.filteredCount > 0)
+    this->drawFiltered(frameInfo, batch);
+}
+
+void Simple::drawDepthPrepass(const FrameInfo& frameInfo, bool late) {
+  if (this->batches.empty())
+    return;
+  this->bindForDraw(frameInfo, *this->depthPipeline);
+  for (const auto& batch : this->batches) {
+    if (batch.commandCount == 0)
+      continue;
+    this->drawBatch(frameInfo, batch, late ? batch.firstCommand + this->queuedInstances : batch.firstCommand);
+  }
+  // filtered instances skip occlusion culling, they are all drawn early
+  if (late)
+    return;
+  for (const auto& batch : this->batches)
+    if (batch.filteredCount > 0)
+      this->drawFiltered(frameInfo, batch);
+}
+
+void Simple::drawBatch(const FrameInfo& frameInfo, const Batch& batch, uint32_t firstCommand) {
+  // every model lives in the geometry pool, so binding any of them binds them all
+  batch.geometry->bind(frameInfo.recorder);
+  if (this->indirectDraw) {
+    this->drawIndirect(frameInfo.recorder, *this->indirect[frameInfo.frameIndex].commands, firstCommand, batch.commandCount);
+    return;
+  }
+  for (uint32_t i = 0; i < batch.commandCount; i++) {
+    const auto& command = this->drawCommands[firstCommand + i];
+    frameInfo.recorder.drawIndexed(
+      command.indexCount,
+      command.instanceCount,
+      command.firstIndex,
+      command.vertexOffset,
+      command.firstInstance
+    );
+  }
+}
+
+void Simple::drawLate(const FrameInfo& frameInfo) {
+  if (this->batches.empty())
+    return;
+  this->bindForDraw(frameInfo, this->getPipeline());
+  for (const auto& batch : this->batches) {
+    batch.geometry->bind(frameInfo.recorder);
+    this->drawIndirect(
+      frameInfo.recorder,
+      *this->indirect[frameInfo.frameIndex].commands,
+      batch.firstCommand + this->queuedInstances,
+      batch.commandCount
     );
-    mesh.model->bind(frameInfo.commandBuffer);
-    mesh.model->draw(frameInfo.commandBuffer);
   }
-}
\ No newline at end of file
+}
+
+void Simple::drawFiltered(const FrameInfo& frameInfo, const Batch& batch) {
+  // filtered instances are never culled, their data stays in the raw instance buffer
+  SimplePushConstantData data{ this->instances[frameInfo.frameIndex].tableIndex };
+  frameInfo.recorder.pushConstants(
+    this->pipelineLayout,
+    VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+    0,
+    sizeof(SimplePushConstantData),
+    &data
+  );
+  const auto& filter = this->filters[frameInfo.frameIndex];
+  batch.geometry->bind(frameInfo.recorder);
+  frameInfo.recorder.bindIndexBuffer(filter.indices->getHandle(), 0, VK_INDEX_TYPE_UINT32);
+  this->drawIndirect(frameInfo.recorder, *filter.commands, batch.firstFiltered, batch.filteredCount);
+}
@@ -0,0 +1,285 @@
+#include "engine/renderer/systems/StaticBatches.h"
+#include "engine/renderer/systems/Simple.h"
+#include <engine/scene/components/Mesh.h>
+#include <engine/scene/components/Static.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <unordered_map>
+#include <glm/glm.hpp>
+
+using Scop::Renderer::Systems::StaticBatches;
+
+// matches PushConstantData in baked.vert, simple.vert only reads the first member
+struct StaticBatchesPushConstantData {
+  uint32_t instanceBuffer;
+  uint32_t irradianceBuffer;
+  uint32_t firstVertex;
+};
+static_assert(sizeof(StaticBatchesPushConstantData) <= StaticBatches::SharedPushConstantRange.size);
+
+StaticBatches::StaticBatches(
+  const SystemInfo& deps,
+  Scene& scene,
+  GeometryPool& geometryPool
+) : Base(
+  deps,
+  SHADERS_PATH"simple.vert.spv",
+  SHADERS_PATH"simple.frag.spv"
+), scene(scene), geometryPool(geometryPool), bindlessTable(deps.bindlessTable), commandCache(deps.device) {
+  this->init(deps);
+  this->createGBufferPipeline(deps.gbufferRenderPass, SHADERS_PATH"gbuffer.frag.spv");
+  this->createDepthPrepassPipelines(deps.renderPass, SHADERS_PATH"depth_prepass.vert.spv");
+  this->bakedPipeline = this->createPipelineVariant(deps.renderPass, SHADERS_PATH"baked.vert.spv", SHADERS_PATH"baked.frag.spv");
+  this->bakedEqualPipeline = this->createPipelineVariant(
+    deps.renderPass,
+    SHADERS_PATH"baked.vert.spv",
+    SHADERS_PATH"baked.frag.spv",
+    [](Pipeline::ConfigInfo& config) {
+      config.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_EQUAL;
+      config.depthStencilInfo.depthWriteEnable = VK_FALSE;
+    }
+  );
+
+  this->instance = std::make_unique<MemBuffer>(
+    this->device,
+    sizeof(Simple::InstanceData),
+    1,
+    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+  );
+  this->instance->map();
+  Simple::InstanceData identity{};
+  this->instance->writeTo(&identity);
+  this->instanceTableIndex = this->bindlessTable.registerBuffer(*this->instance);
+
+  auto& registry = this->scene.getRegistry();
+  registry.on_construct<Components::Static>().connect<&StaticBatches::invalidate>(*this);
+  registry.on_destroy<Components::Static>().connect<&StaticBatches::invalidate>(*this);
+  registry.on_update<Components::Transform>().connect<&StaticBatches::onEdit>(*this);
+  registry.on_update<Components::Mesh>().connect<&StaticBatches::onEdit>(*this);
+  registry.on_destroy<Components::Mesh>().connect<&StaticBatches::onEdit>(*this);
+}
+
+StaticBatches::~StaticBatches() {
+  auto& registry = this->scene.getRegistry();
+  registry.on_construct<Components::Static>().disconnect(this);
+  registry.on_destroy<Components::Static>().disconnect(this);
+  registry.on_update<Components::Transform>().disconnect(this);
+  registry.on_update<Components::Mesh>().disconnect(this);
+  registry.on_destroy<Components::Mesh>().disconnect(this);
+  if (this->allocation.indexCount)
+    this->geometryPool.release(this->allocation);
+  this->bindlessTable.releaseBuffer(this->instanceTableIndex);
+  if (this->irradianceTableIndex != BindlessTable::INVALID_INDEX)
+    this->bindlessTable.releaseBuffer(this->irradianceTableIndex);
+}
+
+void StaticBatches::onEdit(entt::registry& registry, entt::entity entity) {
+  if (registry.all_of<Components::Static>(entity))
+    this->dirty = true;
+}
+
+void StaticBatches::rebuild(Scene& scene) {
+  // frames in flight may still draw the previous batch
+  vkDeviceWaitIdle(this->device.getHandle());
+  if (this->allocation.indexCount)
+    this->geometryPool.release(this->allocation);
+  this->allocation = {};
+  this->vertices.clear();
+  this->indices.clear();
+  this->entityCount = 0;
+
+  // each model is read back from the pool once, however many entities use it
+  struct Geometry {
+    std::vector<Model::Vertex> vertices;
+    std::vector<uint32_t> indices;
+  };
+  std::unordered_map<const Model*, Geometry> geometries;
+  auto group = scene.viewEntitiesWith<Components::Static, Components::Mesh, Components::Transform>();
+  for (auto entity : group) {
+    auto [mesh, transform] = group.get<Components::Mesh, Components::Transform>(entity);
+    if (!mesh.model)
+      continue;
+    auto [it, inserted] = geometries.try_emplace(mesh.model.get());
+    auto& geometry = it->second;
+    if (inserted) {
+      const auto& source = mesh.model->getAllocation();
+      geometry.vertices.resize(source.vertexCount);
+      geometry.indices.resize(source.indexCount);
+      Model::Download(this->geometryPool, source, geometry.vertices, geometry.indices);
+    }
+
+    const glm::mat4 modelMatrix = static_cast<glm::mat4>(transform);
+    const glm::mat3 normalMatrix = transform.computeNormalMatrix();
+    const auto base = static_cast<uint32_t>(this->vertices.size());
+    for (auto vertex : geometry.vertices) {
+      vertex.position = glm::vec3(modelMatrix * glm::vec4(vertex.position, 1.0f));
+      vertex.normal = glm::normalize(normalMatrix * vertex.normal);
+      // the tint of the instance is baked in, the batch instance stays white
+      vertex.color *= mesh.color;
+      this->vertices.push_back(vertex);
+    }
+    for (uint32_t index : geometry.indices)
+      this->indices.push_back(base + index);
+    this->entityCount++;
+  }
+
+  if (!this->indices.empty()) {
+    this->allocation = Model::Upload(this->geometryPool, this->vertices, this->indices);
+  }
+  this->rebuildCount++;
+  this->dirty = false;
+}
+
+void StaticBatches::enqueue(const FrameInfo&, Scene& scene, RenderQueue& queue) {
+  if (this->dirty)
+    this->rebuild(scene);
+  if (this->isEmpty() || this->caching)
+    return;
+  // closest possible depth: drawn first, a good occluder for everything else
+  queue.push(this->queueId, RenderQueue::MakeKey(RenderQueue::Pass::Opaque, this->queueId, 0, 0.0f), 0);
+}
+
+void StaticBatches::drawPackets(const FrameInfo& frameInfo, Scene&, std::span<const RenderQueue::Packet>) {
+  this->draw(frameInfo, this->getShadingPipeline());
+}
+
+Scop::Renderer::Pipeline& StaticBatches::getShadingPipeline() const {
+  // the g-buffer has no room for baked irradiance, deferred always shades live
+  if (!this->isBaked() || this->isDeferred())
+    return this->getPipeline();
+  return this->isDepthPrepass() ? *this->bakedEqualPipeline : *this->bakedPipeline;
+}
+
+void StaticBatches::bakeLighting(const Lighting& lighting) {
+  if (!this->bakedLighting || this->isEmpty())
+    return;
+  const uint32_t version = lighting.getVersion();
+  const bool settled = version == this->seenLightVersion;
+  this->seenLightVersion = version;
+  if (this->bakeValid && this->bakedLightVersion == version && this->bakedRebuild == this->rebuildCount)
+    return;
+  this->bakeValid = false;
+  // moving lights would need a bake every frame, shade them live until they stop
+  if (!settled)
+    return;
+
+  auto start = std::chrono::high_resolution_clock::now();
+  this->bake(lighting.getLights());
+  this->bakeTime = std::chrono::duration<float, std::chrono::milliseconds::period>(
+    std::chrono::high_resolution_clock::now() - start
+  ).count();
+  this->bakedLightVersion = version;
+  this->bakedRebuild = this->rebuildCount;
+  this->bakeValid = true;
+  this->bakeCount++;
+}
+
+void StaticBatches::bake(std::span<const Lighting::PointLightData> lights) {
+  const auto count = static_cast<uint32_t>(this->vertices.size());
+  this->irradiance.resize(count);
+  const uint32_t threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+  const uint32_t chunks = std::clamp<uint32_t>(count / MIN_BAKE_VERTICES_PER_THREAD, 1, threadCount);
+  const uint32_t chunkSize = (count + chunks - 1) / chunks;
+  // every chunk writes its own slice of the irradiance
+  std::vector<std::thread> workers;
+  workers.reserve(chunks - 1);
+  for (uint32_t chunk = 1; chunk < chunks; chunk++) {
+    workers.emplace_back([&, chunk]() {
+      uint32_t first = chunk * chunkSize;
+      this->bakeRange(lights, first, std::min(first + chunkSize, count));
+      });
+  }
+  this->bakeRange(lights, 0, std::min(chunkSize, count));
+  for (auto& worker : workers)
+    worker.join();
+
+  // frames in flight may still read the previous bake
+  vkDeviceWaitIdle(this->device.getHandle());
+  if (!this->irradianceBuffer || this->irradianceBuffer->getInstanceCount() < count) {
+    this->irradianceBuffer = std::make_unique<MemBuffer>(
+      this->device,
+      sizeof(glm::vec4),
+      count,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    );
+    this->irradianceBuffer->map();
+    if (this->irradianceTableIndex == BindlessTable::INVALID_INDEX)
+      this->irradianceTableIndex = this->bindlessTable.registerBuffer(*this->irradianceBuffer);
+    else
+      this->bindlessTable.updateBuffer(this->irradianceTableIndex, *this->irradianceBuffer);
+  }
+  this->irradianceBuffer->writeTo(this->irradiance.data(), count * sizeof(glm::vec4));
+}
+
+void StaticBatches::bakeRange(std::span<const Lighting::PointLightData> lights, uint32_t first, uint32_t last) {
+  // the point light diffuse term of simple.frag, the vertices are already in world space
+  for (uint32_t i = first; i < last; i++) {
+    const auto& vertex = this->vertices[i];
+    glm::vec3 sum{ 0.0f };
+    for (const auto& light : lights) {
+      glm::vec3 direction = glm::vec3(light.position) - vertex.position;
+      float distanceSquared = glm::dot(direction, direction);
+      float range = light.position.w;
+      if ((range > 0.0f && distanceSquared > range * range) || distanceSquared == 0.0f)
+        continue;
+      float cosAngIncidence = std::max(glm::dot(vertex.normal, direction / std::sqrt(distanceSquared)), 0.0f);
+      sum += glm::vec3(light.color) * light.color.a * cosAngIncidence / distanceSquared;
+    }
+    this->irradiance[i] = glm::vec4(sum, 1.0f);
+  }
+}
+
+void StaticBatches::drawDepthPrepass(const FrameInfo& frameInfo) {
+  if (!this->isEmpty())
+    this->draw(frameInfo, *this->depthPipeline);
+}
+
+void StaticBatches::executeCached(const FrameInfo& frameInfo, VkRenderPass renderPass, VkExtent2D extent) {
+  // the camera only reaches the recorded draw through the global UBO, the pre-pass and the bake swap the pipeline
+  uint64_t version =
+    (static_cast<uint64_t>(this->geometryPool.getGeneration()) << 32) |
+    (static_cast<uint64_t>(this->rebuildCount) << 2) |
+    (static_cast<uint64_t>(this->isBaked()) << 1) |
+    this->isDepthPrepass();
+  this->commandCache.execute(frameInfo.recorder, frameInfo.frameIndex, version, renderPass, extent, [&](CommandRecorder& recorder) {
+    FrameInfo cachedFrameInfo{
+      frameInfo.deltaTime,
+      frameInfo.frameIndex,
+      recorder.getHandle(),
+      recorder,
+      frameInfo.sceneCamera,
+      frameInfo.globalDescriptorSet,
+      frameInfo.globalPipelineLayout,
+      frameInfo.globalUbo
+    };
+    // bindings are not inherited either
+    VkDescriptorSet sets[] = { frameInfo.globalDescriptorSet, this->bindlessTable.getSet() };
+    recorder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, frameInfo.globalPipelineLayout, 0, 2, sets);
+    this->draw(cachedFrameInfo, this->getShadingPipeline());
+    });
+}
+
+void StaticBatches::draw(const FrameInfo& frameInfo, Pipeline& pipeline) {
+  pipeline.bind(frameInfo.recorder);
+  this->bindGlobalDescriptorSet(frameInfo);
+  StaticBatchesPushConstantData data{ this->instanceTableIndex, this->irradianceTableIndex, this->allocation.firstVertex };
+  frameInfo.recorder.pushConstants(
+    this->pipelineLayout,
+    VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+    0,
+    sizeof(StaticBatchesPushConstantData),
+    &data
+  );
+  this->geometryPool.bind(frameInfo.recorder);
+  frameInfo.recorder.drawIndexed(
+    this->allocation.indexCount,
+    1,
+    this->allocation.firstIndex,
+    static_cast<int32_t>(this->allocation.firstVertex),
+    0
+  );
+}
@@ -5,14 +5,28 @@
 int main(int ac, char**av) {
   ac--;
   av++;
-  Scop::App app{};
+
+  // --device <name|uuid> takes precedence over SCOP_DEVICE
+  std::string_view preferredDevice;
+  std::vector<std::string_view> modelPaths;
+  for (int i = 0; i < ac; i++) {
+    std::string_view arg = av[i];
+    if (arg == "--device") {
+      if (i + 1 >= ac) {
+        std::cerr << "usage: scop [--device <name|uuid>] [models...]" << std::endl;
+        return EXIT_FAILURE;
+      }
+      preferredDevice = av[++i];
+    }
+    else
+      modelPaths.push_back(arg);
+  }
+  if (modelPaths.empty())
+    modelPaths.push_back("assets/models/colored_cube.obj");
+
+  Scop::App app{ preferredDevice };
 
   try {
-    std::vector<std::string_view> modelPaths;
-    if (ac == 0)
-      modelPaths.push_back("assets/models/colored_cube.obj");
-    for (int i = 0; i < ac; i++)
-      modelPaths.push_back(av[i]);
     app.loadEntities(modelPaths);
     app.run();
   }
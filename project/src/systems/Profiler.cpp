@@ -2,6 +2,7 @@
 
 #include <engine/input/Input.h>
 
+#include <algorithm>
 #include <iostream>
 
 using Scop::Profiler;
@@ -15,5 +16,16 @@ void Profiler::update(float deltaTime) {
   if (this->lastOutput <= 0.f) {
     this->lastOutput = 1.f;
     std::cout << "Profiler: " << deltaTime * 1000 << "ms, fps: " << 1.f / deltaTime << std::endl;
+    for (const auto& [name, value] : this->counters)
+      std::cout << "  " << name << ": " << value << std::endl;
   }
-}
\ No newline at end of file
+}
+
+void Profiler::set(std::string_view name, double value) {
+  auto it = std::find_if(this->counters.begin(), this->counters.end(),
+    [name](const auto& counter) { return counter.first == name; });
+  if (it != this->counters.end())
+    it->second = value;
+  else
+    this->counters.emplace_back(name, value);
+}